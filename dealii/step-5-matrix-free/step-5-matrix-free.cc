@@ -0,0 +1,606 @@
+// The problem of step-5, -div(a(x) grad u) = 1 on the circle with u = 0 on
+// the boundary, without a SparseMatrix. The operator is applied cell by cell
+// with FEEvaluation, which evaluates the gradients at the quadrature points
+// by sum factorization (1D operations along each direction, O(p^{d+1}) per
+// cell instead of O(p^{2d}) for a cell matrix) and works on batches of cells
+// in the SIMD lanes (VectorizedArray). CG is preconditioned by a geometric
+// multigrid V-cycle with Chebyshev smoothing on the levels of the
+// triangulation, whose iteration count does not grow with refinement, where
+// the SSOR preconditioner of step-5 needs more and more iterations.
+//
+// The structure follows step-37 of the deal.II tutorial, in serial.
+
+/* ---------------------------------------------------------------------
+ *
+ * Copyright (C) 1999 - 2021 by the deal.II authors
+ *
+ * This file is part of the deal.II library.
+ *
+ * The deal.II library is free software; you can use it, redistribute
+ * it, and/or modify it under the terms of the GNU Lesser General
+ * Public License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * The full text of the license can be found in the file LICENSE.md at
+ * the top level directory of deal.II.
+ *
+ * ---------------------------------------------------------------------
+
+ *
+ * Author: Wolfgang Bangerth, University of Heidelberg, 1999 (step-5)
+ *         Katharina Kormann, Martin Kronbichler, Uppsala University,
+ *         2009-2012 (step-37)
+ */
+
+
+
+#include <deal.II/base/quadrature_lib.h>
+#include <deal.II/base/function.h>
+#include <deal.II/base/timer.h>
+#include <deal.II/lac/affine_constraints.h>
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
+#include <deal.II/lac/la_parallel_vector.h>
+#include <deal.II/lac/solver_cg.h>
+#include <deal.II/lac/precondition.h>
+#include <deal.II/grid/tria.h>
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/dofs/dof_tools.h>
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/mapping_q_generic.h>
+#include <deal.II/numerics/vector_tools.h>
+#include <deal.II/numerics/data_out.h>
+
+#include <deal.II/grid/grid_in.h>
+
+#include <deal.II/grid/manifold_lib.h>
+
+#include <deal.II/multigrid/multigrid.h>
+#include <deal.II/multigrid/mg_constrained_dofs.h>
+#include <deal.II/multigrid/mg_transfer_matrix_free.h>
+#include <deal.II/multigrid/mg_tools.h>
+#include <deal.II/multigrid/mg_coarse.h>
+#include <deal.II/multigrid/mg_smoother.h>
+#include <deal.II/multigrid/mg_matrix.h>
+
+#include <deal.II/matrix_free/matrix_free.h>
+#include <deal.II/matrix_free/operators.h>
+#include <deal.II/matrix_free/fe_evaluation.h>
+
+#include <fstream>
+#include <iostream>
+
+
+using namespace dealii;
+
+// The gain over the sparse matrix grows with the degree, as the number of
+// nonzeros per row of the matrix grows like (2p+1)^d
+const unsigned int degree_finite_element = 4;
+
+
+
+template <int dim>
+double coefficient(const Point<dim> &p)
+{
+  if (p.square() < 0.5 * 0.5)
+    return 20.0;
+  else
+    return 1.0;
+}
+
+
+
+// The coefficient at the quadrature points of a batch of cells, one lane at a
+// time, as it is only evaluated once per mesh
+template <int dim, typename number>
+VectorizedArray<number>
+coefficient(const Point<dim, VectorizedArray<number>> &p)
+{
+  VectorizedArray<number> value;
+  for (unsigned int v = 0; v < VectorizedArray<number>::size(); ++v)
+    {
+      Point<dim> point;
+      for (unsigned int d = 0; d < dim; ++d)
+        point[d] = p[d][v];
+      value[v] = coefficient(point);
+    }
+  return value;
+}
+
+
+
+// The operator v -> (a grad phi_i, grad v) with the coefficient stored at the
+// quadrature points. It is used in double on the finest mesh for CG and in
+// float on the multigrid levels, where the smoother needs less accuracy and
+// twice as many lanes fit in a SIMD register.
+template <int dim, int fe_degree, typename number>
+class LaplaceOperator
+  : public MatrixFreeOperators::
+      Base<dim, LinearAlgebra::distributed::Vector<number>>
+{
+public:
+  using value_type = number;
+
+  LaplaceOperator();
+
+  void clear() override;
+
+  void evaluate_coefficient();
+
+  virtual void compute_diagonal() override;
+
+private:
+  virtual void apply_add(
+    LinearAlgebra::distributed::Vector<number> &      dst,
+    const LinearAlgebra::distributed::Vector<number> &src) const override;
+
+  void
+  local_apply(const MatrixFree<dim, number> &                   data,
+              LinearAlgebra::distributed::Vector<number> &      dst,
+              const LinearAlgebra::distributed::Vector<number> &src,
+              const std::pair<unsigned int, unsigned int> &cell_range) const;
+
+  void local_compute_diagonal(
+    const MatrixFree<dim, number> &              data,
+    LinearAlgebra::distributed::Vector<number> & dst,
+    const unsigned int &                         dummy,
+    const std::pair<unsigned int, unsigned int> &cell_range) const;
+
+  Table<2, VectorizedArray<number>> coefficient_values;
+};
+
+
+
+template <int dim, int fe_degree, typename number>
+LaplaceOperator<dim, fe_degree, number>::LaplaceOperator()
+  : MatrixFreeOperators::Base<dim,
+                              LinearAlgebra::distributed::Vector<number>>()
+{}
+
+
+
+template <int dim, int fe_degree, typename number>
+void LaplaceOperator<dim, fe_degree, number>::clear()
+{
+  coefficient_values.reinit(0, 0);
+  MatrixFreeOperators::Base<dim, LinearAlgebra::distributed::Vector<number>>::
+    clear();
+}
+
+
+
+template <int dim, int fe_degree, typename number>
+void LaplaceOperator<dim, fe_degree, number>::evaluate_coefficient()
+{
+  const unsigned int n_cells = this->data->n_cell_batches();
+  FEEvaluation<dim, fe_degree, fe_degree + 1, 1, number> phi(*this->data);
+
+  coefficient_values.reinit(n_cells, phi.n_q_points);
+  for (unsigned int cell = 0; cell < n_cells; ++cell)
+    {
+      phi.reinit(cell);
+      for (unsigned int q = 0; q < phi.n_q_points; ++q)
+        coefficient_values(cell, q) = coefficient(phi.quadrature_point(q));
+    }
+}
+
+
+
+template <int dim, int fe_degree, typename number>
+void LaplaceOperator<dim, fe_degree, number>::local_apply(
+  const MatrixFree<dim, number> &                   data,
+  LinearAlgebra::distributed::Vector<number> &      dst,
+  const LinearAlgebra::distributed::Vector<number> &src,
+  const std::pair<unsigned int, unsigned int> &     cell_range) const
+{
+  FEEvaluation<dim, fe_degree, fe_degree + 1, 1, number> phi(data);
+
+  for (unsigned int cell = cell_range.first; cell < cell_range.second; ++cell)
+    {
+      AssertDimension(coefficient_values.size(0), data.n_cell_batches());
+      AssertDimension(coefficient_values.size(1), phi.n_q_points);
+
+      phi.reinit(cell);
+      phi.read_dof_values(src);
+      phi.evaluate(EvaluationFlags::gradients);
+      for (unsigned int q = 0; q < phi.n_q_points; ++q)
+        phi.submit_gradient(coefficient_values(cell, q) * phi.get_gradient(q),
+                            q);
+      phi.integrate(EvaluationFlags::gradients);
+      phi.distribute_local_to_global(dst);
+    }
+}
+
+
+
+template <int dim, int fe_degree, typename number>
+void LaplaceOperator<dim, fe_degree, number>::apply_add(
+  LinearAlgebra::distributed::Vector<number> &      dst,
+  const LinearAlgebra::distributed::Vector<number> &src) const
+{
+  this->data->cell_loop(&LaplaceOperator::local_apply, this, dst, src);
+}
+
+
+
+// The diagonal for the Jacobi part of the Chebyshev smoother, from the
+// operator applied to the unit vectors of each cell
+template <int dim, int fe_degree, typename number>
+void LaplaceOperator<dim, fe_degree, number>::compute_diagonal()
+{
+  this->inverse_diagonal_entries.reset(
+    new DiagonalMatrix<LinearAlgebra::distributed::Vector<number>>());
+  LinearAlgebra::distributed::Vector<number> &inverse_diagonal =
+    this->inverse_diagonal_entries->get_vector();
+  this->data->initialize_dof_vector(inverse_diagonal);
+  unsigned int dummy = 0;
+  this->data->cell_loop(&LaplaceOperator::local_compute_diagonal,
+                        this,
+                        inverse_diagonal,
+                        dummy);
+
+  this->set_constrained_entries_to_one(inverse_diagonal);
+
+  for (unsigned int i = 0; i < inverse_diagonal.locally_owned_size(); ++i)
+    {
+      Assert(inverse_diagonal.local_element(i) > 0.,
+             ExcMessage("No diagonal entry in a positive definite operator "
+                        "should be zero"));
+      inverse_diagonal.local_element(i) =
+        1. / inverse_diagonal.local_element(i);
+    }
+}
+
+
+
+template <int dim, int fe_degree, typename number>
+void LaplaceOperator<dim, fe_degree, number>::local_compute_diagonal(
+  const MatrixFree<dim, number> &             data,
+  LinearAlgebra::distributed::Vector<number> &dst,
+  const unsigned int &,
+  const std::pair<unsigned int, unsigned int> &cell_range) const
+{
+  FEEvaluation<dim, fe_degree, fe_degree + 1, 1, number> phi(data);
+
+  AlignedVector<VectorizedArray<number>> diagonal(phi.dofs_per_cell);
+
+  for (unsigned int cell = cell_range.first; cell < cell_range.second; ++cell)
+    {
+      AssertDimension(coefficient_values.size(0), data.n_cell_batches());
+      AssertDimension(coefficient_values.size(1), phi.n_q_points);
+
+      phi.reinit(cell);
+      for (unsigned int i = 0; i < phi.dofs_per_cell; ++i)
+        {
+          for (unsigned int j = 0; j < phi.dofs_per_cell; ++j)
+            phi.submit_dof_value(VectorizedArray<number>(), j);
+          phi.submit_dof_value(make_vectorized_array<number>(1.), i);
+
+          phi.evaluate(EvaluationFlags::gradients);
+          for (unsigned int q = 0; q < phi.n_q_points; ++q)
+            phi.submit_gradient(coefficient_values(cell, q) *
+                                  phi.get_gradient(q),
+                                q);
+          phi.integrate(EvaluationFlags::gradients);
+          diagonal[i] = phi.get_dof_value(i);
+        }
+      for (unsigned int i = 0; i < phi.dofs_per_cell; ++i)
+        phi.submit_dof_value(diagonal[i], i);
+      phi.distribute_local_to_global(dst);
+    }
+}
+
+
+
+template <int dim>
+class Step5
+{
+public:
+  Step5();
+  void run();
+
+private:
+  void setup_system();
+  void assemble_rhs();
+  void solve();
+  void output_results(const unsigned int cycle) const;
+
+  Triangulation<dim>   triangulation;
+  FE_Q<dim>            fe;
+  DoFHandler<dim>      dof_handler;
+  MappingQGeneric<dim> mapping;
+
+  AffineConstraints<double> constraints;
+  using SystemMatrixType =
+    LaplaceOperator<dim, degree_finite_element, double>;
+  SystemMatrixType system_matrix;
+
+  MGConstrainedDoFs mg_constrained_dofs;
+  using LevelMatrixType = LaplaceOperator<dim, degree_finite_element, float>;
+  MGLevelObject<LevelMatrixType> mg_matrices;
+
+  LinearAlgebra::distributed::Vector<double> solution;
+  LinearAlgebra::distributed::Vector<double> system_rhs;
+
+  Timer time;
+};
+
+
+
+
+// The levels of the triangulation are the multigrid levels, and their
+// refinement may not differ by more than one at a vertex
+template <int dim>
+Step5<dim>::Step5()
+  : triangulation(Triangulation<dim>::limit_level_difference_at_vertices)
+  , fe(degree_finite_element)
+  , dof_handler(triangulation)
+  , mapping(degree_finite_element)
+{}
+
+
+
+
+template <int dim>
+void Step5<dim>::setup_system()
+{
+  time.restart();
+
+  system_matrix.clear();
+  mg_matrices.clear_elements();
+
+  dof_handler.distribute_dofs(fe);
+  dof_handler.distribute_mg_dofs();
+
+  std::cout << "   Number of degrees of freedom: " << dof_handler.n_dofs()
+            << std::endl;
+
+  constraints.clear();
+  VectorTools::interpolate_boundary_values(
+    mapping, dof_handler, 0, Functions::ZeroFunction<dim>(), constraints);
+  constraints.close();
+
+  {
+    typename MatrixFree<dim, double>::AdditionalData additional_data;
+    additional_data.tasks_parallel_scheme =
+      MatrixFree<dim, double>::AdditionalData::none;
+    additional_data.mapping_update_flags =
+      (update_gradients | update_JxW_values | update_quadrature_points);
+    std::shared_ptr<MatrixFree<dim, double>> system_mf_storage(
+      new MatrixFree<dim, double>());
+    system_mf_storage->reinit(mapping,
+                              dof_handler,
+                              constraints,
+                              QGauss<1>(fe.degree + 1),
+                              additional_data);
+    system_matrix.initialize(system_mf_storage);
+  }
+
+  system_matrix.evaluate_coefficient();
+
+  system_matrix.initialize_dof_vector(solution);
+  system_matrix.initialize_dof_vector(system_rhs);
+
+  const unsigned int nlevels = triangulation.n_global_levels();
+  mg_matrices.resize(0, nlevels - 1);
+
+  std::set<types::boundary_id> dirichlet_boundary;
+  dirichlet_boundary.insert(0);
+  mg_constrained_dofs.initialize(dof_handler);
+  mg_constrained_dofs.make_zero_boundary_constraints(dof_handler,
+                                                     dirichlet_boundary);
+
+  for (unsigned int level = 0; level < nlevels; ++level)
+    {
+      IndexSet relevant_dofs;
+      DoFTools::extract_locally_relevant_level_dofs(dof_handler,
+                                                    level,
+                                                    relevant_dofs);
+      AffineConstraints<double> level_constraints;
+      level_constraints.reinit(relevant_dofs);
+      level_constraints.add_lines(
+        mg_constrained_dofs.get_boundary_indices(level));
+      level_constraints.close();
+
+      typename MatrixFree<dim, float>::AdditionalData additional_data;
+      additional_data.tasks_parallel_scheme =
+        MatrixFree<dim, float>::AdditionalData::none;
+      additional_data.mapping_update_flags =
+        (update_gradients | update_JxW_values | update_quadrature_points);
+      additional_data.mg_level = level;
+      std::shared_ptr<MatrixFree<dim, float>> mg_mf_storage_level(
+        new MatrixFree<dim, float>());
+      mg_mf_storage_level->reinit(mapping,
+                                  dof_handler,
+                                  level_constraints,
+                                  QGauss<1>(fe.degree + 1),
+                                  additional_data);
+
+      mg_matrices[level].initialize(mg_mf_storage_level,
+                                    mg_constrained_dofs,
+                                    level);
+      mg_matrices[level].evaluate_coefficient();
+    }
+
+  std::cout << "   Setup time: " << time.wall_time() << " s" << std::endl;
+
+  // What step-5 would store for the same operator, a double and a column
+  // index per nonzero
+  DynamicSparsityPattern dsp(dof_handler.n_dofs());
+  DoFTools::make_sparsity_pattern(dof_handler, dsp);
+  std::cout << "   Memory of the matrix-free operator: "
+            << system_matrix.get_matrix_free()->memory_consumption() / 1e6
+            << " MB, of a SparseMatrix<double>: "
+            << dsp.n_nonzero_elements() *
+                 (sizeof(double) + sizeof(types::global_dof_index)) / 1e6
+            << " MB" << std::endl;
+}
+
+
+
+
+// The right hand side f = 1, with the same FEEvaluation as the operator. The
+// boundary values are zero, so that they need no contribution here.
+template <int dim>
+void Step5<dim>::assemble_rhs()
+{
+  time.restart();
+
+  system_rhs = 0;
+  FEEvaluation<dim, degree_finite_element> phi(
+    *system_matrix.get_matrix_free());
+  for (unsigned int cell = 0;
+       cell < system_matrix.get_matrix_free()->n_cell_batches();
+       ++cell)
+    {
+      phi.reinit(cell);
+      for (unsigned int q = 0; q < phi.n_q_points; ++q)
+        phi.submit_value(make_vectorized_array<double>(1.0), q);
+      phi.integrate(EvaluationFlags::values);
+      phi.distribute_local_to_global(system_rhs);
+    }
+  system_rhs.compress(VectorOperation::add);
+
+  std::cout << "   Assemble right hand side: " << time.wall_time() << " s"
+            << std::endl;
+}
+
+
+
+// Chebyshev smoothing of degree 5 on each level, in the upper part
+// [lambda_max/15, 1.2 lambda_max] of the spectrum of the Jacobi preconditioned
+// operator, with lambda_max estimated by 10 CG iterations. On the coarsest
+// level, the Chebyshev iteration is run to convergence as the coarse solver.
+// The refinement is global, so that there are no interface matrices between
+// the levels.
+template <int dim>
+void Step5<dim>::solve()
+{
+  time.restart();
+
+  MGTransferMatrixFree<dim, float> mg_transfer(mg_constrained_dofs);
+  mg_transfer.build(dof_handler);
+
+  using SmootherType =
+    PreconditionChebyshev<LevelMatrixType,
+                          LinearAlgebra::distributed::Vector<float>>;
+  mg::SmootherRelaxation<SmootherType,
+                         LinearAlgebra::distributed::Vector<float>>
+                                                       mg_smoother;
+  MGLevelObject<typename SmootherType::AdditionalData> smoother_data;
+  smoother_data.resize(0, triangulation.n_global_levels() - 1);
+  for (unsigned int level = 0; level < triangulation.n_global_levels();
+       ++level)
+    {
+      if (level > 0)
+        {
+          smoother_data[level].smoothing_range     = 15.;
+          smoother_data[level].degree              = 5;
+          smoother_data[level].eig_cg_n_iterations = 10;
+        }
+      else
+        {
+          smoother_data[0].smoothing_range     = 1e-3;
+          smoother_data[0].degree              = numbers::invalid_unsigned_int;
+          smoother_data[0].eig_cg_n_iterations = mg_matrices[0].m();
+        }
+      mg_matrices[level].compute_diagonal();
+      smoother_data[level].preconditioner =
+        mg_matrices[level].get_matrix_diagonal_inverse();
+    }
+  mg_smoother.initialize(mg_matrices, smoother_data);
+
+  MGCoarseGridApplySmoother<LinearAlgebra::distributed::Vector<float>>
+    mg_coarse;
+  mg_coarse.initialize(mg_smoother);
+
+  mg::Matrix<LinearAlgebra::distributed::Vector<float>> mg_matrix(
+    mg_matrices);
+
+  Multigrid<LinearAlgebra::distributed::Vector<float>> mg(
+    mg_matrix, mg_coarse, mg_transfer, mg_smoother, mg_smoother);
+
+  PreconditionMG<dim,
+                 LinearAlgebra::distributed::Vector<float>,
+                 MGTransferMatrixFree<dim, float>>
+    preconditioner(dof_handler, mg, mg_transfer);
+
+  std::cout << "   Multigrid setup: " << time.wall_time() << " s"
+            << std::endl;
+  time.restart();
+
+  SolverControl solver_control(1000, 1e-12 * system_rhs.l2_norm());
+  SolverCG<LinearAlgebra::distributed::Vector<double>> solver(solver_control);
+
+  constraints.set_zero(solution);
+  solver.solve(system_matrix, solution, system_rhs, preconditioner);
+  constraints.distribute(solution);
+
+  std::cout << "   " << solver_control.last_step()
+            << " CG iterations needed to obtain convergence, in "
+            << time.wall_time() << " s" << std::endl;
+}
+
+
+
+template <int dim>
+void Step5<dim>::output_results(const unsigned int cycle) const
+{
+  DataOut<dim> data_out;
+
+  solution.update_ghost_values();
+  data_out.attach_dof_handler(dof_handler);
+  data_out.add_data_vector(solution, "solution");
+
+  // Subdivide each cell to show the polynomials of degree p
+  data_out.build_patches(mapping, fe.degree);
+
+  std::ofstream output("solution-" + std::to_string(cycle) + ".vtu");
+  data_out.write_vtu(output);
+}
+
+
+
+
+
+template <int dim>
+void Step5<dim>::run()
+{
+  GridIn<dim> grid_in;
+  grid_in.attach_triangulation(triangulation);
+  std::ifstream input_file("circle-grid.inp");
+  Assert(dim == 2, ExcInternalError());
+
+  grid_in.read_ucd(input_file);
+
+  const SphericalManifold<dim> boundary;
+  triangulation.set_all_manifold_ids_on_boundary(0);
+  triangulation.set_manifold(0, boundary);
+
+  for (unsigned int cycle = 0; cycle < 6; ++cycle)
+    {
+      std::cout << "Cycle " << cycle << ':' << std::endl;
+
+      if (cycle != 0)
+        triangulation.refine_global(1);
+
+      std::cout << "   Number of active cells: "  //
+                << triangulation.n_active_cells() //
+                << std::endl                      //
+                << "   Total number of cells: "   //
+                << triangulation.n_cells()        //
+                << std::endl;
+
+      setup_system();
+      assemble_rhs();
+      solve();
+      output_results(cycle);
+    }
+}
+
+
+
+int main()
+{
+  Step5<2> laplace_problem_2d;
+  laplace_problem_2d.run();
+  return 0;
+}
@@ -0,0 +1,454 @@
+#include <cmath>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cassert>
+#include <algorithm>
+#include "array2d.h"
+#include "vtk_anim.h"
+#include "amr2d.h"
+
+using namespace std;
+
+static double minmod(double a, double b)
+{
+  if (a*b <= 0.0)
+    return 0.0;
+  return (a > 0.0) ? min(a,b) : max(a,b);
+}
+
+AMR_Grid2D::AMR_Grid2D(double xmin, double xmax, double ymin, double ymax,
+                       int nb_x, int nb_y, int block_size, int max_level,
+                       int ng,
+                       double (*boundary_value)(double x, double y, double t))
+:
+xmin(xmin),
+xmax(xmax),
+ymin(ymin),
+ymax(ymax),
+nb_x(nb_x),
+nb_y(nb_y),
+bs(block_size),
+max_lev(max_level),
+ng(ng),
+boundary_value(boundary_value),
+t_boundary(0.0)
+{
+  // Prolongation and refluxing pair the cells of a block two by two, and the
+  // ghosts come from the blocks next to it
+  if (bs % 2 != 0 || ng < 1 || ng > bs)
+  {
+    cout << "AMR_Grid2D needs an even block_size and 1 <= ng <= block_size, "
+         << "not block_size = " << bs << ", ng = " << ng << endl;
+    assert(false);
+  }
+  roots.resize(nb_x*nb_y);
+  for (int bj = 0; bj < nb_y; bj++)
+    for (int bi = 0; bi < nb_x; bi++)
+      roots[bi + bj*nb_x] = new_block(0, bi, bj, -1);
+  make_leaf_list();
+}
+
+double AMR_Grid2D::dx(int level) const
+{
+  return (xmax - xmin) / (nb_x*bs) / (1 << level);
+}
+
+double AMR_Grid2D::dy(int level) const
+{
+  return (ymax - ymin) / (nb_y*bs) / (1 << level);
+}
+
+double AMR_Grid2D::x(int level, int i) const
+{
+  return xmin + (i + 0.5)*dx(level);
+}
+
+double AMR_Grid2D::y(int level, int j) const
+{
+  return ymin + (j + 0.5)*dy(level);
+}
+
+int AMR_Grid2D::finest_level() const
+{
+  int finest = 0;
+  for (unsigned int n = 0; n < leaf_list.size(); n++)
+    finest = max(finest, blocks[leaf_list[n]].level);
+  return finest;
+}
+
+bool AMR_Grid2D::inside(int level, int bi, int bj) const
+{
+  return (bi >= 0 && bj >= 0 && bi < (nb_x << level) && bj < (nb_y << level));
+}
+
+int AMR_Grid2D::find(int level, int bi, int bj) const
+{
+  int b = roots[(bi >> level) + (bj >> level)*nb_x];
+  for (int m = 1; m <= level && !blocks[b].is_leaf(); m++)
+  {
+    const int ci = (bi >> (level - m)) & 1, cj = (bj >> (level - m)) & 1;
+    b = blocks[b].child[ci + 2*cj];
+  }
+  return b;
+}
+
+int AMR_Grid2D::new_block(int level, int bi, int bj, int parent)
+{
+  int b;
+  if (free_list.size() > 0)
+  {
+    b = free_list.back();
+    free_list.pop_back();
+  }
+  else
+  {
+    b = blocks.size();
+    blocks.push_back(AMR_Block());
+  }
+  AMR_Block &block = blocks[b];
+  block.level = level, block.bi = bi, block.bj = bj, block.parent = parent;
+  for (int c = 0; c < 4; c++)
+    block.child[c] = -1;
+  block.active = true;
+  block.u.resize(bs, bs, ng);
+  for (int s = 0; s < 4; s++)
+    block.face_flux[s].resize(bs);
+  block.indicator = -1.0; // Not known, so it is not coarsened
+  return b;
+}
+
+double AMR_Grid2D::value(int level, int i, int j) const
+{
+  if (i < 0 || j < 0 || i >= (nb_x*bs << level) || j >= (nb_y*bs << level))
+    return (*boundary_value)(x(level,i), y(level,j), t_boundary);
+  const AMR_Block &block = blocks[find(level, i/bs, j/bs)];
+  if (block.level == level)
+  {
+    if (block.is_leaf())
+      return block.u(i - block.bi*bs, j - block.bj*bs);
+    // Restriction
+    return 0.25*(value(level+1,2*i,2*j)   + value(level+1,2*i+1,2*j)
+               + value(level+1,2*i,2*j+1) + value(level+1,2*i+1,2*j+1));
+  }
+  // Prolongation, the leaf is coarser
+  return prolonged(level-1, i/2, j/2, i%2, j%2);
+}
+
+double AMR_Grid2D::prolonged(int level, int i, int j, int ci, int cj) const
+{
+  const double q = value(level, i, j);
+  const double sx = minmod(q - value(level,i-1,j), value(level,i+1,j) - q);
+  const double sy = minmod(q - value(level,i,j-1), value(level,i,j+1) - q);
+  // The centre of fine cell ci is a quarter of the coarse dx from the centre
+  return q + (ci - 0.5)*0.5*sx + (cj - 0.5)*0.5*sy;
+}
+
+void AMR_Grid2D::fill_ghosts(double t)
+{
+  t_boundary = t;
+  for (unsigned int n = 0; n < leaf_list.size(); n++)
+  {
+    AMR_Block &block = blocks[leaf_list[n]];
+    const int i0 = block.bi*bs, j0 = block.bj*bs;
+    // The ghosts next to each side and corner (di,dj)
+    for (int dj = -1; dj <= 1; dj++)
+      for (int di = -1; di <= 1; di++)
+      {
+        if (di == 0 && dj == 0)
+          continue;
+        const int i_begin = (di == -1) ? -ng : (di == 0 ? 0 : bs);
+        const int i_end   = (di == -1) ? 0 : (di == 0 ? bs : bs + ng);
+        const int j_begin = (dj == -1) ? -ng : (dj == 0 ? 0 : bs);
+        const int j_end   = (dj == -1) ? 0 : (dj == 0 ? bs : bs + ng);
+        // Most often a leaf of the same level, whose values are copied
+        int next = -1;
+        if (inside(block.level, block.bi+di, block.bj+dj))
+        {
+          next = find(block.level, block.bi+di, block.bj+dj);
+          if (blocks[next].level != block.level || !blocks[next].is_leaf())
+            next = -1;
+        }
+        for (int j = j_begin; j < j_end; j++)
+          for (int i = i_begin; i < i_end; i++)
+            if (next != -1)
+              block.u(i,j) = blocks[next].u(i - di*bs, j - dj*bs);
+            else
+              block.u(i,j) = value(block.level, i0 + i, j0 + j);
+      }
+  }
+}
+
+void AMR_Grid2D::compute_indicators()
+{
+  for (unsigned int n = 0; n < leaf_list.size(); n++)
+  {
+    AMR_Block &block = blocks[leaf_list[n]];
+    double indicator = 0.0;
+    for (int j = 0; j < bs; j++)
+      for (int i = 0; i < bs; i++)
+        indicator = max(indicator,
+                        0.5*max(abs(block.u(i+1,j) - block.u(i-1,j)),
+                                abs(block.u(i,j+1) - block.u(i,j-1))));
+    block.indicator = indicator;
+  }
+}
+
+void AMR_Grid2D::refine(int b)
+{
+  const int level = blocks[b].level, bi = blocks[b].bi, bj = blocks[b].bj;
+  // 2:1 balance, the blocks around must be at least at this level
+  for (int dj = -1; dj <= 1; dj++)
+    for (int di = -1; di <= 1; di++)
+    {
+      if (!inside(level, bi+di, bj+dj))
+        continue;
+      int n = find(level, bi+di, bj+dj);
+      while (blocks[n].level < level)
+      {
+        refine(n);
+        n = find(level, bi+di, bj+dj);
+      }
+    }
+  // The children are filled while b is still a leaf, new_block can move the
+  // blocks so they are accessed by index
+  int children[4];
+  for (int c = 0; c < 4; c++)
+  {
+    const int ci = c % 2, cj = c / 2;
+    children[c] = new_block(level+1, 2*bi + ci, 2*bj + cj, b);
+    Array2D &u = blocks[children[c]].u;
+    for (int j = 0; j < bs; j++)
+      for (int i = 0; i < bs; i++)
+      {
+        // Cell (i,j) of the child is in cell (I/2,J/2) of b's level
+        const int I = (2*bi + ci)*bs + i, J = (2*bj + cj)*bs + j;
+        u(i,j) = prolonged(level, I/2, J/2, I%2, J%2);
+      }
+  }
+  for (int c = 0; c < 4; c++)
+    blocks[b].child[c] = children[c];
+}
+
+void AMR_Grid2D::coarsen(int b)
+{
+  AMR_Block &block = blocks[b];
+  for (int c = 0; c < 4; c++)
+  {
+    const int ci = c % 2, cj = c / 2;
+    const Array2D &u = blocks[block.child[c]].u;
+    for (int j = 0; j < bs/2; j++)
+      for (int i = 0; i < bs/2; i++)
+        block.u(ci*bs/2 + i, cj*bs/2 + j)
+          = 0.25*(u(2*i,2*j) + u(2*i+1,2*j) + u(2*i,2*j+1) + u(2*i+1,2*j+1));
+    blocks[block.child[c]].active = false;
+    free_list.push_back(block.child[c]);
+    block.child[c] = -1;
+  }
+  block.indicator = -1.0;
+}
+
+bool AMR_Grid2D::regrid(double refine_tol)
+{
+  bool changed = false;
+  const vector<int> old_leaves = leaf_list;
+  for (unsigned int n = 0; n < old_leaves.size(); n++)
+  {
+    const int b = old_leaves[n];
+    // b may have been refined already for the balance of another block
+    if (blocks[b].is_leaf() && blocks[b].level < max_lev
+        && blocks[b].indicator > refine_tol)
+    {
+      refine(b);
+      changed = true;
+    }
+  }
+  // Coarsen from the finest level, so that the balance can be checked with
+  // the mesh as it will be
+  for (int level = max_lev - 1; level >= 0; level--)
+    for (unsigned int b = 0; b < blocks.size(); b++)
+    {
+      const AMR_Block &block = blocks[b];
+      if (!block.active || block.level != level || block.is_leaf())
+        continue;
+      bool smooth = true;
+      for (int c = 0; c < 4; c++)
+      {
+        const AMR_Block &child = blocks[block.child[c]];
+        smooth = smooth && child.is_leaf() && child.indicator >= 0.0
+                 && child.indicator < 0.25*refine_tol;
+      }
+      // The blocks around must not have leaves finer than level + 1
+      for (int dj = -1; dj <= 1 && smooth; dj++)
+        for (int di = -1; di <= 1 && smooth; di++)
+        {
+          if (!inside(level, block.bi+di, block.bj+dj))
+            continue;
+          const AMR_Block &next = blocks[find(level, block.bi+di,
+                                              block.bj+dj)];
+          if (next.level == level && !next.is_leaf())
+            for (int c = 0; c < 4; c++)
+              smooth = smooth && blocks[next.child[c]].is_leaf();
+        }
+      if (smooth)
+      {
+        coarsen(b);
+        changed = true;
+      }
+    }
+  if (changed)
+    make_leaf_list();
+  return changed;
+}
+
+void AMR_Grid2D::set_values(double (*value)(double x, double y),
+                            double refine_tol)
+{
+  for (int pass = 0; pass <= max_lev + 1; pass++)
+  {
+    for (unsigned int n = 0; n < leaf_list.size(); n++)
+    {
+      AMR_Block &block = blocks[leaf_list[n]];
+      for (int j = 0; j < bs; j++)
+        for (int i = 0; i < bs; i++)
+          block.u(i,j) = (*value)(x(block.level, block.bi*bs + i),
+                                  y(block.level, block.bj*bs + j));
+    }
+    if (pass == max_lev + 1)
+      break;
+    fill_ghosts(0.0);
+    compute_indicators();
+    if (regrid(refine_tol) == false)
+      break;
+  }
+}
+
+void AMR_Grid2D::reflux(double dt)
+{
+  const int half = bs/2;
+  for (unsigned int n = 0; n < leaf_list.size(); n++)
+  {
+    AMR_Block &block = blocks[leaf_list[n]];
+    const int level = block.level;
+    const double lam_x = dt/dx(level), lam_y = dt/dy(level);
+    for (int s = 0; s < 4; s++)
+    {
+      const int di = (s == amr_east) - (s == amr_west);
+      const int dj = (s == amr_north) - (s == amr_south);
+      if (!inside(level, block.bi+di, block.bj+dj))
+        continue;
+      const AMR_Block &next = blocks[find(level, block.bi+di, block.bj+dj)];
+      if (next.level != level || next.is_leaf())
+        continue;
+      // The two children of next along the face, their face_flux on the
+      // opposite side (west <-> east, south <-> north) has 2 fine faces for
+      // each coarse face
+      for (int k = 0; k < 2; k++)
+      {
+        int c;
+        if (s == amr_east || s == amr_west)
+          c = (s == amr_east ? 0 : 1) + 2*k;
+        else
+          c = k + 2*(s == amr_north ? 0 : 1);
+        const vector<double> &fine = blocks[next.child[c]].face_flux[s^1];
+        for (int q = 0; q < half; q++)
+        {
+          const int m = k*half + q;
+          const double d_flux = 0.5*(fine[2*q] + fine[2*q+1])
+                                - block.face_flux[s][m];
+          block.face_flux[s][m] += d_flux;
+          if (s == amr_east)
+            block.u(bs-1,m) -= lam_x*d_flux;
+          else if (s == amr_west)
+            block.u(0,m)    += lam_x*d_flux;
+          else if (s == amr_north)
+            block.u(m,bs-1) -= lam_y*d_flux;
+          else
+            block.u(m,0)    += lam_y*d_flux;
+        }
+      }
+    }
+  }
+}
+
+void AMR_Grid2D::add_leaves(int b)
+{
+  if (blocks[b].is_leaf())
+  {
+    leaf_list.push_back(b);
+    return;
+  }
+  for (int c = 0; c < 4; c++)
+    add_leaves(blocks[b].child[c]);
+}
+
+// The leaves of each root in Z order, so that neighbours are mostly close in
+// the list
+void AMR_Grid2D::make_leaf_list()
+{
+  leaf_list.clear();
+  for (unsigned int r = 0; r < roots.size(); r++)
+    add_leaves(roots[r]);
+}
+
+long AMR_Grid2D::n_cells() const
+{
+  return long(leaf_list.size())*bs*bs;
+}
+
+void AMR_Grid2D::write_vtk(double t, int c, string base_name) const
+{
+  const long n = n_cells();
+  ofstream fout(get_filename(base_name, 3, c));
+  fout << "# vtk DataFile Version 3.0" << endl;
+  fout << "Block structured adaptive grid" << endl;
+  fout << "ASCII" << endl;
+  fout << "DATASET UNSTRUCTURED_GRID" << endl;
+  fout << "FIELD FieldData 2" << endl;
+  fout << "TIME 1 1 double" << endl;
+  fout << t << endl;
+  fout << "CYCLE 1 1 int" << endl;
+  fout << c << endl;
+  // 4 points for each cell, the cells do not share points
+  fout << "POINTS " << 4*n << " float" << endl;
+  for (unsigned int l = 0; l < leaf_list.size(); l++)
+  {
+    const AMR_Block &block = blocks[leaf_list[l]];
+    const double h_x = dx(block.level), h_y = dy(block.level);
+    for (int j = 0; j < bs; j++)
+      for (int i = 0; i < bs; i++)
+      {
+        const double x0 = x(block.level, block.bi*bs + i) - 0.5*h_x;
+        const double y0 = y(block.level, block.bj*bs + j) - 0.5*h_y;
+        fout << x0 << " " << y0 << " 0 " << x0 + h_x << " " << y0 << " 0 "
+             << x0 + h_x << " " << y0 + h_y << " 0 "
+             << x0 << " " << y0 + h_y << " 0" << endl;
+      }
+  }
+  fout << "CELLS " << n << " " << 5*n << endl;
+  for (long k = 0; k < n; k++)
+    fout << "4 " << 4*k << " " << 4*k+1 << " " << 4*k+2 << " " << 4*k+3
+         << endl;
+  fout << "CELL_TYPES " << n << endl;
+  for (long k = 0; k < n; k++)
+    fout << "9" << endl; // VTK_QUAD
+  fout << "CELL_DATA " << n << endl;
+  fout << "SCALARS density float" << endl;
+  fout << "LOOKUP_TABLE default" << endl;
+  for (unsigned int l = 0; l < leaf_list.size(); l++)
+  {
+    const AMR_Block &block = blocks[leaf_list[l]];
+    for (int j = 0; j < bs; j++)
+    {
+      for (int i = 0; i < bs; i++)
+        fout << block.u(i,j) << " ";
+      fout << endl;
+    }
+  }
+  fout << "SCALARS level int" << endl;
+  fout << "LOOKUP_TABLE default" << endl;
+  for (unsigned int l = 0; l < leaf_list.size(); l++)
+    for (int k = 0; k < bs*bs; k++)
+      fout << blocks[leaf_list[l]].level << "\n";
+}
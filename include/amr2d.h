@@ -0,0 +1,130 @@
+#ifndef __AMR2D_H__
+#define __AMR2D_H__
+
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cassert>
+
+#include "array2d.h"
+
+using namespace std;
+
+// Block-structured adaptive mesh on a rectangle. The domain is covered by
+// nb_x x nb_y blocks of block_size x block_size cells at level 0, and a block
+// is refined by replacing it with 4 blocks of the same size at the next
+// level, which have half the dx and dy. The solution lives on the leaves, the
+// blocks which are not refined, in an Array2D with ghost layers.
+//
+// Cell (i,j) of level l is the cell i,j of the uniform grid of level l, with
+// nb_x*block_size*2^l x nb_y*block_size*2^l cells. Leaves sharing a face or
+// a corner differ by at most one level (2:1 balance).
+//
+// The values are cell averages. Going to a coarser level (restriction) is the
+// average of the 4 fine cells and going to a finer level (prolongation) uses
+// minmod limited slopes, so both conserve the integral of the solution.
+//
+// A time step of a finite volume scheme on the leaves is
+//   grid.fill_ghosts(t);
+//   for each leaf b: compute the fluxes with blocks[b].u and its ghosts,
+//                    update blocks[b].u and put the fluxes on the faces of
+//                    the block in blocks[b].face_flux
+//   grid.reflux(dt);
+// reflux corrects the coarse cells next to finer leaves, so that the flux
+// through a coarse-fine face is the one of the fine faces, and the scheme
+// conserves the integral of the solution.
+
+// Sides of a block, in the order of AMR_Block::face_flux
+enum AMR_Side {amr_west = 0, amr_east = 1, amr_south = 2, amr_north = 3};
+
+class AMR_Block
+{
+public:
+  int level;
+  int bi, bj; // The block covers the cells bi*block_size + i, i < block_size,
+              // bj*block_size + j of its level
+  int parent;
+  int child[4]; // Child ci + 2*cj covers the cells 2*bi + ci, 2*bj + cj of
+                // blocks of level + 1. -1 for a leaf
+  bool active;  // False for blocks that were coarsened away
+  Array2D u;
+  // Fluxes through the faces of the block, face_flux[amr_west][j] is the
+  // x flux at the face left of cell (0,j), face_flux[amr_north][i] the y flux
+  // at the face above cell (i,block_size-1), in the direction of the axis
+  vector<double> face_flux[4];
+  double indicator; // For refinement, set by compute_indicators
+
+  bool is_leaf() const { return child[0] == -1; }
+};
+
+class AMR_Grid2D
+{
+public:
+  // boundary_value(x,y,t) gives the values outside the domain, used for the
+  // ghosts of blocks at the boundary
+  AMR_Grid2D(double xmin, double xmax, double ymin, double ymax,
+             int nb_x, int nb_y, int block_size, int max_level, int ng,
+             double (*boundary_value)(double x, double y, double t));
+
+  double dx(int level) const;
+  double dy(int level) const;
+  double x(int level, int i) const; // Centre of cell (i,j) of level
+  double y(int level, int j) const;
+  int block_size() const { return bs; }
+  int max_level() const { return max_lev; }
+  int finest_level() const; // Of the leaves
+
+  // Sets the leaves to value(x,y) at the cell centres, refining where
+  // compute_indicators asks for it until the mesh stops changing
+  void set_values(double (*value)(double x, double y), double refine_tol);
+
+  // Fills the ghosts of all leaves with the values of the neighbouring
+  // leaves at the same level, prolonged from a coarser level or restricted
+  // from a finer level, or with boundary_value at time t outside the domain
+  void fill_ghosts(double t);
+  // Value of cell (i,j) of level l, from the leaves covering it
+  double value(int level, int i, int j) const;
+
+  // Largest undivided difference of each leaf, needs the ghosts
+  void compute_indicators();
+  // Refines leaves with indicator > refine_tol, and coarsens 4 leaves with
+  // indicator < refine_tol/4 into their parent. The ghosts of the new leaves
+  // are not set. Returns true if the mesh changed.
+  bool regrid(double refine_tol);
+
+  // Corrects the coarse cells along coarse-fine faces, after an update with
+  // time step dt which stored the face_flux of all leaves
+  void reflux(double dt);
+
+  const vector<int>& leaves() const { return leaf_list; }
+  long n_cells() const; // Number of cells of the leaves
+
+  // Legacy vtk file with one quad per cell of the leaves, with the solution
+  // and the level, named get_filename(base_name, 3, c)
+  void write_vtk(double t, int c, string base_name) const;
+
+  vector<AMR_Block> blocks;
+
+private:
+  int find(int level, int bi, int bj) const;  // Deepest block covering block
+                                              // (bi,bj) of level
+  bool inside(int level, int bi, int bj) const;
+  // Value at the quarter (ci,cj) of cell (i,j) of level
+  double prolonged(int level, int i, int j, int ci, int cj) const;
+  int new_block(int level, int bi, int bj, int parent);
+  void refine(int b);
+  void coarsen(int b);
+  void add_leaves(int b);
+  void make_leaf_list();
+
+  double xmin, xmax, ymin, ymax;
+  int nb_x, nb_y, bs, max_lev, ng;
+  double (*boundary_value)(double x, double y, double t);
+  double t_boundary; // Time of boundary_value
+  vector<int> roots;      // Level 0 blocks, bi + bj*nb_x
+  vector<int> free_list;  // Inactive blocks that can be reused
+  vector<int> leaf_list;
+};
+
+#endif
@@ -3,6 +3,7 @@
 #include <iomanip> //Used to define setw
 //https://stdcxx.apache.org/doc/stdlibref/iomanip-h.html#:~:text=The%20header%20is%20part,the%20state%20of%20iostream%20objects.
 #include <cassert>
+#include <algorithm>
 #include "array2d.h"
 
 using namespace std;
@@ -76,6 +77,12 @@ int Array2D::sizey() const
    return ny;
 }
 
+// return number of ghost layers on each side
+int Array2D::n_ghost() const
+{
+   return ng;
+}
+
 // Return value at (i,j), this is read only(Note the absence of &)
 double Array2D::operator() (const int i, const int j) const
 {
@@ -129,23 +136,26 @@ Array2D& Array2D::operator= (const Array2D& a)
    return *this;
 }
 
+// x first on the rows of the grid, then y over whole rows (ghosts included),
+// so the corners are filled too. Needs ng <= nx, ny.
 void Array2D::update_fluff()
 {
-  (*this)(-1,-1)= 0.0;
-  (*this)(-1,-1)= (*this)(nx-1,ny-1);
-  (*this)(nx,ny)  = (*this)(0,0);
-  (*this)(nx,-1) = (*this)(0,ny-1);
-  (*this)(-1,ny) = (*this)(nx-1,0);
-  for (int j = 0; j<ny;j++) //not doing corners
+  for (int j = 0; j < ny; j++)
   {
-    (*this)(-1,j)   = (*this)(nx-1,j);
-    (*this)(nx,j)  = (*this)(0,j);
+    double *row = &u[a + j*b];
+    for (int g = 1; g <= ng; g++)
+    {
+      row[-g]     = row[nx-g];
+      row[nx-1+g] = row[g-1];
+    }
   }
-  //j = -1, N
-  for (int i = 0; i<nx;i++)  //not doing corners
+  for (int g = 1; g <= ng; g++)
   {
-    (*this)(i,-1) = (*this)(i,ny-1);
-    (*this)(i,ny)  = (*this)(i,0);
+    // Row j starts at (-ng,j)
+    copy(&u[a - ng + (ny-g)*b], &u[a - ng + (ny-g)*b] + b,
+         &u[a - ng - g*b]);
+    copy(&u[a - ng + (g-1)*b], &u[a - ng + (g-1)*b] + b,
+         &u[a - ng + (ny-1+g)*b]);
   }
 }
 
@@ -25,10 +25,18 @@ public:
 
    int sizex() const;
    int sizey() const;
+   int n_ghost() const;
    double  operator()(const int i, const int j) const;
    double& operator()(const int i, const int j);
+   // Raw access for vectorized kernels, like Array3D. ptr(i,j) points to the
+   // value at (i,j), the rows j are contiguous and stride() is the distance
+   // between (i,j) and (i,j+1).
+   double* ptr(const int i, const int j) { return &u[a + i + j*b]; }
+   const double* ptr(const int i, const int j) const { return &u[a + i + j*b]; }
+   int stride() const { return b; }
    Array2D& operator= (const double scalar);
    Array2D& operator= (const Array2D& u);
+   // Periodic ghost values in both directions, all ng layers
    void update_fluff();
    //Overloads '<<', combining it with cout prints array without ghost cells
    //Question - Why is it inside the class?
@@ -60,4 +68,27 @@ private:
 };
 
 
+// Read only view of a 2D field stored elsewhere, with (i,j) at
+// data[i*stride_i + j*stride_j]. For passing an Array2D or one component of a
+// MultiArray2D (include/array2d_multi.h) to the vtk writers without copying.
+class Array2D_View
+{
+public:
+  Array2D_View(const double *data, const int nx, const int ny,
+               const int stride_i, const int stride_j)
+  : data(data), nx(nx), ny(ny), stride_i(stride_i), stride_j(stride_j) {}
+  Array2D_View(const Array2D &u)
+  : data(u.ptr(0,0)), nx(u.sizex()), ny(u.sizey()), stride_i(1),
+    stride_j(u.stride()) {}
+  int sizex() const { return nx; }
+  int sizey() const { return ny; }
+  double operator()(const int i, const int j) const
+  {
+    return data[i*stride_i + j*stride_j];
+  }
+private:
+  const double *data;
+  int nx, ny, stride_i, stride_j;
+};
+
 #endif
@@ -0,0 +1,154 @@
+#ifndef __ARRAY2D_MULTI_H__
+#define __ARRAY2D_MULTI_H__
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+
+#include "array2d.h"
+
+using namespace std;
+
+// Memory layout of the components of a MultiArray2D
+//   layout_aos: the nvar values of a cell are next to each other
+//               (interleaved), so a flux that needs all of them at a cell
+//               reads one cache line
+//   layout_soa: one Array2D-like plane per component, so that a loop over i
+//               of one component is contiguous and vectorizes
+enum Multi_Layout {layout_aos = 0, layout_soa = 1};
+
+// nvar fields on the same nx x ny grid with ng ghost layers, for systems
+// like the Euler or shallow water equations. Component v of cell (i,j) is
+// u(i,j,v), with the same (i,j) as Array2D, and the ghosts of all components
+// are filled by one update_fluff.
+//
+// The layout is a template parameter, so that operator() has no branch and the
+// same kernel can be compiled for both layouts. For raw loops, ptr(i,j,v)
+// points to u(i,j,v), cell_stride() is the distance to u(i+1,j,v), stride()
+// to u(i,j+1,v) and var_stride() to u(i,j,v+1).
+//
+// component(v) is a read only view of one component, without copying, for
+// the vtk writers of vtk_anim.h.
+template <int nvar, Multi_Layout layout = layout_soa>
+class MultiArray2D
+{
+public:
+  MultiArray2D() : nx(0), ny(0), ng(0) { set_strides(); }
+  MultiArray2D(const int nx, const int ny, const int ng = 0)
+  : nx(nx), ny(ny), ng(ng)
+  {
+    set_strides();
+  }
+  void resize(const int nx1, const int ny1, const int ng1)
+  {
+    nx = nx1, ny = ny1, ng = ng1;
+    set_strides();
+  }
+
+  int sizex() const { return nx; }
+  int sizey() const { return ny; }
+  int n_ghost() const { return ng; }
+  static int n_var() { return nvar; }
+
+  double operator()(const int i, const int j, const int v) const
+  {
+    return u[index(i,j,v)];
+  }
+  double& operator()(const int i, const int j, const int v)
+  {
+    return u[index(i,j,v)];
+  }
+  double* ptr(const int i, const int j, const int v)
+  {
+    return &u[index(i,j,v)];
+  }
+  const double* ptr(const int i, const int j, const int v) const
+  {
+    return &u[index(i,j,v)];
+  }
+  static int cell_stride() { return (layout == layout_aos) ? nvar : 1; }
+  int stride() const { return b*cell_stride(); }
+  int var_stride() const { return (layout == layout_aos) ? 1 : plane; }
+
+  Array2D_View component(const int v) const
+  {
+    return Array2D_View(ptr(0,0,v), nx, ny, cell_stride(), stride());
+  }
+
+  MultiArray2D& operator= (const double scalar)
+  {
+    fill(u.begin(), u.end(), scalar);
+    return *this;
+  }
+
+  // Periodic ghost values in both directions, all ng layers of all
+  // components. Needs ng <= nx, ny.
+  void update_fluff()
+  {
+    if (layout == layout_aos)
+      update_fluff_plane<nvar>(&u[a*nvar]);
+    else
+      for (int v = 0; v < nvar; v++)
+        update_fluff_plane<1>(&u[v*plane + a]);
+  }
+
+private:
+  int index(const int i, const int j, const int v) const
+  {
+#ifdef DEBUG
+    if (i >= nx + ng || j >= ny + ng || i < -ng || j < -ng || v < 0 ||
+        v >= nvar)
+    {
+      cout << "Attempt to access non-existent array entries" << endl;
+      cout << "Array has rows, columns, components of sizes " << nx << ","
+           << ny << "," << nvar << endl;
+      cout << "Ghost layer is of size " << ng << endl;
+      cout << "Tried to access " << i << "," << j << "," << v << endl;
+      assert(false);
+    }
+#endif
+    if (layout == layout_aos)
+      return (a + i + j*b)*nvar + v;
+    else
+      return v*plane + a + i + j*b;
+  }
+
+  void set_strides()
+  {
+    b = nx + 2*ng;
+    a = ng*b + ng;
+    plane = (nx + 2*ng)*(ny + 2*ng);
+    u.resize(nvar*plane);
+  }
+
+  // Same as Array2D::update_fluff, on a plane where the value of (i,j) is the
+  // w doubles at p[(i + j*b)*w]
+  template <int w>
+  void update_fluff_plane(double *p)
+  {
+    for (int j = 0; j < ny; j++)
+    {
+      double *row = p + j*b*w;
+      for (int g = 1; g <= ng; g++)
+      {
+        copy(row + (nx-g)*w, row + (nx-g+1)*w, row - g*w);
+        copy(row + (g-1)*w, row + g*w, row + (nx-1+g)*w);
+      }
+    }
+    for (int g = 1; g <= ng; g++)
+    {
+      copy(p + (-ng + (ny-g)*b)*w, p + (-ng + (ny-g+1)*b)*w,
+           p + (-ng - g*b)*w);
+      copy(p + (-ng + (g-1)*b)*w, p + (-ng + g*b)*w,
+           p + (-ng + (ny-1+g)*b)*w);
+    }
+  }
+
+  int nx, ny, ng;
+  int a, b;  // Cell (i,j) is a + i + j*b, as in Array2D
+  int plane; // Cells of one component, ghosts included
+  vector<double> u;
+};
+
+#endif
@@ -1,5 +1,7 @@
-// Idea - (a,b,c) |-> a+nx*b+n*ny*c is a bijective map b/w
-// (0,nx)*(0,ny)*(0,nz) and (0,nx*ny*nz)
+// Idea - (a,b,c) |-> offset + a*si + b*sj + c*sk is an injective map from
+// (-ng,nx+ng)*(-ng,ny+ng)*(-ng,nz+ng) to (0,n). Along the fastest index, a
+// line is padded so that index 0 and the start of every line fall on a
+// cache line.
 #include <iostream>
 #include "array3d.h"
 
@@ -11,33 +13,70 @@ Array3D::Array3D ()
 nx (0),
 ny (0),
 nz (0),
-n  (0)
+ng (0),
+layout (k_fastest)
 {
+  set_strides();
 }
 
 // Constructor based on size
-Array3D::Array3D (const int nx, const int ny, const int nz)
+Array3D::Array3D (const int nx, const int ny, const int nz,
+                  const int ng, const Layout layout)
 :
 nx (nx),
 ny (ny),
 nz (nz),
-n  (nx*ny*nz),
-u  (nx*ny*nz)
+ng (ng),
+layout (layout)
 {
 #if defined(DEBUG)
-   if(nx < 0 || ny < 0 || nz < 0)
+   if(nx < 0 || ny < 0 || nz < 0 || ng < 0)
    {
       cout << "Dimensions cannot be negative" << endl;
       exit(0);
    }
 #endif
+   set_strides();
+   u.resize(n);
 }
 
-// Change size of array
+// Rounds m up to a multiple of ARRAY3D_ALIGN
+static int round_up(const int m)
+{
+  return ((m + ARRAY3D_ALIGN - 1) / ARRAY3D_ALIGN) * ARRAY3D_ALIGN;
+}
+
+// Computes offset, strides and storage size from sizes and layout
+void Array3D::set_strides()
+{
+  const int n_fast = (layout == k_fastest) ? nz : nx;
+  const int pad  = round_up(ng);                // position of index 0 in a line
+  const int line = round_up(pad + n_fast + ng); // stored length of a line
+  if (layout == k_fastest)
+  {
+    sk = 1, sj = line, si = line * (ny + 2*ng);
+    offset = ng*si + ng*sj + pad;
+    n = si * (nx + 2*ng);
+  }
+  else
+  {
+    si = 1, sj = line, sk = line * (ny + 2*ng);
+    offset = ng*sk + ng*sj + pad;
+    n = sk * (nz + 2*ng);
+  }
+}
+
+// Change size of array, keeping same ghost cell sizes.
 void Array3D::resize(const int nx1, const int ny1, const int nz1)
+{
+   resize(nx1, ny1, nz1, ng);
+}
+
+void Array3D::resize(const int nx1, const int ny1, const int nz1,
+                     const int ng1)
 {
 #if defined(DEBUG)
-   if(nx1 < 0 || ny1 < 0)
+   if(nx1 < 0 || ny1 < 0 || nz1 < 0 || ng1 < 0)
    {
       cout << "Dimensions cannot be negative" << endl;
       exit(0);
@@ -46,10 +85,23 @@ void Array3D::resize(const int nx1, const int ny1, const int nz1)
    nx = nx1;
    ny = ny1;
    nz = nz1;
-   n  = nx1 * ny1 * nz1;
+   ng = ng1;
+   set_strides();
    u.resize (n);
 }
 
+void Array3D::check_index(const int i, const int j, const int k) const
+{
+  if(i < -ng || i > nx+ng-1 || j < -ng || j > ny+ng-1 || k < -ng || k > nz+ng-1)
+  {
+    cout << "Indices out of range" << endl;
+    cout << "Array has sizes " << nx << ", " << ny << ", " << nz << endl;
+    cout << "Ghost layer is of size " << ng << endl;
+    cout << "i, j, k = " << i << ", " << j << ", " << k << endl;
+    assert(false);
+  }
+}
+
 // return number of rows, size of first index
 int Array3D::sizex() const
 {
@@ -65,4 +117,42 @@ int Array3D::sizey() const
 int Array3D::sizez() const
 {
    return nz;
-}
\ No newline at end of file
+}
+
+int Array3D::n_ghost() const
+{
+   return ng;
+}
+
+Array3D::Layout Array3D::get_layout() const
+{
+   return layout;
+}
+
+// The directions are done one after the other, each over the full extent
+// (ghosts included) of the previous ones, so edges and corners are filled.
+// Needs ng <= nx, ny, nz.
+void Array3D::update_fluff()
+{
+  for (int j = 0; j < ny; j++)
+    for (int k = 0; k < nz; k++)
+      for (int g = 1; g <= ng; g++)
+      {
+        (*this)(-g,j,k)     = (*this)(nx-g,j,k);
+        (*this)(nx-1+g,j,k) = (*this)(g-1,j,k);
+      }
+  for (int i = -ng; i < nx+ng; i++)
+    for (int k = 0; k < nz; k++)
+      for (int g = 1; g <= ng; g++)
+      {
+        (*this)(i,-g,k)     = (*this)(i,ny-g,k);
+        (*this)(i,ny-1+g,k) = (*this)(i,g-1,k);
+      }
+  for (int i = -ng; i < nx+ng; i++)
+    for (int j = -ng; j < ny+ng; j++)
+      for (int g = 1; g <= ng; g++)
+      {
+        (*this)(i,j,-g)     = (*this)(i,j,nz-g);
+        (*this)(i,j,nz-1+g) = (*this)(i,j,g-1);
+      }
+}
@@ -1,5 +1,5 @@
-#ifndef __ARRAY2D_H__
-#define __ARRAY2D_H__
+#ifndef __ARRAY3D_H__
+#define __ARRAY3D_H__
 
 #include <vector>
 #include <iostream>
@@ -7,46 +7,89 @@
 #include <iomanip> //Used to define setw
 //https://stdcxx.apache.org/doc/stdlibref/iomanip-h.html#:~:text=The%20header%20is%20part,the%20state%20of%20iostream%20objects.
 #include <cassert>
+#include <new> // std::align_val_t
 
 using namespace std;
 
-// TODO - Add ghost cells
+// Values are aligned to cache lines of 64 bytes = 8 doubles
+#define ARRAY3D_ALIGN 8
+
+// Allocator giving std::vector memory that starts on a cache line
+template <typename T>
+struct AlignedAllocator
+{
+  typedef T value_type;
+  AlignedAllocator() {}
+  template <typename U> AlignedAllocator(const AlignedAllocator<U>&) {}
+  T* allocate(size_t n)
+  {
+    return static_cast<T*>(::operator new(n*sizeof(T),
+                                          std::align_val_t(64)));
+  }
+  void deallocate(T* p, size_t)
+  {
+    ::operator delete(p, std::align_val_t(64));
+  }
+};
+template <typename T, typename U>
+bool operator==(const AlignedAllocator<T>&, const AlignedAllocator<U>&)
+{ return true; }
+template <typename T, typename U>
+bool operator!=(const AlignedAllocator<T>&, const AlignedAllocator<U>&)
+{ return false; }
 
 class Array3D
 {
 public:
+   // Which index runs fastest in memory. k_fastest is C order and makes
+   // the lines (i,j,:) contiguous, i_fastest is the order of Array2D.
+   enum Layout {k_fastest, i_fastest};
+
    Array3D(); //Empty constructor declared
-   Array3D(const int nx, const int ny, const int nz);
+   Array3D(const int nx, const int ny, const int nz,
+           const int ng = 0/*Default value*/,
+           const Layout layout = k_fastest);
    void resize (const int nx, const int ny, const int nz);
+   void resize (const int nx, const int ny, const int nz, const int ng);
    int sizex() const;
    int sizey() const;
    int sizez() const;
-   // Return value at (i,j), this is read only
+   int n_ghost() const;
+   Layout get_layout() const;
+   // Return value at (i,j,k), this is read only
+   // Indices go from -ng to nx+ng-1, etc.
   double operator() (const int i, const int j, const int k) const
   {
   #if defined(DEBUG)
-    if(i < 0 || i > nx-1 || j < 0 || j > ny-1 || k < 0 || k > nz - 1)
-    {
-        cout << "Indices out of range" << endl;
-        cout << "i, j = " << i << ", " << j << endl;
-        exit(0);
-    }
+    check_index(i,j,k);
   #endif
-    return u[i*ny*nz + j*nz + k]; // TODO - Reorder so that k is the fastest index
+    return u[offset + i*si + j*sj + k*sk];
   }
-   // Return reference to (i,j), this can modify the value
+   // Return reference to (i,j,k), this can modify the value
   double& operator() (const int i, const int j, const int k)
   {
   #if defined(DEBUG)
-    if(i < 0 || i > nx-1 || j < 0 || j > ny-1 || k < 0 || k > nz-1)
-    {
-        cout << "Indices out of range" << endl;
-        cout << "i, j = " << i << ", " << j << endl;
-        exit(0);
-    }
+    check_index(i,j,k);
   #endif
-    return u[i*ny*nz + j*nz + k];
+    return u[offset + i*si + j*sj + k*sk];
   }
+   // Raw access for vectorized kernels and MPI buffers.
+   // data() is the start of the storage (ghosts and padding included),
+   // ptr(i,j,k) points to the value at (i,j,k) and stride(d) is the distance
+   // between neighbours along index d = 0,1,2 (i,j,k).
+   double* data() { return u.data(); }
+   const double* data() const { return u.data(); }
+   double* ptr(const int i, const int j, const int k)
+   { return u.data() + offset + i*si + j*sj + k*sk; }
+   const double* ptr(const int i, const int j, const int k) const
+   { return u.data() + offset + i*si + j*sj + k*sk; }
+   int stride(const int d) const { return (d == 0) ? si : ((d == 1) ? sj : sk); }
+   // Planes of the slowest index (i for k_fastest, k for i_fastest) are
+   // contiguous. slab(l) points to the start of plane l, ghosts included,
+   // and slab_size() is the number of stored values in a plane.
+   double* slab(const int l)
+   { return u.data() + (l+ng)*slab_size(); }
+   int slab_size() const { return (layout == k_fastest) ? si : sk; }
    // Set all elements to scalar value
   Array3D& operator= (const double scalar)
   {
@@ -58,15 +101,20 @@ public:
   Array3D& operator= (const Array3D& a)
   {
   #if defined(DEBUG)
-    if(nx != a.sizex() || ny != a.sizey())
+    if(nx != a.sizex() || ny != a.sizey() || nz != a.sizez())
     {
         cout << "Array sizes do not match" << endl;
         exit(0);
     }
   #endif
+    nx = a.nx, ny = a.ny, nz = a.nz, ng = a.ng, layout = a.layout;
+    n = a.n, offset = a.offset, si = a.si, sj = a.sj, sk = a.sk;
     u = a.u;
     return *this;
   }
+   // Periodic ghost values in all directions, like Array2D::update_fluff
+   void update_fluff();
+   //Prints array without ghost cells
     friend std::ostream& operator<< (std::ostream&  os,
                                      const Array3D& A)
     {
@@ -80,8 +128,14 @@ public:
       return os;
     }
 private:
-   int nx, ny, nz, n;
-   std::vector<double> u;
+   void set_strides();
+   void check_index(const int i, const int j, const int k) const;
+   // nx, ny, nz are sizes without the ng ghost layers on each side.
+   // A(i,j,k) = u[offset + i*si + j*sj + k*sk], n = size of u with padding
+   int nx, ny, nz, ng, n;
+   Layout layout;
+   int offset, si, sj, sk;
+   std::vector<double, AlignedAllocator<double> > u;
 };
 
 
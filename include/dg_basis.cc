@@ -0,0 +1,74 @@
+#include <cmath>
+#include <iostream>
+#include <cassert>
+#include "dg_basis.h"
+
+using namespace std;
+
+// P_n(x), with P_n'(x) in dp, from the three term recurrence
+static double legendre(int n, double x, double &dp)
+{
+  double p0 = 1.0, p1 = x;
+  for (int k = 2; k <= n; k++)
+  {
+    const double p2 = ((2*k - 1)*x*p1 - (k - 1)*p0)/k;
+    p0 = p1, p1 = p2;
+  }
+  dp = n*(x*p1 - p0)/(x*x - 1.0);
+  return p1;
+}
+
+DG_Basis_1d::DG_Basis_1d(int degree)
+:
+n(degree + 1), nodes(n), weights(n), derivative(n*n), left(n), right(n)
+{
+  assert(degree >= 0);
+  // Roots of P_n by Newton's method, from the Chebyshev points
+  for (int a = 0; a < n; a++)
+  {
+    double x = -cos(M_PI*(a + 0.75)/(n + 0.5)), dp;
+    for (int iter = 0; iter < 100; iter++)
+    {
+      const double dx = legendre(n, x, dp)/dp;
+      x -= dx;
+      if (abs(dx) < 1e-15)
+        break;
+    }
+    legendre(n, x, dp);
+    nodes[a] = x;
+    weights[a] = 2.0/((1.0 - x*x)*dp*dp);
+  }
+  for (int a = 0; a < n; a++)
+  {
+    left[a] = lagrange(a, -1.0), right[a] = lagrange(a, 1.0);
+    // l_a'(xi_c) = l_a(xi_c) sum_{k != a} 1/(xi_c - xi_k), which at c != a
+    // is the product without the factor k = c
+    for (int c = 0; c < n; c++)
+    {
+      double d = 0.0;
+      if (c == a)
+        for (int k = 0; k < n; k++)
+        {
+          if (k != a)
+            d += 1.0/(nodes[a] - nodes[k]);
+        }
+      else
+      {
+        d = 1.0/(nodes[a] - nodes[c]);
+        for (int k = 0; k < n; k++)
+          if (k != a && k != c)
+            d *= (nodes[c] - nodes[k])/(nodes[a] - nodes[k]);
+      }
+      derivative[a*n + c] = d;
+    }
+  }
+}
+
+double DG_Basis_1d::lagrange(int a, double xi) const
+{
+  double l = 1.0;
+  for (int k = 0; k < n; k++)
+    if (k != a)
+      l *= (xi - nodes[k])/(nodes[a] - nodes[k]);
+  return l;
+}
@@ -0,0 +1,26 @@
+#ifndef __DG_BASIS_H__
+#define __DG_BASIS_H__
+
+#include <vector>
+
+using namespace std;
+
+// Nodal basis of degree p on the reference interval [-1,1]: the Lagrange
+// polynomials l_a of the n = p+1 Gauss-Legendre points xi_a. The quadrature
+// on the same points is exact for degree 2n-1, so the mass matrix of the
+// basis is diag(weights). The 2D basis of a cell is the tensor product
+// l_a(xi) l_b(eta), so that the DG operators are 1D matrices applied along
+// each direction (sum factorization).
+struct DG_Basis_1d
+{
+  DG_Basis_1d(int degree);
+  // l_a(xi)
+  double lagrange(int a, double xi) const;
+
+  int n;
+  vector<double> nodes, weights;
+  vector<double> derivative;  // derivative[a*n + c] = l_a'(xi_c)
+  vector<double> left, right; // l_a(-1), l_a(1)
+};
+
+#endif
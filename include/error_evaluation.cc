@@ -0,0 +1,126 @@
+#include <cmath>
+#include <vector>
+#include <iostream>
+#include <string>
+#include <random>
+#include <cstdio>
+#include <cassert>
+#include "error_evaluation.h"
+
+using namespace std;
+
+Error_Accumulator::Error_Accumulator()
+{
+  reset();
+}
+
+void Error_Accumulator::reset()
+{
+  sum_1 = sum_2 = sum_4 = max_e = 0.0;
+  n = 0;
+}
+
+void Error_Accumulator::add(double u, double v)
+{
+  const double e = abs(u - v), e2 = e*e;
+  sum_1 += e, sum_2 += e2, sum_4 += e2*e2;
+  max_e = max(max_e, e);
+  n += 1;
+}
+
+void Error_Accumulator::add(int n_points, const double u[], const double v[])
+{
+  // Local sums, so that they stay in registers
+  double s1 = 0.0, s2 = 0.0, s4 = 0.0, m = max_e;
+  for (int k = 0; k < n_points; k++)
+  {
+    const double e = abs(u[k] - v[k]), e2 = e*e;
+    s1 += e, s2 += e2, s4 += e2*e2;
+    m = (e > m) ? e : m;
+  }
+  sum_1 += s1, sum_2 += s2, sum_4 += s4, max_e = m;
+  n += n_points;
+}
+
+Error_Norms Error_Accumulator::norms(bool sampled) const
+{
+  Error_Norms norms;
+  norms.n_cells = n;
+  norms.sampled = sampled;
+  norms.l1 = norms.l2 = norms.linfty = norms.l1_ci = norms.l2_ci = 0.0;
+  if (n == 0)
+    return norms;
+  const double mean_1 = sum_1 / n, mean_2 = sum_2 / n;
+  norms.l1 = mean_1;
+  norms.l2 = sqrt(mean_2);
+  norms.linfty = max_e;
+  if (sampled && n > 1)
+  {
+    // Standard errors of the sample means of |e| and e^2, and for
+    // l2 = sqrt(mean of e^2) the delta method, d sqrt(x) = dx / (2 sqrt(x))
+    const double var_1 = max(0.0, (sum_2 - n*mean_1*mean_1) / (n - 1));
+    const double var_2 = max(0.0, (sum_4 - n*mean_2*mean_2) / (n - 1));
+    norms.l1_ci = 1.96 * sqrt(var_1 / n);
+    if (norms.l2 > 0.0)
+      norms.l2_ci = 1.96 * sqrt(var_2 / n) / (2.0 * norms.l2);
+  }
+  return norms;
+}
+
+Error_Policy::Error_Policy(string spec)
+:
+spec(spec),
+every(0),
+n_sample(0),
+cells_nx(0),
+cells_ny(0)
+{
+  bool ok = true;
+  if (spec == "final")
+    ;
+  else if (spec.compare(0, 6, "every:") == 0)
+    ok = (sscanf(spec.c_str(), "every:%d", &every) == 1 && every > 0);
+  else if (spec.compare(0, 7, "sample:") == 0)
+  {
+    every = 1;
+    int n_read = sscanf(spec.c_str(), "sample:%d:%d", &n_sample, &every);
+    ok = (n_read >= 1 && n_sample > 0 && every > 0);
+  }
+  else
+    ok = false;
+  if (!ok)
+  {
+    cout << "Error evaluation must be final, every:k, sample:m or "
+         << "sample:m:k, not " << spec << endl;
+    assert(false);
+  }
+}
+
+bool Error_Policy::evaluate(int time_step_number) const
+{
+  return (every > 0 && time_step_number % every == 0);
+}
+
+const vector<pair<int,int> >& Error_Policy::sample(int nx, int ny)
+{
+  if (cells.size() == 0 || cells_nx != nx || cells_ny != ny)
+  {
+    // Same seed for every grid, so that runs can be repeated
+    mt19937 generator(12345);
+    uniform_int_distribution<int> random_i(0, nx-1), random_j(0, ny-1);
+    cells.resize(n_sample);
+    for (int s = 0; s < n_sample; s++)
+    {
+      cells[s].first = random_i(generator);
+      cells[s].second = random_j(generator);
+    }
+    cells_nx = nx, cells_ny = ny;
+  }
+  return cells;
+}
+
+void write_error_line(ostream &os, double t, const Error_Norms &norms)
+{
+  os << t << " " << norms.l1 << " " << norms.l2 << " " << norms.linfty << " "
+     << norms.l1_ci << " " << norms.l2_ci << "\n";
+}
@@ -0,0 +1,76 @@
+#ifndef __ERROR_EVALUATION_H__
+#define __ERROR_EVALUATION_H__
+
+#include <vector>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <cassert>
+
+using namespace std;
+
+// l1, l2 and l_infty norms of the error, normalized by the area of the
+// domain, i.e. l1 is the mean of |error| and l2 the root mean square
+struct Error_Norms
+{
+  double l1, l2, linfty;
+  // Half widths of the 95% confidence intervals of l1 and l2 when the norms
+  // are estimated from a sample of cells, 0 when all cells were used. linfty
+  // of a sample is only a lower bound.
+  double l1_ci, l2_ci;
+  long n_cells;
+  bool sampled;
+};
+
+// Computes l1, l2 and l_infty of u - v in one pass over the cells, so that no
+// array of the error is needed, e.g. for each row j of the grid
+//   exact_soln_row(N_x, &grid_x[0], grid_y[j], t, &exact_row[0]);
+//   errors.add(N_x, &solution(0,j), &exact_row[0]);
+// and then errors.norms().
+class Error_Accumulator
+{
+public:
+  Error_Accumulator();
+  void reset();
+  void add(double u, double v);
+  void add(int n, const double u[], const double v[]);
+  // With sampled = true, the cells added are taken to be a random sample of
+  // the grid, and the confidence intervals are computed
+  Error_Norms norms(bool sampled = false) const;
+private:
+  // Sums of |e|, e^2 and e^4, the last for the variance of e^2
+  double sum_1, sum_2, sum_4, max_e;
+  long n;
+};
+
+// When the error is evaluated during a run, given as a string
+//   final        only at the final time (the default)
+//   every:k      on all cells every k time steps and at the final time
+//   sample:m     on m random cells every time step, and on all cells at the
+//                final time
+//   sample:m:k   the same every k time steps
+// The final time is always evaluated on all cells, so that the convergence
+// rates are exact.
+class Error_Policy
+{
+public:
+  Error_Policy(string spec = "final");
+  // Whether to evaluate the error at an intermediate time step
+  bool evaluate(int time_step_number) const;
+  bool is_sampled() const { return n_sample > 0; }
+  // The cells (i,j) of the sample, drawn with replacement and a fixed seed
+  // the first time this is called for the nx x ny grid
+  const vector<pair<int,int> >& sample(int nx, int ny);
+  string get_spec() const { return spec; }
+private:
+  string spec;
+  int every;    // 0 if only at the final time
+  int n_sample; // 0 if all cells are used
+  vector<pair<int,int> > cells;
+  int cells_nx, cells_ny;
+};
+
+// Writes the line "t l1 l2 linfty l1_ci l2_ci" to os
+void write_error_line(ostream &os, double t, const Error_Norms &norms);
+
+#endif
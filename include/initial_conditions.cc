@@ -6,10 +6,152 @@
 #include <string>
 #include <stdio.h>
 #include <sys/time.h>
+#include <cstring>
+#include <algorithm>
 
 #include "initial_conditions.h"
 using namespace std;
 
+//Adding and subtracting 1.5*2^52 rounds a double with |x| < 2^51 to the
+//nearest integer, which then also sits in the low bits of x + shifter.
+//Unlike round() and ceil() without SSE4.1, this vectorizes.
+static const double shifter = 6755399441055744.0;
+static const long long shifter_bits = 0x4338000000000000LL;
+
+//Points are done in blocks, so that the temporaries stay in L1 cache
+static const int block_size = 256;
+
+static inline long long as_bits(double x)
+{
+  long long b;
+  memcpy(&b, &x, sizeof(b));
+  return b;
+}
+
+static inline double as_double(long long b)
+{
+  double x;
+  memcpy(&x, &b, sizeof(x));
+  return x;
+}
+
+//ceil(a) for |a| < 2^51
+static inline double ceil_kernel(double a)
+{
+  double t = (a + shifter) - shifter;
+  return t + ((t < a) ? 1.0 : 0.0);
+}
+
+//In the kernels below, ?: only picks between constants or values which are
+//needed for the condition anyway. Otherwise gcc moves the computation of the
+//value into a branch, if it could raise a floating point exception, and the
+//loop is not vectorized.
+
+//exp(x) = 2^k exp(r) with k the nearest integer to x/ln(2), |r| <= ln(2)/2
+static inline double exp_kernel(double x)
+{
+  const double t = x * 1.4426950408889634 + shifter;
+  const double k = t - shifter;
+  const double r = x - k * 6.93147180369123816490e-01  //ln(2) in two parts,
+                     - k * 1.90821492927058770002e-10; //k*first part is exact
+  //Taylor polynomial, the first dropped term is below 1e-17
+  double p = 1.0/6227020800.0;
+  p = 1.0/479001600.0 + r*p;
+  p = 1.0/39916800.0  + r*p;
+  p = 1.0/3628800.0   + r*p;
+  p = 1.0/362880.0    + r*p;
+  p = 1.0/40320.0     + r*p;
+  p = 1.0/5040.0      + r*p;
+  p = 1.0/720.0       + r*p;
+  p = 1.0/120.0       + r*p;
+  p = 1.0/24.0        + r*p;
+  p = 1.0/6.0         + r*p;
+  p = 0.5             + r*p;
+  p = 1.0             + r*p;
+  p = 1.0             + r*p;
+  const long long k_int = as_bits(t) - shifter_bits;
+  return p * as_double((k_int + 1023) << 52);
+}
+
+//sin(x) = (-1)^k sin(r) with k the nearest integer to x/pi, |r| <= pi/2
+static inline double sin_kernel(double x)
+{
+  const double t = x * 0.31830988618379067 + shifter;
+  const double k = t - shifter;
+  //pi in parts, k times the first two are exact for |k| < 2^24
+  double r = x - k * 3.1415926218032836914;
+  r = r - k * 3.1786509424591713469e-08;
+  r = r - k * 1.2246467864107188502e-16;
+  r = r - k * 1.2736634327021899816e-24;
+  const double r2 = r*r;
+  //Taylor polynomial, the first dropped term is below 2e-18
+  double p = -1.0/51090942171709440000.0;
+  p = 1.0/121645100408832000.0 + r2*p;
+  p = -1.0/355687428096000.0   + r2*p;
+  p = 1.0/1307674368000.0      + r2*p;
+  p = -1.0/6227020800.0        + r2*p;
+  p = 1.0/39916800.0           + r2*p;
+  p = -1.0/362880.0            + r2*p;
+  p = 1.0/5040.0               + r2*p;
+  p = -1.0/120.0               + r2*p;
+  p = 1.0/6.0                  + r2*p;
+  p = r - r*r2*p;
+  //Flip the sign bit for odd k
+  const long long odd = (as_bits(t) - shifter_bits) & 1;
+  return as_double(as_bits(p) ^ (odd << 63));
+}
+
+//Branch free versions of interval_part and the functions of x alone, which
+//give the same values
+static inline double interval_part_kernel(double x, double xmin, double xmax)
+{
+  const double L = xmax - xmin;
+  //Periods to go down and up, at least one of them is 0
+  double down = ceil_kernel((x - xmax) / L), up = ceil_kernel((xmin - x) / L);
+  down = (down > 0.0) ? down : 0.0;
+  up   = (up   > 0.0) ? up   : 0.0;
+  return x - down * L + up * L;
+}
+
+//max(0, min(x - a, b - x)) is the hat with corners a, b
+static inline double hat_kernel(double x, double xmin, double xmax)
+{
+  x = interval_part_kernel(x,xmin,xmax);
+  const double L = xmax - xmin;
+  const double rise = x - (xmin + L/4.0), fall = (xmax - L/4.0) - x;
+  const double v = (rise < fall) ? rise : fall;
+  return (v > 0.0) ? v : 0.0;
+}
+
+//1 in the middle half of (xmin,xmax), 0 outside, x already in (xmin,xmax)
+static inline double middle_half(double x, double xmin, double xmax)
+{
+  const double L = xmax - xmin;
+  return ((x < xmin + L/4.0) ? 0.0 : 1.0) * ((x > xmax - L/4.0) ? 0.0 : 1.0);
+}
+
+void vector_exp(int n, const double x[], double v[])
+{
+  double xb[block_size];
+  for (int k0 = 0; k0 < n; k0 += block_size)
+  {
+    const int m = min(block_size, n - k0);
+    //Keeps 2^k a normal number, exp(x) < 3.3e-308 is returned as exp(-708).
+    //x > 709 overflows and is not handled. This is a separate loop, as gcc
+    //does not vectorize exp_kernel with it.
+    for (int k = 0; k < m; k++)
+      xb[k] = (x[k0+k] > -708.0) ? x[k0+k] : -708.0;
+    for (int k = 0; k < m; k++)
+      v[k0+k] = exp_kernel(xb[k]);
+  }
+}
+
+void vector_sin(int n, const double x[], double v[])
+{
+  for (int k = 0; k < n; k++)
+    v[k] = sin_kernel(x[k]);
+}
+
 double interval_part(double x, double xmin, double xmax)
 {
   if (x > xmax)
@@ -165,3 +307,111 @@ double I_Functions::exact_value(double x, double y,double t, double u[2], bool c
 }
 
 
+
+void I_Functions::value(int n, const double x[], const double y[], double v[])
+{
+  double a[block_size], b[block_size];
+  const double Lx = xmax - xmin, Ly = ymax - ymin;
+  for (int k0 = 0; k0 < n; k0 += block_size)
+  {
+    const int m = min(block_size, n - k0);
+    const double *xb = x + k0, *yb = y + k0;
+    double *vb = v + k0;
+    switch (initial_data_indicator)
+    {
+    case 0:
+      for (int k = 0; k < m; k++)
+        a[k] = 2.0 * M_PI * xb[k] / Lx, b[k] = 2.0 * M_PI * yb[k] / Ly;
+      vector_sin(m, a, a);
+      vector_sin(m, b, b);
+      for (int k = 0; k < m; k++)
+        vb[k] = a[k] * b[k];
+      break;
+    case 1:
+      for (int k = 0; k < m; k++)
+        vb[k] = hat_kernel(xb[k],xmin,xmax) * hat_kernel(yb[k],ymin,ymax);
+      break;
+    case 2:
+      for (int k = 0; k < m; k++)
+        vb[k] = middle_half(interval_part_kernel(xb[k],xmin,xmax),xmin,xmax)
+              * middle_half(interval_part_kernel(yb[k],ymin,ymax),ymin,ymax);
+      break;
+    case 3:
+      //exp(a)*exp(b) as exp(a+b)
+      for (int k = 0; k < m; k++)
+      {
+        const double xi = interval_part_kernel(xb[k],xmin,xmax);
+        const double yi = interval_part_kernel(yb[k],ymin,ymax);
+        a[k] = -25.0*(xi-0.25)*(xi-0.25) - 25.0*(yi-0.25)*(yi-0.25);
+      }
+      vector_exp(m, a, vb);
+      break;
+    case 4:
+      for (int k = 0; k < m; k++)
+      {
+        const double xi = interval_part_kernel(xb[k],xmin,xmax);
+        const double yi = interval_part_kernel(yb[k],ymin,ymax);
+        a[k] = -100.0*((xi-0.5)*(xi-0.5) + yi*yi);
+      }
+      vector_exp(m, a, a);
+      for (int k = 0; k < m; k++)
+        vb[k] = 1.0 + a[k];
+      break;
+    case 5:
+      for (int k = 0; k < m; k++)
+      {
+        const double xi = interval_part_kernel(xb[k],xmin,xmax);
+        const double yi = interval_part_kernel(yb[k],ymin,ymax);
+        a[k] = 4.0 * M_PI * xi / Lx, b[k] = 4.0 * M_PI * yi / Ly;
+        vb[k] = middle_half(xi,xmin,xmax) * middle_half(yi,ymin,ymax);
+      }
+      vector_sin(m, a, a);
+      vector_sin(m, b, b);
+      for (int k = 0; k < m; k++)
+        vb[k] = vb[k] * a[k] * b[k]; //(-sin)*(-sin)
+      break;
+    default:
+      cout << "You entered the wrong initial_data_indicator ";
+      assert(false);
+    }
+  }
+}
+
+void I_Functions::exact_value(int n, const double x[], const double y[],
+                              double t, double u[2], bool constant, double v[])
+{
+  double x0[block_size], y0[block_size];
+  const double c = cos(t), s = sin(t);
+  for (int k0 = 0; k0 < n; k0 += block_size)
+  {
+    const int m = min(block_size, n - k0);
+    const double *xb = x + k0, *yb = y + k0;
+    //Foot of the characteristic through (x,y)
+    if (constant == true)
+      for (int k = 0; k < m; k++)
+        x0[k] = xb[k] - u[0]*t, y0[k] = yb[k] - u[1]*t;
+    else
+      for (int k = 0; k < m; k++)
+        x0[k] = xb[k]*c + yb[k]*s, y0[k] = -xb[k]*s + yb[k]*c;
+    value(m, x0, y0, v + k0);
+  }
+}
+
+void I_Functions::value_row(int n, const double x[], double y, double v[])
+{
+  double yb[block_size];
+  for (int k = 0; k < block_size; k++)
+    yb[k] = y;
+  for (int k0 = 0; k0 < n; k0 += block_size)
+    value(min(block_size, n - k0), x + k0, yb, v + k0);
+}
+
+void I_Functions::exact_value_row(int n, const double x[], double y, double t,
+                                  double u[2], bool constant, double v[])
+{
+  double yb[block_size];
+  for (int k = 0; k < block_size; k++)
+    yb[k] = y;
+  for (int k0 = 0; k0 < n; k0 += block_size)
+    exact_value(min(block_size, n - k0), x + k0, yb, t, u, constant, v + k0);
+}
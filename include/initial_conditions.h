@@ -22,6 +22,13 @@ double exp_func_50(double x, double y, double xmin, double xmax, double ymin, do
 
 double cts_sine(double x, double xmin, double xmax);
 
+// v[k] = exp(x[k]) and v[k] = sin(x[k]) for k < n. The loops have no branches
+// or library calls, so that they are vectorized. They agree with exp and sin
+// to a few ulp, exp for x <= 709 (below -708 it returns exp(-708)) and sin
+// for |x| up to about 1e5.
+void vector_exp(int n, const double x[], double v[]);
+void vector_sin(int n, const double x[], double v[]);
+
 class I_Functions
 {
 public:
@@ -33,6 +40,18 @@ public:
   //Gets exact solution, depending on advection speed
   double exact_value(double x, double y, double t, double u[2], 
                      bool constant = false);
+
+  //Batch versions of value and exact_value at the n points (x[k],y[k]).
+  //The switch on initial_data_indicator and cos(t), sin(t) are done once for
+  //all points, and the loops use vector_exp, vector_sin so that they are
+  //vectorized. Results agree with the pointwise versions to a few ulp.
+  void value(int n, const double x[], const double y[], double v[]);
+  void exact_value(int n, const double x[], const double y[], double t,
+                   double u[2], bool constant, double v[]);
+  //Row (x[i],y), i < n of a grid, e.g. with v = &solution_exact(0,j)
+  void value_row(int n, const double x[], double y, double v[]);
+  void exact_value_row(int n, const double x[], double y, double t,
+                       double u[2], bool constant, double v[]);
   
   //Sets initial_data_indicator, xmin,xmax
   void set(int initial_data_indicator, double xmin, double xmax,
@@ -0,0 +1,108 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include "limiters.h"
+
+using namespace std;
+
+//Roughly, this limiter gives min(abs(back_diff),abs(fwd_diff))
+double minmod(double fwd_diff,double back_diff)
+{
+  if (fwd_diff * back_diff <= 0.0) 
+      return 0.0;
+  else 
+      return min(fwd_diff / back_diff,1.0) * back_diff;
+}
+
+double superbee(double fwd_diff,double back_diff)
+{
+  if (fwd_diff * back_diff <= 0.0) 
+      return 0.0;
+  else 
+      {
+      double r = fwd_diff/back_diff;
+      double temp = max(0.0,min(2.0*r,1.0));
+      return max(temp, min(r,2.0)) * back_diff;
+      }
+}
+
+//back_diff will mean uj - ujm1 for some j. Similar for cent_diff,fwd_diff.
+double minmod3(double back_diff,double cent_diff,double fwd_diff)
+{
+  if ( (back_diff*cent_diff <= 0.0) ||
+        (cent_diff*fwd_diff <= 0.0) )
+      return 0.0;
+  else //s min(|a|,|b|,|c|) where s = sign(a)=sign(b)=sign(c)
+      {
+        double temp = min(abs(back_diff),abs(cent_diff));
+        temp = min(temp,abs(fwd_diff));
+        return (back_diff/abs(back_diff)) * temp;
+      }
+}
+
+//Here, we define the function that uses limiters to compute u_{j-1/2}^L
+//where u_{j-1/2}^L = u_j + phi(...)
+double reconstructor(double ujm2, double ujm1, double uj, string limiter)
+{    
+  if (limiter == "none")
+  {
+    return ujm1 + 0.5*(ujm1-ujm2);
+  }
+  else if (limiter == "minmod")
+  {
+    return ujm1 + 0.5*minmod(uj - ujm1,ujm1 -ujm2);
+  }
+  else if (limiter == "superbee")
+  {
+    return ujm1 + 0.5*superbee(uj-ujm1,ujm1-ujm2);
+  }
+  else if (limiter == "vanleer")
+  {
+    double beta = 2.0;
+    return ujm1 + 0.5 * minmod3(beta*(ujm1-ujm2),
+                                0.5*(uj-ujm2),beta*(uj-ujm1));
+  }
+  else
+  {
+    cout << "Incorrect limiter inputted"<<endl;
+    assert(false);
+    return 0.0;
+  }
+}
+
+double zero_slope(double back_diff, double fwd_diff)
+{
+  (void)back_diff, (void)fwd_diff;
+  return 0.0;
+}
+
+double minmod_slope(double back_diff, double fwd_diff)
+{
+  return minmod(fwd_diff, back_diff);
+}
+
+double superbee_slope(double back_diff, double fwd_diff)
+{
+  return superbee(fwd_diff, back_diff);
+}
+
+//As in reconstructor, with beta = 2
+double vanleer_slope(double back_diff, double fwd_diff)
+{
+  return minmod3(2.0*back_diff, 0.5*(back_diff + fwd_diff), 2.0*fwd_diff);
+}
+
+void weno5_row(int n, const double *u, int step, double *minus, double *plus)
+{
+  //The stencil as 5 rows, so that the loads are contiguous in i. Two loops,
+  //as one would need too many run time alias checks to be vectorized.
+  const double *um2 = u - 2*step, *um1 = u - step;
+  const double *up1 = u + step, *up2 = u + 2*step;
+  if (minus != NULL)
+    for (int i = 0; i < n; i++)
+      minus[i] = weno5(up2[i], up1[i], u[i], um1[i], um2[i]);
+  if (plus != NULL)
+    for (int i = 0; i < n; i++)
+      plus[i]  = weno5(um2[i], um1[i], u[i], up1[i], up2[i]);
+}
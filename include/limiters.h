@@ -0,0 +1,72 @@
+#ifndef __LIMITERS_H__
+#define __LIMITERS_H__
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <cassert>
+
+using namespace std;
+
+//Recall that f_{j+1/2} = a*u_{j+1/2}^L
+//We roughly have u_{j+1/2}^L = u_j + phi(u_{j-1}-u_j,u_{j+1}-u_j)
+//Where phi is a limiter like minmod, superbee, minmod3
+
+//Roughly, this limiter gives min(abs(back_diff),abs(fwd_diff))
+double minmod(double fwd_diff,double back_diff);
+
+double superbee(double fwd_diff,double back_diff);
+
+//back_diff will mean uj - ujm1 for some j. Similar for cent_diff,fwd_diff.
+double minmod3(double back_diff,double cent_diff,double fwd_diff);
+
+//Uses limiters to compute u_{j-1/2}^L where u_{j-1/2}^L = u_{j-1} + phi(...)
+//limiter = none, minmod, superbee or vanleer
+double reconstructor(double ujm2, double ujm1, double uj, string limiter);
+
+//Limited slope of cell j from back_diff = u_j - u_{j-1} and
+//fwd_diff = u_{j+1} - u_j, so that the face values are u_j -+ slope/2. These
+//are the slopes of reconstructor, for schemes that compute them once per
+//cell (include/muscl2d.h). zero_slope gives the first order scheme.
+double zero_slope(double back_diff, double fwd_diff);
+double minmod_slope(double back_diff, double fwd_diff);
+double superbee_slope(double back_diff, double fwd_diff);
+double vanleer_slope(double back_diff, double fwd_diff);
+
+//Fifth order WENO value u_{j+1/2}^L at the right face of cell j, from the
+//cells j-2,...,j+2 (Jiang and Shu, with the weights of WENO-Z so that the order
+//is kept at smooth extrema). The mirrored call weno5(u_{j+2},...,u_{j-2})
+//gives the value u_{j-1/2}^R at the left face. It needs 5 cells, so it is not
+//an option of reconstructor. Inline, for the vectorized loop of weno5_row.
+//The stencils {j-2,j-1,j}, {j-1,j,j+1}, {j,j+1,j+2} give the third order values
+//p_k, combined with the ideal weights d = (1/10,6/10,3/10) where the
+//smoothness indicators beta_k are equal.
+inline
+double weno5(double ujm2, double ujm1, double uj, double ujp1, double ujp2)
+{
+  const double eps = 1e-40;
+  //Second and first differences of the stencils, beta_k = 13/12 d2^2 + 1/4 d1^2
+  const double d2_0 = ujm2 - 2.0*ujm1 + uj, d1_0 = ujm2 - 4.0*ujm1 + 3.0*uj;
+  const double d2_1 = ujm1 - 2.0*uj + ujp1, d1_1 = ujm1 - ujp1;
+  const double d2_2 = uj - 2.0*ujp1 + ujp2, d1_2 = 3.0*uj - 4.0*ujp1 + ujp2;
+  const double beta0 = 13.0/12.0*d2_0*d2_0 + 0.25*d1_0*d1_0;
+  const double beta1 = 13.0/12.0*d2_1*d2_1 + 0.25*d1_1*d1_1;
+  const double beta2 = 13.0/12.0*d2_2*d2_2 + 0.25*d1_2*d1_2;
+  const double tau5 = abs(beta0 - beta2);
+  const double a0 = 0.1*(1.0 + tau5/(beta0 + eps));
+  const double a1 = 0.6*(1.0 + tau5/(beta1 + eps));
+  const double a2 = 0.3*(1.0 + tau5/(beta2 + eps));
+  const double p0 = (2.0*ujm2 - 7.0*ujm1 + 11.0*uj)/6.0;
+  const double p1 = (-ujm1 + 5.0*uj + 2.0*ujp1)/6.0;
+  const double p2 = (2.0*uj + 5.0*ujp1 - ujp2)/6.0;
+  return (a0*p0 + a1*p1 + a2*p2)/(a0 + a1 + a2);
+}
+
+//weno5 for n consecutive cells, minus[i] at the left face and plus[i] at the
+//right face of the cell u[i], with the stencil u[i-2*step],...,u[i+2*step].
+//step = 1 reconstructs along a row, step = the row stride across rows, and in
+//both cases the loop over i is vectorized. minus or plus can be NULL when only
+//the values at one side are needed, as for an upwind flux of fixed sign.
+void weno5_row(int n, const double *u, int step, double *minus, double *plus);
+
+#endif
@@ -0,0 +1,52 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include "muscl2d.h"
+
+using namespace std;
+
+Slope_Limiter get_slope_limiter(string limiter)
+{
+  if (limiter == "none")
+    return &zero_slope;
+  else if (limiter == "minmod")
+    return &minmod_slope;
+  else if (limiter == "superbee")
+    return &superbee_slope;
+  else if (limiter == "vanleer")
+    return &vanleer_slope;
+  cout << "Unknown limiter " << limiter
+       << ", use minmod, superbee, vanleer or none" << endl;
+  assert(false);
+  return &zero_slope;
+}
+
+void compute_slopes(const Array2D &u, Slope_Limiter limiter,
+                    Array2D &slope_x, Array2D &slope_y)
+{
+  const int nx = u.sizex(), ny = u.sizey(), stride = u.stride();
+  assert(u.n_ghost() >= 1);
+  for (int j = 0; j < ny; j++)
+  {
+    const double *q = u.ptr(0,j);
+    double *sx = slope_x.ptr(0,j), *sy = slope_y.ptr(0,j);
+    for (int i = 0; i < nx; i++)
+    {
+      sx[i] = (*limiter)(q[i] - q[i-1], q[i+1] - q[i]);
+      sy[i] = (*limiter)(q[i] - q[i-stride], q[i+stride] - q[i]);
+    }
+  }
+}
+
+// Lines of cells, x_minus and x_plus of the row j in one sweep with step 1,
+// y_minus and y_plus of the row j from the rows j-2,...,j+2 with step stride
+void compute_weno5_faces(const Array2D &u, Array2D &x_minus, Array2D &x_plus,
+                         Array2D &y_minus, Array2D &y_plus)
+{
+  const int nx = u.sizex(), ny = u.sizey(), stride = u.stride();
+  assert(u.n_ghost() >= 3 && x_minus.n_ghost() >= 1 && y_minus.n_ghost() >= 1);
+  for (int j = 0; j < ny; j++)
+    weno5_row(nx+2, u.ptr(-1,j), 1, x_minus.ptr(-1,j), x_plus.ptr(-1,j));
+  for (int j = -1; j <= ny; j++)
+    weno5_row(nx, u.ptr(0,j), stride, y_minus.ptr(0,j), y_plus.ptr(0,j));
+}
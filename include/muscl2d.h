@@ -0,0 +1,38 @@
+#ifndef __MUSCL2D_H__
+#define __MUSCL2D_H__
+
+#include <string>
+#include "array2d.h"
+#include "limiters.h"
+
+using namespace std;
+
+// MUSCL reconstruction for the 2D finite volume solvers. The limited slopes
+// are computed once per cell, into slope arrays, and the states at the face
+// (i+1/2,j) are then
+//   Q_l = u(i,j) + 0.5*slope_x(i,j),  Q_r = u(i+1,j) - 0.5*slope_x(i+1,j)
+// and similarly in y, instead of limiting again at every face.
+
+// compute_weno5_faces is the fifth order alternative, which gives the two face
+// values of each cell separately, as they are not symmetric about u(i,j).
+
+// One of the slopes of limiters.h, e.g. minmod_slope
+typedef double (*Slope_Limiter)(double back_diff, double fwd_diff);
+
+// Limiter minmod, superbee, vanleer or none (zero slopes, first order)
+Slope_Limiter get_slope_limiter(string limiter);
+
+// Slopes of the interior cells of u, which needs 1 ghost layer filled
+void compute_slopes(const Array2D &u, Slope_Limiter limiter,
+                    Array2D &slope_x, Array2D &slope_y);
+
+// WENO5 values at the faces of the cells (i,j), x_minus(i,j) at x_{i-1/2},
+// x_plus(i,j) at x_{i+1/2}, y_minus(i,j) at y_{j-1/2} and y_plus(i,j) at
+// y_{j+1/2}. They are also computed for the first layer of ghost cells, so
+// that the faces of the first and last cells have both values without
+// filling the ghosts of the face arrays. This needs 3 ghost layers of u filled
+// and 1 in the face arrays.
+void compute_weno5_faces(const Array2D &u, Array2D &x_minus, Array2D &x_plus,
+                         Array2D &y_minus, Array2D &y_plus);
+
+#endif
@@ -0,0 +1,212 @@
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+#include "perf_counters.h"
+
+using namespace std;
+
+#ifdef __linux__
+// glibc has no wrapper for this system call
+static int perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu,
+                           int group_fd, unsigned long flags)
+{
+  return syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+
+// Counter of this process and the threads it creates, in user space only
+static int open_counter(unsigned int type, unsigned long long config)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size           = sizeof(attr);
+  attr.type           = type;
+  attr.config         = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+  attr.inherit        = 1;
+  // To scale the count if the counter had to share the hardware
+  attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED
+                        | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return perf_event_open(&attr, 0, -1, -1, 0);
+}
+#endif
+
+Perf_Counters::Perf_Counters()
+:
+enabled(false),
+peak_gbs(0.0),
+peak_gflops(0.0)
+{
+  for (int e = 0; e < n_events; e++)
+    fd[e] = -1;
+  const char *env = getenv("PERF_COUNTERS");
+  if (env == NULL || string(env) != "1")
+    return;
+  enabled = true;
+  if (getenv("PERF_PEAK_GBS") != NULL)
+    peak_gbs = atof(getenv("PERF_PEAK_GBS"));
+  if (getenv("PERF_PEAK_GFLOPS") != NULL)
+    peak_gflops = atof(getenv("PERF_PEAK_GFLOPS"));
+#ifdef __linux__
+  fd[cycles]       = open_counter(PERF_TYPE_HARDWARE,
+                                  PERF_COUNT_HW_CPU_CYCLES);
+  fd[instructions] = open_counter(PERF_TYPE_HARDWARE,
+                                  PERF_COUNT_HW_INSTRUCTIONS);
+  fd[cache_misses] = open_counter(PERF_TYPE_HARDWARE,
+                                  PERF_COUNT_HW_CACHE_MISSES);
+  // There is no generic event for vector instructions
+  const char *vector_event = getenv("PERF_VECTOR_EVENT");
+  if (vector_event != NULL)
+    fd[vector_instructions] = open_counter(PERF_TYPE_RAW,
+                                           strtoull(vector_event, NULL, 0));
+  if (fd[cycles] == -1)
+    cout << "Perf_Counters: hardware counters are not available, only "
+         << "time based numbers are reported. Check "
+         << "/proc/sys/kernel/perf_event_paranoid" << endl;
+#else
+  cout << "Perf_Counters: perf_event is only available on Linux" << endl;
+#endif
+}
+
+Perf_Counters::~Perf_Counters()
+{
+#ifdef __linux__
+  for (int e = 0; e < n_events; e++)
+    if (fd[e] != -1)
+      close(fd[e]);
+#endif
+}
+
+void Perf_Counters::read_counters(double counts[]) const
+{
+  for (int e = 0; e < n_events; e++)
+  {
+    counts[e] = 0.0;
+#ifdef __linux__
+    if (fd[e] == -1)
+      continue;
+    // value, time enabled, time running
+    unsigned long long values[3];
+    if (read(fd[e], values, sizeof(values)) != sizeof(values))
+      continue;
+    counts[e] = double(values[0]);
+    if (values[2] > 0 && values[2] < values[1])
+      counts[e] *= double(values[1]) / double(values[2]);
+#endif
+  }
+}
+
+int Perf_Counters::find_region(const string &region)
+{
+  for (unsigned int r = 0; r < regions.size(); r++)
+    if (regions[r].name == region)
+      return r;
+  Region new_region;
+  new_region.name    = region;
+  new_region.calls   = 0;
+  new_region.seconds = new_region.bytes = new_region.flops = 0.0;
+  for (int e = 0; e < n_events; e++)
+    new_region.counts[e] = new_region.start_counts[e] = 0.0;
+  regions.push_back(new_region);
+  return regions.size() - 1;
+}
+
+void Perf_Counters::start(const string &region)
+{
+  if (!enabled)
+    return;
+  Region &r = regions[find_region(region)];
+  read_counters(r.start_counts);
+  r.begin = chrono::steady_clock::now();
+}
+
+void Perf_Counters::stop(const string &region, double bytes, double flops)
+{
+  if (!enabled)
+    return;
+  chrono::steady_clock::time_point end = chrono::steady_clock::now();
+  double counts[n_events];
+  read_counters(counts);
+  Region &r = regions[find_region(region)];
+  r.calls   += 1;
+  r.seconds += chrono::duration<double>(end - r.begin).count();
+  r.bytes   += bytes;
+  r.flops   += flops;
+  for (int e = 0; e < n_events; e++)
+    r.counts[e] += counts[e] - r.start_counts[e];
+}
+
+void Perf_Counters::reset()
+{
+  regions.clear();
+}
+
+void Perf_Counters::report(ostream &os) const
+{
+  if (!enabled || regions.size() == 0)
+    return;
+  os << "Hardware counters (n/a = not available)" << endl;
+  os << setw(14) << "region" << setw(8) << "calls" << setw(12) << "seconds"
+     << setw(14) << "cycles" << setw(14) << "instructions" << setw(7) << "IPC"
+     << setw(14) << "cache_misses" << setw(14) << "vector_instr" << endl;
+  for (unsigned int p = 0; p < regions.size(); p++)
+  {
+    const Region &r = regions[p];
+    os << setw(14) << r.name << setw(8) << r.calls << setw(12) << r.seconds;
+    for (int e = 0; e < n_events; e++)
+    {
+      if (e == cache_misses)
+      {
+        if (fd[cycles] != -1 && fd[instructions] != -1 && r.counts[cycles] > 0)
+          os << setw(7) << setprecision(3)
+             << r.counts[instructions] / r.counts[cycles] << setprecision(6);
+        else
+          os << setw(7) << "n/a";
+      }
+      if (fd[e] != -1)
+        os << setw(14) << r.counts[e];
+      else
+        os << setw(14) << "n/a";
+    }
+    os << endl;
+  }
+
+  // Roofline, attainable GFLOP/s = min(peak GFLOP/s, AI * peak GB/s)
+  os << "Roofline (AI = flops/byte, bytes and flops as estimated by the solver)"
+     << endl;
+  os << setw(14) << "region" << setw(12) << "GB/s" << setw(12) << "GFLOP/s"
+     << setw(10) << "AI" << setw(16) << "bound" << setw(14) << "% of roof"
+     << endl;
+  for (unsigned int p = 0; p < regions.size(); p++)
+  {
+    const Region &r = regions[p];
+    double gbs = 0.0, gflops = 0.0, ai = 0.0;
+    if (r.seconds > 0.0)
+      gbs = 1.0e-9 * r.bytes / r.seconds, gflops = 1.0e-9 * r.flops / r.seconds;
+    if (r.bytes > 0.0)
+      ai = r.flops / r.bytes;
+    os << setw(14) << r.name << setw(12) << gbs << setw(12) << gflops
+       << setw(10) << ai;
+    if (peak_gbs > 0.0 && peak_gflops > 0.0)
+    {
+      double ridge = peak_gflops / peak_gbs; // AI where the roofs meet
+      double roof  = min(peak_gflops, ai * peak_gbs);
+      os << setw(16) << ((ai < ridge) ? "memory" : "compute")
+         << setw(14) << ((roof > 0.0) ? 100.0 * gflops / roof : 0.0);
+    }
+    else
+      os << setw(16) << "set PERF_PEAK_*" << setw(14) << "-";
+    os << endl;
+  }
+}
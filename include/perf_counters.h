@@ -0,0 +1,67 @@
+#ifndef __PERF_COUNTERS_H__
+#define __PERF_COUNTERS_H__
+
+#include <vector>
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cassert>
+
+using namespace std;
+
+// Hardware counters of the hot loops of a solver, read with the Linux
+// perf_event_open system call. It is switched on by setting the environment
+// variable PERF_COUNTERS=1, otherwise start and stop do nothing.
+//
+// For every region (like apply_fvm) we get cycles, instructions, last level
+// cache misses and, if PERF_VECTOR_EVENT is set, the count of a raw vector
+// instruction event, e.g. PERF_VECTOR_EVENT=0x3cc7 for the packed double
+// FP_ARITH_INST_RETIRED events on recent Intel cores (see `perf list`).
+// The caller gives the bytes moved and the flops of a call of the region,
+// from which the bandwidth, arithmetic intensity and position on the
+// roofline of PERF_PEAK_GBS (GB/s) and PERF_PEAK_GFLOPS are reported.
+//
+// Counters only count user space, so they work without root as long as
+// /proc/sys/kernel/perf_event_paranoid is at most 2. Counters which cannot
+// be opened (e.g. in a virtual machine) are reported as n/a.
+// Counters are inherited by threads created after the constructor, so it
+// should be created before the first OpenMP parallel region.
+class Perf_Counters
+{
+public:
+  Perf_Counters();
+  ~Perf_Counters();
+  // The counters are file descriptors, which must not be closed twice
+  Perf_Counters(const Perf_Counters&) = delete;
+  Perf_Counters& operator=(const Perf_Counters&) = delete;
+
+  bool is_enabled() const { return enabled; }
+  void start(const string &region);
+  // bytes and flops are the memory traffic and floating point operations of
+  // this call of the region, as estimated by the caller
+  void stop(const string &region, double bytes, double flops);
+  void reset(); // Removes all regions, e.g. before a new refinement level
+  // Table of counters, bandwidth and roofline of each region
+  void report(ostream &os = cout) const;
+
+private:
+  enum {cycles, instructions, cache_misses, vector_instructions, n_events};
+  struct Region
+  {
+    string name;
+    long calls;
+    double seconds, bytes, flops;
+    double counts[n_events];
+    double start_counts[n_events];
+    chrono::steady_clock::time_point begin;
+  };
+  int find_region(const string &region);
+  void read_counters(double counts[]) const;
+
+  bool enabled;
+  int fd[n_events]; // -1 if the counter could not be opened
+  vector<Region> regions;
+  double peak_gbs, peak_gflops; // 0 if not given
+};
+
+#endif
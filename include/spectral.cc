@@ -0,0 +1,167 @@
+#include <cmath>
+#include <iostream>
+#include <cassert>
+#include "spectral.h"
+
+using namespace std;
+
+// a*b without the checks for infinite and NaN parts of the C99 rules, which
+// make complex<double>::operator* a library call at -O3
+static inline complex<double> mul(const complex<double> &a,
+                                  const complex<double> &b)
+{
+  return complex<double>(a.real()*b.real() - a.imag()*b.imag(),
+                         a.real()*b.imag() + a.imag()*b.real());
+}
+
+FFT::FFT(int n) : n(n)
+{
+  assert(n >= 1);
+  m = 1;
+  while (m < n)
+    m *= 2;
+  if (m != n) // Length of the convolution of Bluestein's algorithm
+  {
+    m = 1;
+    while (m < 2*n - 1)
+      m *= 2;
+  }
+  int log_m = 0;
+  while ((1 << log_m) < m)
+    log_m += 1;
+  bit_reverse.resize(m);
+  for (int i = 0; i < m; i++)
+  {
+    int r = 0;
+    for (int b = 0; b < log_m; b++)
+      if (i & (1 << b))
+        r |= 1 << (log_m - 1 - b);
+    bit_reverse[i] = r;
+  }
+  roots.resize(m/2);
+  for (int k = 0; k < m/2; k++)
+    roots[k] = polar(1.0, -2.0*M_PI*k/m);
+  if (m == n)
+    return;
+
+  // j^2 mod 2n, as exp(-pi i j^2/n) has period 2n in j^2, so that the angle
+  // stays small and accurate for large j
+  chirp.resize(n);
+  for (int j = 0; j < n; j++)
+    chirp[j] = polar(1.0, -M_PI*double((long(j)*j) % (2L*n))/n);
+  kernel.assign(m, 0.0);
+  kernel[0] = conj(chirp[0]);
+  for (int j = 1; j < n; j++)
+    kernel[j] = kernel[m-j] = conj(chirp[j]);
+  radix2(&kernel[0]);
+  work.resize(m);
+}
+
+void FFT::radix2(complex<double> *a) const
+{
+  for (int i = 0; i < m; i++)
+    if (i < bit_reverse[i])
+      swap(a[i], a[bit_reverse[i]]);
+  for (int len = 2; len <= m; len *= 2)
+  {
+    const int half = len/2, step = m/len;
+    for (int i = 0; i < m; i += len)
+      for (int k = 0; k < half; k++)
+      {
+        const complex<double> x = a[i+k], y = mul(a[i+k+half], roots[k*step]);
+        a[i+k] = x + y;
+        a[i+k+half] = x - y;
+      }
+  }
+}
+
+// With jk = (j^2 + k^2 - (k-j)^2)/2, the transform is
+//   a_k <- chirp_k sum_j (a_j chirp_j) conj(chirp_{k-j}),
+// a convolution, done with forward and inverse transforms of length m
+void FFT::bluestein(complex<double> *a) const
+{
+  for (int j = 0; j < n; j++)
+    work[j] = mul(a[j], chirp[j]);
+  for (int j = n; j < m; j++)
+    work[j] = 0.0;
+  radix2(&work[0]);
+  for (int j = 0; j < m; j++)
+    work[j] = conj(mul(work[j], kernel[j]));
+  radix2(&work[0]); // The inverse, as conj(forward(conj(.)))/m
+  for (int k = 0; k < n; k++)
+    a[k] = mul(chirp[k], conj(work[k]))/double(m);
+}
+
+void FFT::transform(complex<double> *a, bool inverse) const
+{
+  // The inverse is conj(forward(conj(a)))/n
+  if (inverse)
+    for (int j = 0; j < n; j++)
+      a[j] = conj(a[j]);
+  if (m == n)
+    radix2(a);
+  else
+    bluestein(a);
+  if (inverse)
+    for (int j = 0; j < n; j++)
+      a[j] = conj(a[j])/double(n);
+}
+
+// 2 pi k/l for the modes k = 0,1,...,n/2,-(n-1)/2,...,-1 in FFT order
+static vector<double> wave_numbers(int n, double l)
+{
+  vector<double> k(n);
+  for (int j = 0; j < n; j++)
+    k[j] = 2.0*M_PI*((j <= n/2) ? j : j - n)/l;
+  return k;
+}
+
+Spectral_Solver::Spectral_Solver(int nx, int ny, double lx, double ly,
+                                 double u, double v, double nu)
+:
+nx(nx), ny(ny), u(u), v(v), nu(nu), fft_x(nx), fft_y(ny),
+kx(wave_numbers(nx, lx)), ky(wave_numbers(ny, ly)),
+q0_hat(nx*ny), q_hat(nx*ny), factor_x(nx), factor_y(ny), column(ny)
+{
+}
+
+void Spectral_Solver::transform(vector<complex<double> > &a,
+                                bool inverse) const
+{
+  for (int j = 0; j < ny; j++)
+    fft_x.transform(&a[j*nx], inverse);
+  if (ny == 1)
+    return;
+  for (int i = 0; i < nx; i++)
+  {
+    for (int j = 0; j < ny; j++)
+      column[j] = a[i + j*nx];
+    fft_y.transform(&column[0], inverse);
+    for (int j = 0; j < ny; j++)
+      a[i + j*nx] = column[j];
+  }
+}
+
+void Spectral_Solver::set_initial_data(const double *q0, int stride)
+{
+  for (int j = 0; j < ny; j++)
+    for (int i = 0; i < nx; i++)
+      q0_hat[i + j*nx] = q0[i + j*stride];
+  transform(q0_hat, false);
+}
+
+void Spectral_Solver::evaluate(double t, double *q, int stride) const
+{
+  for (int i = 0; i < nx; i++)
+    factor_x[i] = exp(-complex<double>(nu*kx[i]*kx[i], u*kx[i])*t);
+  for (int j = 0; j < ny; j++)
+    factor_y[j] = exp(-complex<double>(nu*ky[j]*ky[j], v*ky[j])*t);
+  for (int j = 0; j < ny; j++)
+    for (int i = 0; i < nx; i++)
+      q_hat[i + j*nx] = mul(q0_hat[i + j*nx],
+                            mul(factor_x[i], factor_y[j]));
+  transform(q_hat, true);
+  for (int j = 0; j < ny; j++)
+    for (int i = 0; i < nx; i++)
+      q[i + j*stride] = real(q_hat[i + j*nx]);
+}
@@ -0,0 +1,75 @@
+#ifndef __SPECTRAL_H__
+#define __SPECTRAL_H__
+
+#include <vector>
+#include <complex>
+
+using namespace std;
+
+// Complex discrete Fourier transform of a fixed length n,
+//   forward: a_k <- sum_j a_j exp(-2 pi i jk/n)
+//   inverse: a_j <- 1/n sum_k a_k exp(+2 pi i jk/n)
+// in O(n log n) for any n, with the iterative radix 2 algorithm when n is a
+// power of 2 and Bluestein's chirp z-transform otherwise, which writes the
+// transform as a convolution of length m >= 2n-1, a power of 2. The
+// twiddles and the transformed chirp are computed once, in the constructor.
+// transform uses a scratch buffer of the object, so an FFT must not be shared
+// between threads.
+class FFT
+{
+public:
+  FFT(int n = 1);
+  int size() const { return n; }
+  void transform(complex<double> *a, bool inverse = false) const;
+
+private:
+  void radix2(complex<double> *a) const; // Forward transform of length m
+  void bluestein(complex<double> *a) const;
+
+  int n, m;
+  vector<int> bit_reverse;
+  vector<complex<double> > roots;   // exp(-2 pi i k/m), k < m/2
+  vector<complex<double> > chirp;   // exp(-pi i j^2/n)
+  vector<complex<double> > kernel;  // Transform of conj(chirp), wrapped
+  mutable vector<complex<double> > work;
+};
+
+// Exact solution of the periodic constant coefficient problem
+//   q_t + u q_x + v q_y = nu (q_xx + q_yy)
+// on an nx x ny grid of period lx x ly, ny = 1 in 1D. Each Fourier mode
+// (kx,ky) is multiplied by
+//   exp(-(i (u kx + v ky) + nu (kx^2 + ky^2)) t),
+// so set_initial_data does the forward transform once, and evaluate gives the
+// solution at any time t with one inverse transform, however many time steps
+// of a finite difference scheme t is. The factor is the product of a factor of
+// kx and one of ky, so evaluate only needs nx + ny exponentials.
+//
+// It is the exact solution of the trigonometric interpolant of the initial
+// data, so it is a reference to machine precision for smooth periodic data,
+// and has Gibbs oscillations for the hat and step functions. With even n, the
+// real part of the Nyquist mode (n/2) is kept, as it is ambiguous on the grid.
+//
+// The values are q[i + j*stride], i.e., q = Array2D::ptr(0,0) and
+// stride = Array2D::stride().
+class Spectral_Solver
+{
+public:
+  Spectral_Solver() : nx(0), ny(0), u(0.0), v(0.0), nu(0.0) {} // To assign
+  Spectral_Solver(int nx, int ny, double lx, double ly,
+                  double u, double v, double nu);
+  void set_initial_data(const double *q0, int stride);
+  void evaluate(double t, double *q, int stride) const;
+
+private:
+  // In place 2D transform of values in a[i + j*nx]
+  void transform(vector<complex<double> > &a, bool inverse) const;
+
+  int nx, ny;
+  double u, v, nu;
+  FFT fft_x, fft_y;
+  vector<double> kx, ky;        // Wave numbers of the modes
+  vector<complex<double> > q0_hat;
+  mutable vector<complex<double> > q_hat, factor_x, factor_y, column;
+};
+
+#endif
@@ -0,0 +1,171 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <cassert>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "split2d.h"
+
+using namespace std;
+
+Line_Advection::Line_Advection(int n, string limiter)
+:
+n(n), slope_limiter(&zero_slope),
+muscl(limiter != "none" && limiter != "weno5"), weno(limiter == "weno5")
+{
+  if (weno == false)
+    slope_limiter = get_slope_limiter(limiter);
+  //Face values of the cells 0,...,n-1 only, as the face x_{n-1/2} is the
+  //face x_{-1/2}, so WENO5 needs 2 ghosts and MUSCL 1
+  ng = weno ? 2 : 1;
+  q0.resize(n), v.resize(n + 2*ng);
+  minus.resize(n), plus.resize(n), flux.resize(n);
+}
+
+void Line_Advection::compute_flux(const double *a)
+{
+  double *u = &v[ng];
+  for (int g = 1; g <= ng; g++)
+    u[-g] = u[n-g], u[n-1+g] = u[g-1];
+  //Left and right states of the faces, the cell values for first order
+  const double *q_minus = u, *q_plus = u;
+  if (weno)
+  {
+    weno5_row(n, u, 1, &minus[0], &plus[0]);
+    q_minus = &minus[0], q_plus = &plus[0];
+  }
+  else if (muscl)
+  {
+    for (int i = 0; i < n; i++)
+    {
+      const double slope = (*slope_limiter)(u[i] - u[i-1], u[i+1] - u[i]);
+      minus[i] = u[i] - 0.5*slope, plus[i] = u[i] + 0.5*slope;
+    }
+    q_minus = &minus[0], q_plus = &plus[0];
+  }
+  for (int i = 0; i < n-1; i++)
+    flux[i] = max(a[i],0.0)*q_plus[i] + min(a[i],0.0)*q_minus[i+1];
+  flux[n-1] = max(a[n-1],0.0)*q_plus[n-1] + min(a[n-1],0.0)*q_minus[0];
+}
+
+//The stages of the unsplit solvers, with res_i = flux_{i-1/2} - flux_{i+1/2}
+void Line_Advection::advance(double *q, const double *a, double lam)
+{
+  double *u = &v[ng];
+  copy(q, q + n, q0.begin());
+  copy(q, q + n, u);
+  compute_flux(a);
+  u[0] = q0[0] + lam*(flux[n-1] - flux[0]);
+  for (int i = 1; i < n; i++)
+    u[i] = q0[i] + lam*(flux[i-1] - flux[i]);
+  if (muscl)
+  {
+    compute_flux(a);
+    u[0] = 0.5*(q0[0] + u[0] + lam*(flux[n-1] - flux[0]));
+    for (int i = 1; i < n; i++)
+      u[i] = 0.5*(q0[i] + u[i] + lam*(flux[i-1] - flux[i]));
+  }
+  else if (weno)
+  {
+    compute_flux(a);
+    u[0] = 0.75*q0[0] + 0.25*(u[0] + lam*(flux[n-1] - flux[0]));
+    for (int i = 1; i < n; i++)
+      u[i] = 0.75*q0[i] + 0.25*(u[i] + lam*(flux[i-1] - flux[i]));
+    compute_flux(a);
+    u[0] = (q0[0] + 2.0*(u[0] + lam*(flux[n-1] - flux[0])))/3.0;
+    for (int i = 1; i < n; i++)
+      u[i] = (q0[i] + 2.0*(u[i] + lam*(flux[i-1] - flux[i])))/3.0;
+  }
+  copy(u, u + n, q);
+}
+
+Split_Advection_2d::Split_Advection_2d(const Array2D &u_face,
+                                       const Array2D &v_face,
+                                       double dx, double dy, string limiter)
+{
+  set(u_face, v_face, dx, dy, limiter);
+}
+
+void Split_Advection_2d::set(const Array2D &u_face, const Array2D &v_face,
+                             double dx, double dy, string limiter)
+{
+  nx = u_face.sizex(), ny = u_face.sizey();
+  this->dx = dx, this->dy = dy;
+  assert(v_face.sizex() == nx && v_face.sizey() == ny);
+  this->u_face.resize(nx, ny, 0), v_face_t.resize(ny, nx, 0);
+  q_t.resize(ny, nx, 0);
+  for (int j = 0; j < ny; j++)
+    for (int i = 0; i < nx; i++)
+      this->u_face(i,j) = u_face(i,j);
+  transpose(v_face, v_face_t);
+  lines.clear();
+  int n_threads = 1;
+#ifdef _OPENMP
+  n_threads = omp_get_max_threads();
+#endif
+  //Lines of both sweeps, which have the same work arrays if nx = ny
+  if (nx == ny)
+    lines.assign(n_threads, Line_Advection(nx, limiter));
+  else
+    for (int k = 0; k < n_threads; k++)
+    {
+      lines.push_back(Line_Advection(nx, limiter));
+      lines.push_back(Line_Advection(ny, limiter));
+    }
+}
+
+void Split_Advection_2d::sweep(Array2D &q, const Array2D &a, double lam)
+{
+  const int n_lines = q.sizey();
+  const bool same_length = (nx == ny);
+  const int which = (q.sizex() == nx) ? 0 : 1;
+#ifdef _OPENMP
+  #pragma omp parallel
+#endif
+  {
+    int thread = 0;
+#ifdef _OPENMP
+    thread = omp_get_thread_num();
+#endif
+    Line_Advection &line = same_length ? lines[thread]
+                                       : lines[2*thread + which];
+#ifdef _OPENMP
+    #pragma omp for schedule(static)
+#endif
+    for (int j = 0; j < n_lines; j++)
+      line.advance(q.ptr(0,j), a.ptr(0,j), lam);
+  }
+}
+
+void Split_Advection_2d::advance(Array2D &q, double dt)
+{
+  assert(q.sizex() == nx && q.sizey() == ny);
+  sweep(q, u_face, 0.5*dt/dx);
+  transpose(q, q_t);
+  sweep(q_t, v_face_t, dt/dy);
+  transpose(q_t, q);
+  sweep(q, u_face, 0.5*dt/dx);
+}
+
+void transpose(const Array2D &a, Array2D &b)
+{
+  const int nx = a.sizex(), ny = a.sizey();
+  assert(b.sizex() == ny && b.sizey() == nx);
+  //A tile of 32 x 32 doubles of a and of b is 16 KB
+  const int tile = 32;
+#ifdef _OPENMP
+  #pragma omp parallel for collapse(2) schedule(static)
+#endif
+  for (int j0 = 0; j0 < ny; j0 += tile)
+    for (int i0 = 0; i0 < nx; i0 += tile)
+    {
+      const int i_end = min(i0 + tile, nx), j_end = min(j0 + tile, ny);
+      for (int i = i0; i < i_end; i++)
+      {
+        double *row = b.ptr(0,i);
+        for (int j = j0; j < j_end; j++)
+          row[j] = a(i,j);
+      }
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef __SPLIT2D_H__
+#define __SPLIT2D_H__
+
+#include <vector>
+#include <string>
+#include "array2d.h"
+#include "muscl2d.h"
+
+using namespace std;
+
+// Dimensional splitting for the periodic 2D finite volume solvers. The step of
+// q_t + (u q)_x + (v q)_y = 0 is the Strang splitting
+//   X(dt/2) Y(dt) X(dt/2),
+// where X solves q_t + (u q)_x = 0 on each row and Y solves q_t + (v q)_y = 0
+// on each column, with the 1D scheme of Line_Advection. It is second order in
+// time, whatever the order of the 1D scheme.
+//
+// The columns are made rows by a blocked transpose, so that both sweeps run the
+// same contiguous kernel on one line at a time, with all the Runge-Kutta stages
+// of the line in cache. The lines are independent, and are threaded with
+// OpenMP (make openmp=yes).
+
+// Periodic 1D finite volume scheme on a line of n cells, with the upwind flux
+// and the face values of the limiter, as in the unsplit solvers: none is first
+// order with forward Euler, minmod, superbee or vanleer are MUSCL with
+// SSP-RK2 and weno5 is WENO5 with SSP-RK3. It keeps its own work arrays, so
+// each thread needs its own Line_Advection.
+class Line_Advection
+{
+public:
+  Line_Advection(int n = 0, string limiter = "none");
+  // Advances q[0],...,q[n-1] by dt, with a[i] the velocity at x_{i+1/2} and
+  // lam = dt/dx
+  void advance(double *q, const double *a, double lam);
+
+private:
+  // flux[i] at x_{i+1/2} of the cells in v, the last one also at x_{-1/2}
+  void compute_flux(const double *a);
+
+  int n, ng;
+  Slope_Limiter slope_limiter;
+  bool muscl, weno;
+  vector<double> q0;          // Solution at the start of the step
+  vector<double> v;           // Stage solution, with ng periodic ghosts
+  vector<double> minus, plus; // Values at the left and right faces
+  vector<double> flux;
+};
+
+class Split_Advection_2d
+{
+public:
+  Split_Advection_2d() : nx(0), ny(0), dx(0.0), dy(0.0) {} // Empty, see set
+  // u_face(i,j) is the velocity at the face (i+1/2,j) and v_face(i,j) at
+  // (i,j+1/2), as they do not change in time
+  Split_Advection_2d(const Array2D &u_face, const Array2D &v_face,
+                     double dx, double dy, string limiter);
+  // Same as the constructor, as Array2D does not copy its sizes in operator=
+  void set(const Array2D &u_face, const Array2D &v_face,
+           double dx, double dy, string limiter);
+  // One Strang step of the interior of q, which needs no ghosts
+  void advance(Array2D &q, double dt);
+
+private:
+  // Advances each row j of q with the velocities of the row j of a
+  void sweep(Array2D &q, const Array2D &a, double lam);
+
+  int nx, ny;
+  double dx, dy;
+  Array2D u_face, v_face_t; // v_face_t(j,i) = v_face(i,j)
+  Array2D q_t;              // Transpose of the solution, for the y sweep
+  vector<Line_Advection> lines; // One per thread
+};
+
+// b(j,i) = a(i,j) for the interior of a, by tiles that fit in cache
+void transpose(const Array2D &a, Array2D &b);
+
+#endif
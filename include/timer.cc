@@ -0,0 +1,204 @@
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cassert>
+#include "timer.h"
+
+using namespace std;
+
+Timer::Timer(string name)
+:
+name(name)
+{
+  last = chrono::steady_clock::now();
+}
+
+int Timer::find_phase(const string &phase) const
+{
+  for (unsigned int p = 0; p < phases.size(); p++)
+    if (phases[p].name == phase)
+      return p;
+  return -1;
+}
+
+// Adds the phase if it is not there
+int Timer::find_phase(const string &phase)
+{
+  int p = static_cast<const Timer&>(*this).find_phase(phase);
+  if (p == -1)
+  {
+    Phase new_phase = {phase, 0, 0};
+    phases.push_back(new_phase);
+    p = phases.size() - 1;
+  }
+  return p;
+}
+
+void Timer::start(const string &phase)
+{
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  // Pause the enclosing phase
+  if (running.size() > 0)
+    phases[running.back()].ns
+      += chrono::duration_cast<chrono::nanoseconds>(now - last).count();
+  int p = find_phase(phase);
+  phases[p].calls += 1;
+  running.push_back(p);
+  last = chrono::steady_clock::now();
+}
+
+void Timer::stop(const string &phase)
+{
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  if (running.size() == 0 || phases[running.back()].name != phase)
+  {
+    cout << "Timer " << name << " stopped phase " << phase
+         << " which is not the innermost running phase" << endl;
+    assert(false);
+  }
+  phases[running.back()].ns
+    += chrono::duration_cast<chrono::nanoseconds>(now - last).count();
+  running.pop_back();
+  // Resume the enclosing phase
+  last = now;
+}
+
+void Timer::count(const string &counter, long n)
+{
+  for (unsigned int c = 0; c < counters.size(); c++)
+    if (counters[c].first == counter)
+    {
+      counters[c].second += n;
+      return;
+    }
+  counters.push_back(make_pair(counter, n));
+}
+
+void Timer::add_info(const string &key, double value)
+{
+  for (unsigned int i = 0; i < info.size(); i++)
+    if (info[i].first == key)
+    {
+      info[i].second = value;
+      return;
+    }
+  info.push_back(make_pair(key, value));
+}
+
+void Timer::reset()
+{
+  assert(running.size() == 0);
+  phases.clear();
+  counters.clear();
+  info.clear();
+}
+
+void Timer::set_name(const string &name)
+{
+  this->name = name;
+}
+
+long long Timer::nanoseconds(const string &phase) const
+{
+  int p = find_phase(phase);
+  if (p == -1)
+    return 0;
+  return phases[p].ns;
+}
+
+double Timer::seconds(const string &phase) const
+{
+  return 1.0e-9 * nanoseconds(phase);
+}
+
+double Timer::total_seconds() const
+{
+  long long ns = 0;
+  for (unsigned int p = 0; p < phases.size(); p++)
+    ns += phases[p].ns;
+  return 1.0e-9 * ns;
+}
+
+long Timer::counter(const string &counter) const
+{
+  for (unsigned int c = 0; c < counters.size(); c++)
+    if (counters[c].first == counter)
+      return counters[c].second;
+  return 0;
+}
+
+void Timer::print(ostream &os) const
+{
+  double total = total_seconds();
+  os << "Time taken by each phase of " << name << endl;
+  os << setw(12) << "phase" << setw(14) << "seconds" << setw(10) << "%"
+     << setw(10) << "calls" << endl;
+  for (unsigned int p = 0; p < phases.size(); p++)
+  {
+    double s = 1.0e-9 * phases[p].ns;
+    os << setw(12) << phases[p].name << setw(14) << s
+       << setw(10) << fixed << setprecision(1)
+       << ((total > 0.0) ? 100.0 * s / total : 0.0)
+       << setw(10) << phases[p].calls << endl;
+    os.unsetf(ios_base::floatfield);
+    os << setprecision(6);
+  }
+  os << setw(12) << "total" << setw(14) << total << endl;
+  for (unsigned int c = 0; c < counters.size(); c++)
+    os << setw(12) << counters[c].first << setw(14) << counters[c].second
+       << endl;
+}
+
+void Timer::write_json(ostream &os) const
+{
+  os << "{\"name\": \"" << name << "\",\n";
+  os << "   \"info\": {";
+  for (unsigned int i = 0; i < info.size(); i++)
+    os << (i > 0 ? ", " : "") << "\"" << info[i].first << "\": "
+       << setprecision(17) << info[i].second;
+  os << setprecision(6);
+  os << "},\n";
+  os << "   \"total_ns\": " << (long long)(1.0e9 * total_seconds()) << ",\n";
+  os << "   \"phases\": {";
+  for (unsigned int p = 0; p < phases.size(); p++)
+    os << (p > 0 ? ",\n              " : "") << "\"" << phases[p].name
+       << "\": {\"ns\": " << phases[p].ns << ", \"calls\": "
+       << phases[p].calls << "}";
+  os << "},\n";
+  os << "   \"counters\": {";
+  for (unsigned int c = 0; c < counters.size(); c++)
+    os << (c > 0 ? ", " : "") << "\"" << counters[c].first << "\": "
+       << counters[c].second;
+  os << "}}";
+}
+
+Scoped_Timer::Scoped_Timer(Timer &timer, const string &phase)
+:
+timer(timer),
+phase(phase)
+{
+  timer.start(phase);
+}
+
+Scoped_Timer::~Scoped_Timer()
+{
+  timer.stop(phase);
+}
+
+void write_json(const vector<Timer> &timers, string filename)
+{
+  ofstream json_file;
+  json_file.open(filename);
+  json_file << "{\"runs\": [\n";
+  for (unsigned int r = 0; r < timers.size(); r++)
+  {
+    json_file << "  ";
+    timers[r].write_json(json_file);
+    json_file << (r + 1 < timers.size() ? ",\n" : "\n");
+  }
+  json_file << "]}\n";
+  json_file.close();
+}
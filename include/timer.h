@@ -0,0 +1,81 @@
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <cassert>
+
+using namespace std;
+
+// Accumulates the time spent in named phases (residual, boundary, update,
+// error, output, ...) of a run, with nanosecond resolution from
+// steady_clock, along with named counters like the number of time steps.
+//
+// Phases can be nested. The time of a phase does not include the time of the
+// phases started inside it, so that the phases add up to the total time, e.g.
+//   timer.start("update");
+//   timer.start("residual"); ... timer.stop("residual");
+//   timer.stop("update");
+// puts the time of the residual only in "residual".
+// Scoped_Timer does the start and stop for the enclosing block.
+class Timer
+{
+public:
+  Timer(string name = "");
+  void start(const string &phase);
+  void stop(const string &phase);
+  void count(const string &counter, long n = 1); // counter += n
+  // Parameters of the run (like N_x, cfl) that are put in the JSON record
+  void add_info(const string &key, double value);
+  void reset(); // Removes the phases, counters and info
+  void set_name(const string &name);
+
+  long long nanoseconds(const string &phase) const;
+  double seconds(const string &phase) const;
+  double total_seconds() const; // Sum over all phases
+  long counter(const string &counter) const;
+
+  // Table of phases with time, percentage and number of calls
+  void print(ostream &os = cout) const;
+  // One JSON object with the info, phases and counters of this run
+  void write_json(ostream &os) const;
+
+private:
+  struct Phase
+  {
+    string name;
+    long long ns; // Nanoseconds spent in this phase
+    long calls;
+  };
+  // There are a handful of phases and counters, so a linear search is cheaper
+  // than a map and keeps them in the order they were first used.
+  int find_phase(const string &phase);
+  int find_phase(const string &phase) const;
+
+  string name;
+  vector<Phase> phases;
+  vector<pair<string, long> > counters;
+  vector<pair<string, double> > info;
+  vector<int> running; // Stack of phases that were started, innermost last
+  chrono::steady_clock::time_point last; // When the innermost phase resumed
+};
+
+// Times the block in which it is declared as the phase 'phase' of timer
+class Scoped_Timer
+{
+public:
+  Scoped_Timer(Timer &timer, const string &phase);
+  ~Scoped_Timer();
+private:
+  Timer &timer;
+  string phase;
+};
+
+// Writes {"runs": [...]} with one object per timer, e.g. one per refinement
+// level
+void write_json(const vector<Timer> &timers, string filename);
+
+#endif
@@ -32,16 +32,18 @@ string get_filename(const string base_name,
    return name;
 }
 //Forms grid by taking tensor product of grid_x and grid_y
-//Solution is defined on the respective grid points.
+//The fields are defined on the respective grid points.
 void write_rectilinear_grid(vector<double> &grid_x,
                             vector<double> &grid_y,
-                            Array2D &solution,
+                            const vector<Array2D_View> &fields,
+                            const vector<string> &names,
                             double t,
                             int c, //Cycle number
                             string filename)
 {
-   const int nx = solution.sizex();
-   const int ny = solution.sizey();
+   assert(fields.size() > 0 && fields.size() == names.size());
+   const int nx = fields[0].sizex();
+   const int ny = fields[0].sizey();
    int nz = 1; // We have a 2d grid
    ofstream fout;
    fout.open(filename);
@@ -67,15 +69,45 @@ void write_rectilinear_grid(vector<double> &grid_x,
    fout << 0.0 << endl;
 
    fout << "POINT_DATA " << nx*ny*nz << endl;
-   fout << "SCALARS density float" << endl;
-   fout << "LOOKUP_TABLE default" << endl;
-   // no need for k-loop since nk=1
-   for(int j=0; j<ny; ++j)
+   for(unsigned int k=0; k<fields.size(); ++k)
    {
-      for(int i=0; i<nx; ++i)
-         fout << solution(i,j) << " ";
-      fout << endl;
+      const Array2D_View &solution = fields[k];
+      assert(solution.sizex() == nx && solution.sizey() == ny);
+      fout << "SCALARS " << names[k] << " float" << endl;
+      fout << "LOOKUP_TABLE default" << endl;
+      // no need for k-loop since nk=1
+      for(int j=0; j<ny; ++j)
+      {
+         for(int i=0; i<nx; ++i)
+            fout << solution(i,j) << " ";
+         fout << endl;
+      }
    }
+   fout.close();
+}
+void vtk_anim_sol(vector<double> &grid_x,vector<double> &grid_y,
+                  const vector<Array2D_View> &fields,
+                  const vector<string> &names,
+                  double t,
+                  int time_step_number,
+                  string filename)
+{
+  filename = filename+"_";
+  filename = get_filename(filename,3,time_step_number);
+  write_rectilinear_grid(grid_x, grid_y, fields, names, t, time_step_number,
+                         filename);
+}
+
+void write_rectilinear_grid(vector<double> &grid_x,
+                            vector<double> &grid_y,
+                            Array2D &solution,
+                            double t,
+                            int c, //Cycle number
+                            string filename)
+{
+   write_rectilinear_grid(grid_x, grid_y,
+                          vector<Array2D_View>(1, Array2D_View(solution)),
+                          vector<string>(1, "density"), t, c, filename);
 }
 void vtk_anim_sol(vector<double> &grid_x,vector<double> &grid_y,
                   Array2D& solution,
@@ -98,66 +130,13 @@ void write_rectilinear_grid(vector<double> &grid_x,
                             int c, //Cycle number
                             string filename)
 {
-   const int nx = solution.sizex();
-   const int ny = solution.sizey();
-   /*if ( (grid_x.size() != nx) || (grid_y.size() != ny))
-    {
-      cout << "Grid and solution sizes don't match." <<endl;
-      cout << "grid.sizex = "<< grid_x.size() << ", solution.sizex = "<<nx;
-      cout << "grid.sizey = "<< grid_y.size() << ", solution.sizey = "<<ny;
-      assert(false);
-    }
-  */
-   int nz = 1; // We have a 2d grid
-  /*  fout.open(filename)
-      write_grid(fout,nx,ny,dx,dy)
-      write_sol(fout,nxny,solution,"solution")
-      write_sol(fout,nx,ny,solution_exact,"solution_exact")
-  */
-   ofstream fout;
-   fout.open(filename);
-   fout << "# vtk DataFile Version 3.0" << endl;
-   fout << "Cartesian grid" << endl;
-   fout << "ASCII" << endl;
-   fout << "DATASET RECTILINEAR_GRID" << endl;
-   fout << "FIELD FieldData 2" << endl;
-   fout << "TIME 1 1 double" << endl;
-   fout << t << endl;
-   fout << "CYCLE 1 1 int" << endl;
-   fout << c << endl;
-   fout << "DIMENSIONS " << nx << " " << ny << " " << nz << endl;
-   fout << "X_COORDINATES " << nx << " float" << endl;
-   for(int i=0; i<nx; ++i)
-      fout << grid_x[i] << " ";
-   fout << endl;
-   fout << "Y_COORDINATES " << ny << " float" << endl;
-   for(int j=0; j<ny; ++j)
-      fout << grid_y[j] << " ";
-   fout << endl;
-   fout << "Z_COORDINATES " << nz << " float" << endl;
-   fout << 0.0 << endl;
-
-   fout << "POINT_DATA " << nx*ny*nz << endl;
-   fout << "SCALARS density float" << endl;
-   fout << "LOOKUP_TABLE default" << endl;
-   // no need for k-loop since nk=1
-   for(int j=0; j<ny; ++j)
-   {
-      for(int i=0; i<nx; ++i)
-         fout << solution(i,j) << " ";
-      fout << endl;
-   }
-
-   fout << "SCALARS density_exact float" << endl;
-   fout << "LOOKUP_TABLE default" << endl;
-   // no need for k-loop since nk=1
-   for(int j=0; j<ny; ++j)
-   {
-      for(int i=0; i<nx; ++i)
-         fout << solution_exact(i,j) << " ";
-      fout << endl;
-   }
-   fout.close();
+   vector<Array2D_View> fields;
+   fields.push_back(Array2D_View(solution));
+   fields.push_back(Array2D_View(solution_exact));
+   vector<string> names;
+   names.push_back("density");
+   names.push_back("density_exact");
+   write_rectilinear_grid(grid_x, grid_y, fields, names, t, c, filename);
 }
 void vtk_anim_sol(vector<double> &grid_x,vector<double> &grid_y,
                   Array2D& solution, Array2D& solution_exact,
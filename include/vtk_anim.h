@@ -4,6 +4,7 @@
 #include <fstream>
 #include <cmath>
 #include <string>
+#include <vector>
 #include <cassert>
 
 #include "array2d.h"
@@ -15,6 +16,23 @@ string get_filename(const string base_name,
                     const int ndigits,
                     const int c);
 //Forms grid by taking tensor product of grid_x and grid_y
+//The fields are defined on the respective grid points, and are written as
+//SCALARS names[k]. They can be components of a MultiArray2D.
+void write_rectilinear_grid(vector<double> &grid_x,
+                            vector<double> &grid_y,
+                            const vector<Array2D_View> &fields,
+                            const vector<string> &names,
+                            double t,
+                            int c, //Cycle number
+                            string filename);
+
+void vtk_anim_sol(vector<double> &grid_x,vector<double> &grid_y,
+                  const vector<Array2D_View> &fields,
+                  const vector<string> &names,
+                  double t,
+                  int time_step_number,
+                  string filename);
+
 //Solution is defined on the respective grid points.
 void write_rectilinear_grid(vector<double> &grid_x,
                             vector<double> &grid_y,
@@ -175,3 +175,133 @@ void vtk_anim_sol(vector<double> &grid_x,vector<double> &grid_y,
   write_rectilinear_grid(grid_x, grid_y, grid_z, solution, solution_exact, t,
                          time_step_number, filename);
 }
+
+
+// Parallel output
+
+// "LittleEndian" or "BigEndian", as needed by the VTK XML formats
+static string byte_order()
+{
+  const int one = 1;
+  if (*(const char*)&one == 1)
+    return "LittleEndian";
+  else
+    return "BigEndian";
+}
+
+// Raw appended data of VTK XML files is the size in bytes followed by
+// the values
+static void write_appended_array(ofstream &fout, vector<double> &values)
+{
+  unsigned long long nbytes = values.size() * sizeof(double);
+  fout.write(reinterpret_cast<const char*>(&nbytes), sizeof(nbytes));
+  fout.write(reinterpret_cast<const char*>(values.data()), nbytes);
+}
+
+void write_rectilinear_piece(vector<double> &grid_x,
+                             vector<double> &grid_y,
+                             vector<double> &grid_z,
+                             Array3D &solution,
+                             int extent[6],
+                             double t,
+                             int c, //Cycle number
+                             string filename)
+{
+   const int nx = extent[1] - extent[0] + 1;
+   const int ny = extent[3] - extent[2] + 1;
+   const int nz = extent[5] - extent[4] + 1;
+   assert(int(grid_x.size()) >= nx && int(grid_y.size()) >= ny
+          && int(grid_z.size()) >= nz);
+   // VTK wants x to be the fastest index
+   vector<double> values(nx*ny*nz);
+   int c_value = 0;
+   for(int k=0; k<nz; ++k)
+      for(int j=0; j<ny; ++j)
+         for(int i=0; i<nx; ++i)
+            values[c_value++] = solution(i,j,k);
+   vector<double> x(grid_x.begin(), grid_x.begin()+nx);
+   vector<double> y(grid_y.begin(), grid_y.begin()+ny);
+   vector<double> z(grid_z.begin(), grid_z.begin()+nz);
+
+   // Offsets of the arrays in the appended data, each has an 8 byte size
+   const unsigned long long header = sizeof(unsigned long long);
+   unsigned long long offset[4];
+   offset[0] = 0;
+   offset[1] = offset[0] + header + values.size()*sizeof(double);
+   offset[2] = offset[1] + header + x.size()*sizeof(double);
+   offset[3] = offset[2] + header + y.size()*sizeof(double);
+
+   string ext = to_string(extent[0]) + " " + to_string(extent[1]) + " "
+              + to_string(extent[2]) + " " + to_string(extent[3]) + " "
+              + to_string(extent[4]) + " " + to_string(extent[5]);
+   ofstream fout;
+   fout.open(filename, ios::binary);
+   fout << "<?xml version=\"1.0\"?>" << endl;
+   fout << "<VTKFile type=\"RectilinearGrid\" version=\"1.0\" byte_order=\""
+        << byte_order() << "\" header_type=\"UInt64\">" << endl;
+   fout << "  <RectilinearGrid WholeExtent=\"" << ext << "\">" << endl;
+   fout << "    <FieldData>" << endl;
+   fout << "      <DataArray type=\"Float64\" Name=\"TIME\" NumberOfTuples=\"1\""
+        << " format=\"ascii\"> " << t << " </DataArray>" << endl;
+   fout << "      <DataArray type=\"Int32\" Name=\"CYCLE\" NumberOfTuples=\"1\""
+        << " format=\"ascii\"> " << c << " </DataArray>" << endl;
+   fout << "    </FieldData>" << endl;
+   fout << "    <Piece Extent=\"" << ext << "\">" << endl;
+   fout << "      <PointData Scalars=\"solution\">" << endl;
+   fout << "        <DataArray type=\"Float64\" Name=\"solution\""
+        << " format=\"appended\" offset=\"" << offset[0] << "\"/>" << endl;
+   fout << "      </PointData>" << endl;
+   fout << "      <Coordinates>" << endl;
+   fout << "        <DataArray type=\"Float64\" Name=\"x\""
+        << " format=\"appended\" offset=\"" << offset[1] << "\"/>" << endl;
+   fout << "        <DataArray type=\"Float64\" Name=\"y\""
+        << " format=\"appended\" offset=\"" << offset[2] << "\"/>" << endl;
+   fout << "        <DataArray type=\"Float64\" Name=\"z\""
+        << " format=\"appended\" offset=\"" << offset[3] << "\"/>" << endl;
+   fout << "      </Coordinates>" << endl;
+   fout << "    </Piece>" << endl;
+   fout << "  </RectilinearGrid>" << endl;
+   fout << "  <AppendedData encoding=\"raw\">" << endl;
+   fout << "_";
+   write_appended_array(fout, values);
+   write_appended_array(fout, x);
+   write_appended_array(fout, y);
+   write_appended_array(fout, z);
+   fout << endl << "  </AppendedData>" << endl;
+   fout << "</VTKFile>" << endl;
+   fout.close();
+}
+
+void write_parallel_rectilinear_index(int whole_extent[6],
+                                      int extents[],
+                                      vector<string> &piece_names,
+                                      string filename)
+{
+   ofstream fout;
+   fout.open(filename);
+   fout << "<?xml version=\"1.0\"?>" << endl;
+   fout << "<VTKFile type=\"PRectilinearGrid\" version=\"1.0\" byte_order=\""
+        << byte_order() << "\" header_type=\"UInt64\">" << endl;
+   fout << "  <PRectilinearGrid WholeExtent=\"";
+   for (int d = 0; d < 6; d++)
+      fout << whole_extent[d] << ((d < 5) ? " " : "");
+   fout << "\" GhostLevel=\"0\">" << endl;
+   fout << "    <PPointData Scalars=\"solution\">" << endl;
+   fout << "      <PDataArray type=\"Float64\" Name=\"solution\"/>" << endl;
+   fout << "    </PPointData>" << endl;
+   fout << "    <PCoordinates>" << endl;
+   fout << "      <PDataArray type=\"Float64\" Name=\"x\"/>" << endl;
+   fout << "      <PDataArray type=\"Float64\" Name=\"y\"/>" << endl;
+   fout << "      <PDataArray type=\"Float64\" Name=\"z\"/>" << endl;
+   fout << "    </PCoordinates>" << endl;
+   for (unsigned int p = 0; p < piece_names.size(); p++)
+   {
+      fout << "    <Piece Extent=\"";
+      for (int d = 0; d < 6; d++)
+         fout << extents[6*p+d] << ((d < 5) ? " " : "");
+      fout << "\" Source=\"" << piece_names[p] << "\"/>" << endl;
+   }
+   fout << "  </PRectilinearGrid>" << endl;
+   fout << "</VTKFile>" << endl;
+   fout.close();
+}
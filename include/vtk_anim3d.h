@@ -45,4 +45,27 @@ void vtk_anim_sol(vector<double> &grid_x,vector<double> &grid_y,
                    double t,
                   int time_step_number,
                   string filename);
+
+// Parallel output
+
+// Writes the part of a distributed solution held by one process as a piece
+// (.vtr) of a parallel VTK file, in binary. extent = {i0,i1,j0,j1,k0,k1} are
+// the global indices of the points written and solution(0,0,0) is the
+// point (i0,j0,k0), so i1-i0+1 can go into the ghost layer. grid_x, grid_y,
+// grid_z are the coordinates of the points written.
+void write_rectilinear_piece(vector<double> &grid_x,
+                             vector<double> &grid_y,
+                             vector<double> &grid_z,
+                             Array3D &solution,
+                             int extent[6],
+                             double t,
+                             int c, //Cycle number
+                             string filename);
+
+// Writes the index (.pvtr) of a parallel VTK file. extents[6*p,...,6*p+5]
+// is the extent of piece p, which is in the file piece_names[p].
+void write_parallel_rectilinear_index(int whole_extent[6],
+                                      int extents[],
+                                      vector<string> &piece_names,
+                                      string filename);
 #endif
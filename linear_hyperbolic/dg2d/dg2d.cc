@@ -0,0 +1,480 @@
+//Solving Q_t + (uQ)_x + (vQ)_y = 0 with the nodal discontinuous Galerkin
+//method, on the periodic grid and with the velocities of fv2d_var_coeff
+
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cassert>
+#include <string>
+#include <cstring>
+#include <algorithm>
+
+#include "../../include/array2d.h"
+#include "../../include/vtk_anim.h"
+#include "../../include/initial_conditions.h"
+#include "../../include/error_evaluation.h"
+#include "../../include/timer.h"
+#include "../../include/dg_basis.h"
+using namespace std;
+
+//Computes advection_velocity in x direction at (x,y)
+void rotational_velocity(double x, double y, double vel[2])
+{
+  vel[0] = -y, vel[1] = x;
+}
+
+void constant_velocity(double x, double y, double vel[2])
+{
+  (void)x,(void)y;
+  vel[0] = 1.0, vel[1] = 1.0;
+}
+
+void (*advection_velocity)(double, double, double vel[2]) = &rotational_velocity;
+
+//Low storage five stage, fourth order Runge-Kutta method of Carpenter and
+//Kennedy (1994), with the stages
+//  k = A_s k + dt res(Q),  Q = Q + B_s k,  s = 0,...,4
+//so that only Q and k are kept. Its stability region is larger than that of
+//the SSP-RK3 of the finite volume solvers, and the time error stays below
+//the error in space up to degree 4.
+const double lsrk_a[5] = {0.0,
+                          -567301805773.0/1357537059087.0,
+                          -2404267990393.0/2016746695238.0,
+                          -3550918686646.0/2091501179385.0,
+                          -1275806237668.0/842570457699.0};
+const double lsrk_b[5] = {1432997174477.0/9575080441755.0,
+                          5161836677717.0/13612068292357.0,
+                          1720146321549.0/2090206949498.0,
+                          3134564353537.0/4481467310338.0,
+                          2277821191437.0/14882151754819.0};
+
+//DG with the polynomials of degree N-1 in x and y in each cell, in the nodal
+//basis l_a(xi) l_b(eta) of the N x N Gauss-Legendre points (include/dg_basis.h)
+//and the upwind flux at the faces. The values of cell c = i + j*N_x are
+//contiguous, Q[c*N*N + a + b*N] at the node (xi_a,eta_b), so that a cell is
+//read once per stage, and the cells are threaded with OpenMP
+//(make openmp=yes).
+//
+//With the Gauss quadrature on the nodes, the mass matrix is diagonal and the
+//weak form is, with the 1D matrix D_ac = w_c l_a'(xi_c)/w_a,
+//  dQ_ab/dt = 2/dx (sum_c D_ac (uQ)_cb - (l_a(1) F_r(b) - l_a(-1) F_l(b))/w_a)
+//           + 2/dy (sum_d D_bd (vQ)_ad - (l_b(1) G_t(a) - l_b(-1) G_b(a))/w_b)
+//where F_l, F_r are the fluxes at the nodes of the left and right faces and
+//G_b, G_t those of the bottom and top faces. The volume terms are 1D
+//products along each direction (sum factorization), N^3 operations per cell
+//instead of the N^4 of the full 2D matrix, and the face values are also 1D
+//products, the traces.
+template <int N>
+class DG_Advection_2d
+{
+public:
+  DG_Advection_2d(int N_x, int N_y, double cfl, double final_time,
+                  int initial_data_indicator, bool constant);
+
+  void run(bool output_indicator);
+  Error_Norms get_error();
+  const Timer& get_timer() const { return timer; }
+
+private:
+  static const int n_nodes = N*N; //Per cell
+
+  void set_initial_solution();
+  void compute_time_step();
+  //Values at the nodes of the 4 faces of each cell, for the fluxes
+  void compute_traces(const vector<double> &Q);
+  void compute_residual(const vector<double> &Q, vector<double> &res);
+  void apply_lsrk();
+  void output_solution(int c);
+
+  int N_x, N_y;
+  double dx, dy, dt, t, final_time, cfl;
+  double xmin, xmax, ymin, ymax;
+  bool constant; //(u,v) = (1,1), for the exact solution
+  I_Functions initial_function;
+
+  //1D operators of the weak form, see above
+  double weights[N], D[N][N];
+  double ext_l[N], ext_r[N];   //l_a(-1), l_a(1)
+  double lift_l[N], lift_r[N]; //l_a(-1)/w_a, l_a(1)/w_a
+
+  vector<double> solution, k_stage, residual;
+  vector<double> x_node, y_node, u_node, v_node;
+  //u at the nodes of the right face of each cell, v at those of the top face
+  vector<double> u_face, v_face;
+  //Values at the left, right, bottom and top faces of each cell
+  vector<double> trace_l, trace_r, trace_b, trace_t;
+
+  vector<double> grid_x, grid_y;
+  Array2D cell_mean; //For the output
+
+  Timer timer; //Time of residual, update, error and output phases
+};
+
+template <int N>
+DG_Advection_2d<N>::DG_Advection_2d(int N_x, int N_y, double cfl,
+                                    double final_time,
+                                    int initial_data_indicator,
+                                    bool constant)
+:
+N_x(N_x), N_y(N_y), t(0.0), final_time(final_time), cfl(cfl),
+constant(constant), timer("dg2d p=" + to_string(N-1))
+{
+  xmin = -1.0, xmax = 1.0, ymin = -1.0, ymax = 1.0;
+  dx = (xmax - xmin)/N_x, dy = (ymax - ymin)/N_y;
+  initial_function.set(initial_data_indicator,xmin,xmax,ymin,ymax);
+
+  const DG_Basis_1d basis(N-1);
+  for (int a = 0; a < N; a++)
+  {
+    weights[a] = basis.weights[a];
+    ext_l[a] = basis.left[a], ext_r[a] = basis.right[a];
+    lift_l[a] = basis.left[a]/basis.weights[a];
+    lift_r[a] = basis.right[a]/basis.weights[a];
+    for (int c = 0; c < N; c++)
+      D[a][c] = basis.weights[c]*basis.derivative[a*N + c]/basis.weights[a];
+  }
+
+  const int n_dofs = N_x*N_y*n_nodes;
+  solution.resize(n_dofs), k_stage.resize(n_dofs), residual.resize(n_dofs);
+  x_node.resize(n_dofs), y_node.resize(n_dofs);
+  u_node.resize(n_dofs), v_node.resize(n_dofs);
+  u_face.resize(N_x*N_y*N), v_face.resize(N_x*N_y*N);
+  trace_l.resize(N_x*N_y*N), trace_r.resize(N_x*N_y*N);
+  trace_b.resize(N_x*N_y*N), trace_t.resize(N_x*N_y*N);
+  grid_x.resize(N_x), grid_y.resize(N_y);
+  cell_mean.resize(N_x,N_y);
+
+  double vel[2];
+  for (int j = 0; j < N_y; j++)
+    for (int i = 0; i < N_x; i++)
+    {
+      const int c = i + j*N_x;
+      const double xc = xmin + (i + 0.5)*dx, yc = ymin + (j + 0.5)*dy;
+      grid_x[i] = xc, grid_y[j] = yc;
+      for (int b = 0; b < N; b++)
+        for (int a = 0; a < N; a++)
+        {
+          const int k = c*n_nodes + a + b*N;
+          x_node[k] = xc + 0.5*dx*basis.nodes[a];
+          y_node[k] = yc + 0.5*dy*basis.nodes[b];
+          (*advection_velocity)(x_node[k], y_node[k], vel);
+          u_node[k] = vel[0], v_node[k] = vel[1];
+        }
+      for (int m = 0; m < N; m++)
+      {
+        (*advection_velocity)(xc + 0.5*dx, yc + 0.5*dy*basis.nodes[m], vel);
+        u_face[c*N + m] = vel[0];
+        (*advection_velocity)(xc + 0.5*dx*basis.nodes[m], yc + 0.5*dy, vel);
+        v_face[c*N + m] = vel[1];
+      }
+    }
+  compute_time_step();
+  cout << "dx = " << dx << endl;
+  cout << "dy = " << dy << endl;
+  cout << "dt = " << dt << endl;
+  timer.add_info("N_x", N_x);
+  timer.add_info("degree", N-1);
+  timer.add_info("cfl", cfl);
+}
+
+//The Courant number of degree p is about 1/(2p+1) of that of the first order
+//finite volume scheme
+template <int N>
+void DG_Advection_2d<N>::compute_time_step()
+{
+  double u0max = 0.0, u1max = 0.0;
+  for (unsigned int k = 0; k < u_node.size(); k++)
+    u0max = max(u0max,abs(u_node[k])), u1max = max(u1max,abs(v_node[k]));
+  u0max = max(1.0,u0max), u1max = max(1.0,u1max);
+  dt = cfl/((2*N - 1)*(u0max/dx + u1max/dy));
+}
+
+template <int N>
+void DG_Advection_2d<N>::set_initial_solution()
+{
+  initial_function.value(int(solution.size()), &x_node[0], &y_node[0],
+                         &solution[0]);
+  fill(k_stage.begin(), k_stage.end(), 0.0);
+}
+
+template <int N>
+void DG_Advection_2d<N>::compute_traces(const vector<double> &Q)
+{
+  const int n_cells = N_x*N_y;
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for (int c = 0; c < n_cells; c++)
+  {
+    const double *q = &Q[c*n_nodes];
+    for (int m = 0; m < N; m++)
+    {
+      double l = 0.0, r = 0.0, b = 0.0, t = 0.0;
+      for (int n = 0; n < N; n++)
+      {
+        l += ext_l[n]*q[n + m*N], r += ext_r[n]*q[n + m*N];
+        b += ext_l[n]*q[m + n*N], t += ext_r[n]*q[m + n*N];
+      }
+      trace_l[c*N + m] = l, trace_r[c*N + m] = r;
+      trace_b[c*N + m] = b, trace_t[c*N + m] = t;
+    }
+  }
+}
+
+//The upwind flux at each face is computed by both of its cells, so that the
+//cells are independent
+template <int N>
+void DG_Advection_2d<N>::compute_residual(const vector<double> &Q,
+                                          vector<double> &res)
+{
+  compute_traces(Q);
+  const double rx = 2.0/dx, ry = 2.0/dy;
+#ifdef _OPENMP
+  #pragma omp parallel for collapse(2) schedule(static)
+#endif
+  for (int j = 0; j < N_y; j++)
+    for (int i = 0; i < N_x; i++)
+    {
+      const int c = i + j*N_x;
+      const int c_l = (i == 0 ? N_x-1 : i-1) + j*N_x;
+      const int c_r = (i == N_x-1 ? 0 : i+1) + j*N_x;
+      const int c_b = i + (j == 0 ? N_y-1 : j-1)*N_x;
+      const int c_t = i + (j == N_y-1 ? 0 : j+1)*N_x;
+      const double *q = &Q[c*n_nodes];
+      const double *u = &u_node[c*n_nodes], *v = &v_node[c*n_nodes];
+      double f[n_nodes], g[n_nodes];
+      for (int k = 0; k < n_nodes; k++)
+        f[k] = u[k]*q[k], g[k] = v[k]*q[k];
+      double F_l[N], F_r[N], G_b[N], G_t[N];
+      for (int m = 0; m < N; m++)
+      {
+        double un = u_face[c*N + m];
+        F_r[m] = max(un,0.0)*trace_r[c*N + m] + min(un,0.0)*trace_l[c_r*N + m];
+        un = u_face[c_l*N + m];
+        F_l[m] = max(un,0.0)*trace_r[c_l*N + m] + min(un,0.0)*trace_l[c*N + m];
+        un = v_face[c*N + m];
+        G_t[m] = max(un,0.0)*trace_t[c*N + m] + min(un,0.0)*trace_b[c_t*N + m];
+        un = v_face[c_b*N + m];
+        G_b[m] = max(un,0.0)*trace_t[c_b*N + m] + min(un,0.0)*trace_b[c*N + m];
+      }
+      double *r = &res[c*n_nodes];
+      for (int b = 0; b < N; b++)
+        for (int a = 0; a < N; a++)
+        {
+          double r_x = 0.0, r_y = 0.0;
+          for (int m = 0; m < N; m++)
+            r_x += D[a][m]*f[m + b*N], r_y += D[b][m]*g[a + m*N];
+          r[a + b*N] = rx*(r_x - lift_r[a]*F_r[b] + lift_l[a]*F_l[b])
+                       + ry*(r_y - lift_r[b]*G_t[a] + lift_l[b]*G_b[a]);
+        }
+    }
+}
+
+template <int N>
+void DG_Advection_2d<N>::apply_lsrk()
+{
+  const int n_dofs = int(solution.size());
+  for (int s = 0; s < 5; s++)
+  {
+    timer.start("residual");
+    compute_residual(solution, residual);
+    timer.stop("residual");
+    Scoped_Timer update_timer(timer, "update");
+    const double a = lsrk_a[s], b = lsrk_b[s];
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int k = 0; k < n_dofs; k++)
+    {
+      k_stage[k] = a*k_stage[k] + dt*residual[k];
+      solution[k] += b*k_stage[k];
+    }
+  }
+}
+
+template <int N>
+void DG_Advection_2d<N>::output_solution(int c)
+{
+  Scoped_Timer output_timer(timer, "output");
+  for (int j = 0; j < N_y; j++)
+    for (int i = 0; i < N_x; i++)
+    {
+      const double *q = &solution[(i + j*N_x)*n_nodes];
+      double mean = 0.0;
+      for (int b = 0; b < N; b++)
+        for (int a = 0; a < N; a++)
+          mean += 0.25*weights[a]*weights[b]*q[a + b*N];
+      cell_mean(i,j) = mean;
+    }
+  vtk_anim_sol(grid_x, grid_y, cell_mean, t, c, "approximate_solution");
+}
+
+template <int N>
+void DG_Advection_2d<N>::run(bool output_indicator)
+{
+  set_initial_solution();
+  int time_step_number = 0;
+  if (output_indicator)
+    output_solution(0);
+  while (t < final_time)
+  {
+    if (t+dt > final_time) //Ensure we end at final_time
+      dt = final_time-t;
+    apply_lsrk();
+    time_step_number += 1;
+    t = t + dt;
+    timer.count("time_steps");
+    timer.count("dof_updates", long(solution.size()));
+    if (output_indicator && time_step_number%15 == 0)
+      output_solution(time_step_number/15);
+  }
+  cout << "For N_x = " << N_x << ", N_y = " << N_y << ", degree " << N-1
+       << ", we took " << time_step_number << " steps." << endl;
+}
+
+//Norms of the error with the quadrature on the nodes, normalized by the area
+//as those of Error_Accumulator
+template <int N>
+Error_Norms DG_Advection_2d<N>::get_error()
+{
+  Scoped_Timer error_timer(timer, "error");
+  vector<double> exact(solution.size());
+  double vel[2] = {1.0, 1.0};
+  initial_function.exact_value(int(solution.size()), &x_node[0], &y_node[0],
+                               t, vel, constant, &exact[0]);
+  Error_Norms norms = {0.0, 0.0, 0.0, 0.0, 0.0, long(N_x)*N_y, false};
+  for (int c = 0; c < N_x*N_y; c++)
+    for (int b = 0; b < N; b++)
+      for (int a = 0; a < N; a++)
+      {
+        const int k = c*n_nodes + a + b*N;
+        const double w = 0.25*weights[a]*weights[b];
+        const double e = abs(solution[k] - exact[k]);
+        norms.l1 += w*e, norms.l2 += w*e*e;
+        norms.linfty = max(norms.linfty, e);
+      }
+  norms.l1 /= N_x*N_y, norms.l2 = sqrt(norms.l2/(N_x*N_y));
+  return norms;
+}
+
+template <int N>
+void run_and_output(int N_x, int N_y, double cfl, double final_time,
+                    int initial_data_indicator, unsigned int n_refinements,
+                    bool constant)
+{
+  ofstream error_vs_h("error_vs_h.txt");
+  vector<double> linfty_vector, l2_vector, l1_vector;
+  vector<Timer> timers;
+  for (unsigned int refinement_level = 0; refinement_level <= n_refinements;
+       refinement_level++)
+  {
+    DG_Advection_2d<N> solver(N_x, N_y, cfl, final_time,
+                              initial_data_indicator, constant);
+    solver.run(refinement_level==n_refinements);//Output only last soln
+    const Error_Norms norms = solver.get_error();
+    l1_vector.push_back(norms.l1), l2_vector.push_back(norms.l2);
+    linfty_vector.push_back(norms.linfty);
+    const Timer &timer = solver.get_timer();
+    cout << "Time taken by this refinement level is " << timer.total_seconds()
+         << " seconds, " << 1e9*timer.total_seconds()/timer.counter("dof_updates")
+         << " ns per degree of freedom and time step." << endl;
+    timers.push_back(timer);
+    double h = 2.*sqrt(1./(N_x*N_x) +1./(N_y*N_y));
+    error_vs_h << h << " " << linfty_vector[refinement_level] << "\n";
+    N_x = 2 * N_x,N_y = 2*N_y;
+    if (refinement_level > 0) //Computing convergence rate.
+    {
+      cout << "L2 convergence rate at refinement level ";
+      cout << refinement_level<< " is " ;
+      cout << abs(log(l2_vector[refinement_level]
+                        / l2_vector[refinement_level - 1])) / log(2.0);
+      cout << endl;
+
+      cout << "L1 convergence rate at refinement level ";
+      cout << refinement_level << " is " ;
+      cout << abs(log(l1_vector[refinement_level]
+                        / l1_vector[refinement_level - 1])) / log(2.0);
+      cout << endl;
+      cout << "Linfty convergence rate at refinement level ";
+      cout << refinement_level << " is ";
+      cout << abs(log(linfty_vector[refinement_level]
+                        / linfty_vector[refinement_level - 1])) / log(2.0);
+      cout << endl;
+    }
+  }
+  error_vs_h.close();
+  write_json(timers, "timing.json");
+  cout << "After " << n_refinements << " refinements, l_infty error = ";
+  cout << linfty_vector[linfty_vector.size()-1] << endl;
+  cout << "The L1 error is " << l1_vector[linfty_vector.size()-1] << endl;
+  cout << "The L2 error is " << l2_vector[linfty_vector.size()-1] << endl;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 6 || argc > 7)
+    {
+      cout << "Incorrect format, use" << endl;
+      cout << "./dg2d degree cfl final_time initial_data_indicator ";
+      cout << "n_refinements [constant]\n";
+      cout << "degree = 1, 2, 3 or 4, the cfl is relative to 1/(2*degree+1)\n";
+      cout << "Choices for initial data 0 - smooth_sine \n 1 - hat \n";
+      cout << "2 - step \n 3 - exp_func_25 \n 4 - exp_func_50\n5 - cts_sine\n";
+      cout << "The velocity is the rotation (-y,x) of fv2d_var_coeff, ";
+      cout << "constant at the end sets it to (1,1).\n";
+      cout << "Putting 2pi in place of final_time will work.\n";
+      assert(false);
+    }
+    bool constant = false;
+    if (argc == 7)
+    {
+      if (strcmp(argv[6],"constant") != 0)
+      {
+        cout << "Last argument must be constant, you put " << argv[6] << endl;
+        assert(false);
+      }
+      constant = true;
+      advection_velocity = &constant_velocity;
+      cout <<"Scheme will be run with constant (u,v)=(1,1)"<<endl;
+    }
+    const int degree = stoi(argv[1]);
+    cout << "degree = " << degree << endl;
+    double cfl = stod(argv[2]);
+    cout << "cfl = " << cfl << endl;
+    double final_time;
+    if (strcmp(argv[3],"2pi")==0)
+      final_time = 2.0*M_PI;
+    else
+      final_time = stod(argv[3]);
+    cout << "final_time = " << final_time << endl;
+    int initial_data_indicator = stoi(argv[4]);
+    cout << "initial_data_indicator = " << initial_data_indicator << endl;
+    unsigned int n_refinements = stoi(argv[5]);
+    cout << "n_refinements = " << n_refinements <<endl;
+    int N_x = 10, N_y = 10;
+    //The degree is a template parameter, so that the loops over the nodes of
+    //a cell have fixed lengths and are unrolled
+    switch (degree)
+    {
+    case 1:
+      run_and_output<2>(N_x, N_y, cfl, final_time, initial_data_indicator,
+                        n_refinements, constant);
+      break;
+    case 2:
+      run_and_output<3>(N_x, N_y, cfl, final_time, initial_data_indicator,
+                        n_refinements, constant);
+      break;
+    case 3:
+      run_and_output<4>(N_x, N_y, cfl, final_time, initial_data_indicator,
+                        n_refinements, constant);
+      break;
+    case 4:
+      run_and_output<5>(N_x, N_y, cfl, final_time, initial_data_indicator,
+                        n_refinements, constant);
+      break;
+    default:
+      cout << "The degree must be 1, 2, 3 or 4, not " << degree << endl;
+      assert(false);
+    }
+}
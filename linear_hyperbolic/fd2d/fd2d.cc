@@ -11,6 +11,9 @@
 #include "../../include/array2d.cc"
 #include "../../include/vtk_anim.h"
 #include "../../include/vtk_anim.cc"
+#include "../../include/stencil2d.h"
+#include "../../include/spectral.h"
+#include "../../include/spectral.cc"
 using namespace std;
 
 //Returns true if real number is integer, false otherwise.
@@ -71,6 +74,7 @@ private:
 
     void evaluate_error_and_output_solution(const int time_step_number,
                                             bool output_indicator);
+    void spectral_run(bool output_indicator);
     vector<double> grid_x,grid_y;
     double theta, coefficient_x, coefficient_y, x_min, x_max, y_min, y_max;
 
@@ -84,6 +88,9 @@ private:
 
     Array2D error;
     double snapshot_error;
+    //Exact solution by Fourier transform of the initial data, for the spectral
+    //method and as a reference in get_error
+    Spectral_Solver spectral;
     //After a certain time, by periodicity, the solution equals the initial soln
     //For the PDE qt + uqx + vqy = 0, the exact solution is q(x,y,t)=f(x-ut,y-vt)
     //Since we are assuming periodicity in both $x$ and $y$ directions with
@@ -147,6 +154,8 @@ Linear_Convection_2d::Linear_Convection_2d(double n_points,
     solution_old.resize(n_points,n_points,1);
     solution.resize(n_points,n_points,1);
     solution_exact.resize(n_points,n_points);
+    spectral = Spectral_Solver(n_points, n_points, x_max - x_min, y_max - y_min,
+                               coefficient_x, coefficient_y, 0.0);
 }
 
 void Linear_Convection_2d::make_grid()
@@ -191,57 +200,52 @@ void Linear_Convection_2d::set_initial_solution()
           initial_solution(i,j) = solution(i,j); //Stored only
           //for snapshot error
       }
+    spectral.set_initial_data(initial_solution.ptr(0,0),
+                              initial_solution.stride());
 }
 
 void Linear_Convection_2d::upwind()
 {
-  double flux_x,flux_y;
-  for (unsigned int i = 0; i < n_points; i++)
-    for (unsigned int j = 0; j < n_points; j++)
-    {
-
-      solution_old.update_fluff();
-      solution(i,j) = (1.0-lam_x-lam_y)*solution_old(i,j)
-                      +max(coefficient_x,0.)*(dt/dx)*solution_old(i-1,j)
-                      +max(coefficient_y,0.)*(dt/dy)*solution_old(i,j-1)
-                      -min(coefficient_x,0.)*(dt/dx)*solution_old(i+1,j)
-                      -min(coefficient_y,0.)*(dt/dy)*solution_old(i,j+1);
-    }
+  //Weights of the neighbours, the same at all points
+  const double w_0  = 1.0-lam_x-lam_y;
+  const double w_xm = max(coefficient_x,0.)*(dt/dx);
+  const double w_ym = max(coefficient_y,0.)*(dt/dy);
+  const double w_xp = -min(coefficient_x,0.)*(dt/dx);
+  const double w_yp = -min(coefficient_y,0.)*(dt/dy);
+  apply_stencil(solution_old, solution,
+                [=](const Stencil_Point &q, int, int)
+  {
+    return w_0*q(0,0) + w_xm*q(-1,0) + w_ym*q(0,-1)
+           + w_xp*q(1,0) + w_yp*q(0,1);
+  });
 }
 
 void Linear_Convection_2d::ct_upwind()
 {
-  for (unsigned int i = 0; i < n_points; i++)
-    for (unsigned int j = 0; j < n_points; j++)
-    {
-      solution_old.update_fluff();
-      solution(i,j) = (1.0-sigma_x)*(1.0-sigma_y)*solution_old(i,j)
-                      +sigma_x*(1-sigma_y)*solution_old(i-1,j)
-                      +(1-sigma_x)*sigma_y*solution_old(i,j-1)
-                      +sigma_x*sigma_y*solution_old(i-1,j-1);
-    }
+  const double sigma_x = this->sigma_x, sigma_y = this->sigma_y;
+  apply_stencil(solution_old, solution,
+                [=](const Stencil_Point &q, int, int)
+  {
+    return (1.0-sigma_x)*(1.0-sigma_y)*q(0,0)
+           +sigma_x*(1-sigma_y)*q(-1,0)
+           +(1-sigma_x)*sigma_y*q(0,-1)
+           +sigma_x*sigma_y*q(-1,-1);
+  });
 }
 
 void Linear_Convection_2d::lw()
 {
-  solution_old.update_fluff();
-  for (unsigned int i = 0; i < n_points; i++)
-      for (unsigned int j = 0; j < n_points; j++)
-      {
-        solution(i,j) = solution_old(i,j)
-                        -0.5*sigma_x*(solution_old(i+1,j)-solution_old(i-1,j))
-                        -0.5*sigma_y*(solution_old(i,j+1)-solution_old(i,j-1))
-                        +0.5*sigma_x*sigma_x*(solution_old(i+1,j)
-                                              -2.0*solution_old(i,j)
-                                              +solution_old(i-1,j))
-                        +0.25*sigma_x*sigma_y*(solution_old(i+1,j+1)
-                                              -solution_old(i+1,j-1)
-                                              -solution_old(i-1,j+1)
-                                              +solution_old(i-1,j-1))
-                        +0.5*sigma_y*sigma_y*(solution_old(i,j+1)
-                                              -2.0*solution_old(i,j)
-                                              +solution_old(i,j-1));
-      }
+  const double sigma_x = this->sigma_x, sigma_y = this->sigma_y;
+  apply_stencil(solution_old, solution,
+                [=](const Stencil_Point &q, int, int)
+  {
+    return q(0,0)
+           -0.5*sigma_x*(q(1,0)-q(-1,0))
+           -0.5*sigma_y*(q(0,1)-q(0,-1))
+           +0.5*sigma_x*sigma_x*(q(1,0)-2.0*q(0,0)+q(-1,0))
+           +0.25*sigma_x*sigma_y*(q(1,1)-q(1,-1)-q(-1,1)+q(-1,-1))
+           +0.5*sigma_y*sigma_y*(q(0,1)-2.0*q(0,0)+q(0,-1));
+  });
 }
 
 void Linear_Convection_2d::m_roe()
@@ -313,6 +317,11 @@ void Linear_Convection_2d::run(bool output_indicator)
     int time_step_number = 0; 
     set_initial_solution(); //sets solution to be the initial data
     evaluate_error_and_output_solution(time_step_number,output_indicator);
+    if (method == "spectral")
+    {
+        spectral_run(output_indicator);
+        return;
+    }
     while (t < running_time) //compute solution at next time step using solution_old
     {        
         solution_old = solution;//update solution_old for next time_step
@@ -334,6 +343,29 @@ void Linear_Convection_2d::run(bool output_indicator)
     cout << time_step_number << " steps." << endl;
 }
 
+//The spectral solution is exact in time, so it does not march the time
+//steps. It goes to each output time of the other methods, and then to
+//running_time itself, with one inverse transform of the initial data.
+void Linear_Convection_2d::spectral_run(bool output_indicator)
+{
+    int time_step_number = 5, n_transforms = 0;
+    if (output_indicator)
+      for (; time_step_number*dt < running_time; time_step_number += 5)
+      {
+          t = time_step_number*dt;
+          spectral.evaluate(t, solution.ptr(0,0), solution.stride());
+          n_transforms += 1;
+          evaluate_error_and_output_solution(time_step_number, true);
+      }
+    t = running_time;
+    spectral.evaluate(t, solution.ptr(0,0), solution.stride());
+    n_transforms += 1;
+    //The final solution is the next output frame
+    evaluate_error_and_output_solution(time_step_number, output_indicator);
+    cout << "For n_points = " << n_points << ", we took ";
+    cout << n_transforms << " inverse transforms." << endl;
+}
+
 void run_and_get_output(double n_points, double cfl,
                         string method, double running_time,
                         int initial_data_indicator,
@@ -461,6 +493,15 @@ void Linear_Convection_2d::get_error(vector<double> &l1_vector,
           linfty = max(linfty, error(i,j));            // L_infty error
       }
     l2 = sqrt(l2);
+    //Same L1 error with the spectral solution as the reference, which is
+    //exact for smooth data and costs one inverse transform
+    Array2D reference(n_points, n_points);
+    spectral.evaluate(t, reference.ptr(0,0), reference.stride());
+    double l1_spectral = 0.0;
+    for (int j = 0; j < n_points; j++)
+      for (int i = 0; i < n_points; i++)
+        l1_spectral += abs(solution(i,j) - reference(i,j)) * dx * dy;
+    cout << "L1 error with the spectral reference = " << l1_spectral << endl;
     l1_vector.push_back(l1);
     l2_vector.push_back(l2);
     linfty_vector.push_back(linfty);
@@ -496,7 +537,7 @@ int main(int argc, char **argv)
         cout << " sigma_x running_time initial_data_indicator " ;
         cout << "max_refinements" << endl;
         cout << "Choices for method"<<endl;
-        cout << "upwind, lw, ct_upwind, m_roe"<<endl;
+        cout << "upwind, lw, ct_upwind, m_roe, spectral"<<endl;
         cout << "Choices for initial data "<<endl;
         cout << "0 - smooth_sine"<<endl<<"1 - hat"<<endl;
 	cout << "2 - step"<<endl;
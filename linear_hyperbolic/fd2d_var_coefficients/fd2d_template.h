@@ -7,6 +7,8 @@
 #include <stdio.h>
 #include <sys/time.h>
 
+#include "../../include/stencil2d.h"
+
 class Linear_Convection_2d
 {
 public:
@@ -72,8 +74,8 @@ Linear_Convection_2d::Linear_Convection_2d(double n_points,
     cout << "lam_y = " <<lam_y << endl;
     //grid.resize(n_points);
     error.resize(n_points,n_points);
-    solution_old.resize(n_points,n_points);
-    solution.resize(n_points,n_points);
+    solution_old.resize(n_points,n_points,1); //Ghosts for the stencil
+    solution.resize(n_points,n_points,1);
     solution_exact.resize(n_points,n_points);
 }
 /*
@@ -116,28 +118,18 @@ void Linear_Convection_2d::set_initial_solution()
 
 void Linear_Convection_2d::upwind()
 {
-  solution(0,0) = (1.0-lam_x-lam_y)*solution_old(0,0)
-                    +max(coefficient_x,0.)*(dt/dx)*solution_old(n_points-1,0)
-                    +max(coefficient_y,0.)*(dt/dy)*solution_old(0,n_points-1)
-                    -min(coefficient_x,0.)*(dt/dx)*solution_old(1,0)
-                    -min(coefficient_y,0.)*(dt/dy)*solution_old(0,1);
-  for (unsigned int j = 1; j<n_points;j++)
-    {
-    solution(0,j) = (1.0-lam_x-lam_y)*solution_old(0,j)
-                    +max(coefficient_x,0.)*(dt/dx)*solution_old(n_points-1,j)
-                    +max(coefficient_y,0.)*(dt/dy)*solution_old(0,j-1)
-                    -min(coefficient_x,0.)*(dt/dx)*solution_old(1,j)
-                    -min(coefficient_y,0.)*(dt/dy)*solution_old(0,j+1);
-    }
-  for (unsigned int i = 1; i < n_points; i++)
-      for (unsigned int j = 1; j < n_points; j++)
-      {
-      solution(i,j) = (1.0-lam_x-lam_y)*solution_old(i,j)
-                      +max(coefficient_x,0.)*(dt/dx)*solution_old(i-1,j)
-                      +max(coefficient_y,0.)*(dt/dy)*solution_old(i,j-1)
-                      -min(coefficient_x,0.)*(dt/dx)*solution_old(i+1,j)
-                      -min(coefficient_y,0.)*(dt/dy)*solution_old(i,j+1);
-      }
+  //Weights of the neighbours, the same at all points
+  const double w_0  = 1.0-lam_x-lam_y;
+  const double w_xm = max(coefficient_x,0.)*(dt/dx);
+  const double w_ym = max(coefficient_y,0.)*(dt/dy);
+  const double w_xp = -min(coefficient_x,0.)*(dt/dx);
+  const double w_yp = -min(coefficient_y,0.)*(dt/dy);
+  apply_stencil(solution_old, solution,
+                [=](const Stencil_Point &q, int, int)
+  {
+    return w_0*q(0,0) + w_xm*q(-1,0) + w_ym*q(0,-1)
+           + w_xp*q(1,0) + w_yp*q(0,1);
+  });
 }
 
 void Linear_Convection_2d::evaluate_error_and_output_solution(int time_step_number)
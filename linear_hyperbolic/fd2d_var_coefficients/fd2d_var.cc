@@ -5,17 +5,18 @@
 #include <cassert>
 #include <string>
 #include <stdio.h>
-#include <sys/time.h>
 
-#include "/mnt/c/Users/arpit/Documents/GitHub/arpit_practise/include/array2d.h"
-#include "/mnt/c/Users/arpit/Documents/GitHub/arpit_practise/include/vtk_anim.h"
+#include "../../include/array2d.h"
+#include "../../include/vtk_anim.h"
+#include "../../include/timer.h"
+#include "../../include/error_evaluation.h"
+#include "../../include/stencil2d.h"
 
 using namespace std;
 
 //Returns true or false if real number is integer or not.
 bool  int_tester(double a)
 {
-    double dummy;
     double c = modf(a,&a);
     //cout << "Fractional part is "<<c<<endl;
     return (c<1e-4);
@@ -32,10 +33,12 @@ public:
     void run();
     void get_error(vector<double> &l1_vector, vector<double> &l2_vector, 
                    vector<double> &linfty_vector, vector<double> &snapshot_error);
+    const Timer& get_timer() const { return timer; }
 private:
     void make_grid();
     void set_initial_solution();
 
+    void set_upwind_weights();
     void upwind();
     void lw();
     void ct_upwind();
@@ -57,7 +60,15 @@ private:
 
     Array2D solution_exact; //Exact solution at present time step
 
-    Array2D error;
+    //Weights of the upwind scheme, computed once as the velocity does not
+    //change in time. For (u,v) = (-y,x), u only depends on the row j and v
+    //on the column i, so the weight of (i-1,j) is left_row[j], the one of
+    //(i,j-1) is down_column[i] and the one of (i,j) is
+    //center_row[j] - lam_y_column[i].
+    vector<double> center_row, left_row, right_row;
+    vector<double> lam_y_column, down_column, up_column;
+
+    Error_Accumulator errors; //Error at the present time step, kept as norms
     double snapshot_error;
     //After a certain time, by periodicity, the solution equals the initial soln
     //For the PDE qt + uqx + vqy = 0, the exact solution is q(x,y,t)=f(x-ut,y-vt)
@@ -73,6 +84,8 @@ private:
 
     string method;
     int initial_data_indicator;
+
+    Timer timer; //Time of boundary, update, error and output phases
 };
 
 Linear_Convection_2d::Linear_Convection_2d(double n_points, 
@@ -80,9 +93,10 @@ Linear_Convection_2d::Linear_Convection_2d(double n_points,
                                            string method,
                                            double running_time, int initial_data_indicator):
                                            n_points(n_points), 
-                                           lam_x(lam_x),
-                                           running_time(running_time), method(method),
-                                           initial_data_indicator(initial_data_indicator)
+                                           running_time(running_time),
+                                           lam_x(lam_x), method(method),
+                                           initial_data_indicator(initial_data_indicator),
+                                           timer("fd2d_var " + method)
 {
     theta = M_PI/4.0;
     // Coefficients are non-constant, only storing their max values temporarily,
@@ -114,11 +128,13 @@ Linear_Convection_2d::Linear_Convection_2d(double n_points,
     cout << "lam_x = " <<lam_x << endl;
     cout << "lam_y = " <<lam_y << endl;
     grid_x.resize(n_points), grid_y.resize(n_points);
-    error.resize(n_points,n_points);
     initial_solution.resize(n_points,n_points);
-    solution_old.resize(n_points,n_points);
-    solution.resize(n_points,n_points);
+    solution_old.resize(n_points,n_points,1); //Ghosts for the stencils
+    solution.resize(n_points,n_points,1);
     solution_exact.resize(n_points,n_points);
+    timer.add_info("n_points", n_points);
+    timer.add_info("lam_x", lam_x);
+    timer.add_info("running_time", running_time);
 }
 
 void Linear_Convection_2d::make_grid()
@@ -163,308 +179,90 @@ void Linear_Convection_2d::set_initial_solution()
       }
 }
 
-void Linear_Convection_2d::upwind()
+void Linear_Convection_2d::set_upwind_weights()
 {
-  //(i,j)=(0,0)
-  double x = x_min + 0.0*dx, y = y_min + 0.0*dy;
-  coefficient_x = -y, coefficient_y = x;
-  sigma_x = coefficient_x*dt/(dx),sigma_y = coefficient_y*dt/(dx);
-  lam_x = abs(coefficient_x)*dt/(dx),lam_y = abs(coefficient_y)*dt/(dx);
-  solution(0,0) = (1.0-lam_x-lam_y)*solution_old(0,0)
-                    +max(coefficient_x,0.)*(dt/dx)*solution_old(n_points-1,0)
-                    +max(coefficient_y,0.)*(dt/dy)*solution_old(0,n_points-1)
-                    -min(coefficient_x,0.)*(dt/dx)*solution_old(1,0)
-                    -min(coefficient_y,0.)*(dt/dy)*solution_old(0,1);
-  //i=0
-  for (unsigned int j = 1; j<n_points-1;j++) 
-    {
-      x = x_min + 0.0*dx, y = y_min + j*dy;
-      coefficient_x = -y, coefficient_y = x;
-      sigma_x = coefficient_x*dt/(dx),sigma_y = coefficient_y*dt/(dx);
-      lam_x = abs(coefficient_x)*dt/(dx),lam_y = abs(coefficient_y)*dt/(dx);
-      solution(0,j) = (1.0-lam_x-lam_y)*solution_old(0,j)
-                      +max(coefficient_x,0.)*(dt/dx)*solution_old(n_points-1,j)
-                      +max(coefficient_y,0.)*(dt/dy)*solution_old(0,j-1)
-                      -min(coefficient_x,0.)*(dt/dx)*solution_old(1,j)
-                      -min(coefficient_y,0.)*(dt/dy)*solution_old(0,j+1);
-    }
-    //i = 0; j =n_points-1
-  x = x_min + 0.0*dx, y = y_min + (n_points-1.0)*dy;
-  coefficient_x = -y, coefficient_y = x;
-  sigma_x = coefficient_x*dt/(dx),sigma_y = coefficient_y*dt/(dx);
-  lam_x = abs(coefficient_x)*dt/(dx),lam_y = abs(coefficient_y)*dt/(dx);
-  solution(0,n_points-1) = (1.0-lam_x-lam_y)*solution_old(0,n_points-1)
-                          +max(coefficient_x,0.)*(dt/dx)*solution_old(n_points-1,n_points-1)
-                          +max(coefficient_y,0.)*(dt/dy)*solution_old(0,n_points-2)
-                          -min(coefficient_x,0.)*(dt/dx)*solution_old(1,n_points-1)
-                          -min(coefficient_y,0.)*(dt/dy)*solution_old(0,0);
-  //j=0
-  for (unsigned int i = 1; i<n_points-1 ;i++) 
+  center_row.resize(n_points), left_row.resize(n_points);
+  right_row.resize(n_points);
+  lam_y_column.resize(n_points), down_column.resize(n_points);
+  up_column.resize(n_points);
+  for (int j = 0; j < n_points; j++)
   {
-    x = x_min + i*dx, y = y_min + 0.0*dy;
-    coefficient_x = -y, coefficient_y = x;
-    sigma_x = coefficient_x*dt/(dx),sigma_y = coefficient_y*dt/(dx);
-    lam_x = abs(coefficient_x)*dt/(dx),lam_y = abs(coefficient_y)*dt/(dx);
-    solution(i,0) = (1.0-lam_x-lam_y)*solution_old(i,0)
-                        +max(coefficient_x,0.)*(dt/dx)*solution_old(i-1,0)
-                        +max(coefficient_y,0.)*(dt/dy)*solution_old(i,n_points-1)
-                        -min(coefficient_x,0.)*(dt/dx)*solution_old(i+1,0)
-                        -min(coefficient_y,0.)*(dt/dy)*solution_old(i,1);;
+    const double y = y_min + j*dy;
+    const double coefficient_x = -y;
+    const double lam_x = abs(coefficient_x)*dt/(dx);
+    center_row[j] = 1.0-lam_x;
+    left_row[j]   = max(coefficient_x,0.)*(dt/dx);
+    right_row[j]  = -min(coefficient_x,0.)*(dt/dx);
   }
-  //j=0, i = n_points-1
-  x = x_min + (n_points-1)*dx, y = y_min + 0.0*dy;
-  coefficient_x = -y, coefficient_y = x;
-  sigma_x = coefficient_x*dt/(dx),sigma_y = coefficient_y*dt/(dx);
-  lam_x = abs(coefficient_x)*dt/(dx),lam_y = abs(coefficient_y)*dt/(dx);
-  solution(n_points-1,0) = (1.0-lam_x-lam_y)*solution_old(n_points-1,0)
-                  +max(coefficient_x,0.)*(dt/dx)*solution_old(n_points-2,0)
-                  +max(coefficient_y,0.)*(dt/dy)*solution_old(n_points-1,n_points-1)
-                  -min(coefficient_x,0.)*(dt/dx)*solution_old(0,0)
-                  -min(coefficient_y,0.)*(dt/dy)*solution_old(n_points-1,1);
-  //i = n_points-1
-  for (unsigned int j = 1;j<n_points-1;j++)
+  for (int i = 0; i < n_points; i++)
   {
-    x = x_min + (n_points-1)*dx, y = y_min + j*dy;
-    coefficient_x = -y, coefficient_y = x;
-    sigma_x = coefficient_x*dt/(dx),sigma_y = coefficient_y*dt/(dx);
-    lam_x = abs(coefficient_x)*dt/(dx),lam_y = abs(coefficient_y)*dt/(dx);
-    solution(n_points-1,j) = (1.0-lam_x-lam_y)*solution_old(n_points-1,j)
-                          +max(coefficient_x,0.)*(dt/dx)*solution_old(n_points-2,j)
-                          +max(coefficient_y,0.)*(dt/dy)*solution_old(n_points-1,j-1)
-                          -min(coefficient_x,0.)*(dt/dx)*solution_old(0,j)
-                          -min(coefficient_y,0.)*(dt/dy)*solution_old(n_points-1,j+1);
+    const double x = x_min + i*dx;
+    const double coefficient_y = x;
+    lam_y_column[i] = abs(coefficient_y)*dt/(dx);
+    down_column[i]  = max(coefficient_y,0.)*(dt/dy);
+    up_column[i]    = -min(coefficient_y,0.)*(dt/dy);
   }
-  //j = n_points - 1
-  for (unsigned int i = 1; i<n_points-1; i++)
+}
+
+void Linear_Convection_2d::upwind()
+{
+  const double *center = &center_row[0], *left = &left_row[0];
+  const double *right = &right_row[0], *lam_y = &lam_y_column[0];
+  const double *down = &down_column[0], *up = &up_column[0];
+  timer.start("boundary");
+  solution_old.update_fluff(); //Periodic neighbours of the edge points
+  timer.stop("boundary");
+  Scoped_Timer update_timer(timer, "update");
+  apply_stencil_interior(solution_old, solution,
+                         [=](const Stencil_Point &q, int i, int j)
   {
-        x = x_min + i*dx, y = y_min + (n_points-1)*dy;
-        coefficient_x = -y, coefficient_y = x;
-        sigma_x = coefficient_x*dt/(dx),sigma_y = coefficient_y*dt/(dx);
-        lam_x = abs(coefficient_x)*dt/(dx),lam_y = abs(coefficient_y)*dt/(dx);
-        solution(i,n_points-1) = (1.0-lam_x-lam_y)*solution_old(i,n_points-1)
-                        +max(coefficient_x,0.)*(dt/dx)*solution_old(i-1,n_points-1)
-                        +max(coefficient_y,0.)*(dt/dy)*solution_old(i,n_points-2)
-                        -min(coefficient_x,0.)*(dt/dx)*solution_old(i+1,n_points-1)
-                        -min(coefficient_y,0.)*(dt/dy)*solution_old(i,0);
-  }
-  //i = n_points - 1, j = n_points - 1
-  x = x_min + (n_points-1)*dx, y = y_min + (n_points-1)*dy;
-  coefficient_x = -y, coefficient_y = x;
-  sigma_x = coefficient_x*dt/(dx),sigma_y = coefficient_y*dt/(dx);
-  lam_x = abs(coefficient_x)*dt/(dx),lam_y = abs(coefficient_y)*dt/(dx);
-  solution(n_points-1,n_points-1) = (1.0-lam_x-lam_y)*solution_old(n_points-1,n_points-1)
-                +max(coefficient_x,0.)*(dt/dx)*solution_old(n_points-2,n_points-1)
-                +max(coefficient_y,0.)*(dt/dy)*solution_old(n_points-1,n_points-2)
-                -min(coefficient_x,0.)*(dt/dx)*solution_old(0,n_points-1)
-                -min(coefficient_y,0.)*(dt/dy)*solution_old(n_points-1,0);
-  //i != 0,n_points-1, j != 0,n_points-1
-  for (unsigned int i = 1; i < n_points-1; i++)
-      for (unsigned int j = 1; j < n_points-1; j++)
-      {
-        x = x_min + i*dx, y = y_min + j*dy;
-        coefficient_x = -y, coefficient_y = x;
-        sigma_x = coefficient_x*dt/(dx),sigma_y = coefficient_y*dt/(dx);
-        lam_x = abs(coefficient_x)*dt/(dx),lam_y = abs(coefficient_y)*dt/(dx);
-        solution(i,j) = (1.0-lam_x-lam_y)*solution_old(i,j)
-                        +max(coefficient_x,0.)*(dt/dx)*solution_old(i-1,j)
-                        +max(coefficient_y,0.)*(dt/dy)*solution_old(i,j-1)
-                        -min(coefficient_x,0.)*(dt/dx)*solution_old(i+1,j)
-                        -min(coefficient_y,0.)*(dt/dy)*solution_old(i,j+1);
-      }
+    return (center[j]-lam_y[i])*q(0,0)
+           +left[j]*q(-1,0)
+           +down[i]*q(0,-1)
+           +right[j]*q(1,0)
+           +up[i]*q(0,1);
+  });
 }
 
 void Linear_Convection_2d::ct_upwind()
 {
-  //(i,j)=(0,0)
-  solution(0,0) = (1.0-sigma_x)*(1.0-sigma_y)*solution_old(0,0)
-                +sigma_x*(1-sigma_y)*solution_old(n_points-1,0)
-                +(1-sigma_x)*sigma_y*solution_old(0,n_points-1)
-                +sigma_x*sigma_y*solution_old(n_points-1,n_points-1);
-  //i=0
-  for (unsigned int j = 1; j<n_points;j++) 
-    {
-    solution(0,j) = (1.0-sigma_x)*(1.0-sigma_y)*solution_old(0,j)
-                    +sigma_x*(1-sigma_y)*solution_old(n_points-1,j)
-                    +(1-sigma_x)*sigma_y*solution_old(0,j-1)
-                    +sigma_x*sigma_y*solution_old(n_points-1,j-1);
-    }
-  //Extremely stupid mistake - I thought that the above cover all
-  //the extra cases, when it clearly doesn't.
-  //j=0
-  for (unsigned int i = 1; i<n_points ;i++) 
+  const double sigma_x = this->sigma_x, sigma_y = this->sigma_y;
+  timer.start("boundary");
+  solution_old.update_fluff();
+  timer.stop("boundary");
+  Scoped_Timer update_timer(timer, "update");
+  apply_stencil_interior(solution_old, solution,
+                         [=](const Stencil_Point &q, int, int)
   {
-  solution(i,0) = (1.0-sigma_x)*(1.0-sigma_y)*solution_old(i,0)
-                  +sigma_x*(1-sigma_y)*solution_old(i-1,0)
-                  +(1-sigma_x)*sigma_y*solution_old(i,n_points-1)
-                  +sigma_x*sigma_y*solution_old(i-1,n_points-1);
-  }
-  for (unsigned int i = 1; i < n_points; i++)
-      for (unsigned int j = 1; j < n_points; j++)
-      {
-        solution(i,j) = (1.0-sigma_x)*(1.0-sigma_y)*solution_old(i,j)
-                        +sigma_x*(1-sigma_y)*solution_old(i-1,j)
-                        +(1-sigma_x)*sigma_y*solution_old(i,j-1)
-                        +sigma_x*sigma_y*solution_old(i-1,j-1);
-      }
+    return (1.0-sigma_x)*(1.0-sigma_y)*q(0,0)
+           +sigma_x*(1-sigma_y)*q(-1,0)
+           +(1-sigma_x)*sigma_y*q(0,-1)
+           +sigma_x*sigma_y*q(-1,-1);
+  });
 }
 
 void Linear_Convection_2d::lw()
 {
-  //(i,j)=(0,0)
-  solution(0,0) = solution_old(0,0)
-                      -0.5*sigma_x*(solution_old(1,0)-solution_old(n_points-1,0))
-                      -0.5*sigma_y*(solution_old(0,1)-solution_old(0,n_points-1))
-                      +0.5*sigma_x*sigma_x*(solution_old(1,0)
-                                            -2.0*solution_old(0,0)
-                                            +solution_old(n_points-1,0))
-                      +0.25*sigma_x*sigma_y*(solution_old(1,1)
-                                            -solution_old(1,n_points-1)
-                                            -solution_old(n_points-1,1)
-                                            +solution_old(n_points-1,n_points-1))
-                      +0.5*sigma_y*sigma_y*(solution_old(0,1)
-                                            -2.0*solution_old(0,0)
-                                            +solution_old(0,n_points-1));
-  //i=0
-  for (unsigned int j = 1; j<n_points-1;j++) 
-    {
-      solution(0,j) = solution_old(0,j)
-                      -0.5*sigma_x*(solution_old(1,j)-solution_old(n_points-1,j))
-                      -0.5*sigma_y*(solution_old(0,j+1)-solution_old(0,j-1))
-                      +0.5*sigma_x*sigma_x*(solution_old(1,j)
-                                            -2.0*solution_old(0,j)
-                                            +solution_old(n_points-1,j))
-                      +0.25*sigma_x*sigma_y*(solution_old(1,j+1)
-                                            -solution_old(1,j-1)
-                                            -solution_old(n_points-1,j+1)
-                                            +solution_old(n_points-1,j-1))
-                      +0.5*sigma_y*sigma_y*(solution_old(0,j+1)
-                                            -2.0*solution_old(0,j)
-                                            +solution_old(0,j-1));
-    }
-  //Extremely stupid mistake - I thought that the above cover all
-  //the extra cases, when it clearly doesn't.
-  //j=0
-  for (unsigned int i = 1; i<n_points-1;i++) 
-  {
-    solution(i,0) = solution_old(i,0)
-                -0.5*sigma_x*(solution_old(i+1,0)-solution_old(i-1,0))
-                -0.5*sigma_y*(solution_old(i,1)-solution_old(i,n_points-1))
-                +0.5*sigma_x*sigma_x*(solution_old(i+1,0)
-                                      -2.0*solution_old(i,0)
-                                      +solution_old(i-1,0))
-                +0.25*sigma_x*sigma_y*(solution_old(i+1,1)
-                                      -solution_old(i+1,n_points-1)
-                                      -solution_old(i-1,1)
-                                      +solution_old(i-1,n_points-1))
-                +0.5*sigma_y*sigma_y*(solution_old(i,1)
-                                      -2.0*solution_old(i,0)
-                                      +solution_old(i,n_points-1));
-  }
-  //i=n_points-1,j=0
-  solution(n_points-1,0) = solution_old(n_points-1,0)
-                      -0.5*sigma_x*(solution_old(0,0)
-                                    -solution_old(n_points-2,0))
-                      -0.5*sigma_y*(solution_old(n_points-1,1)
-                                    - solution_old(n_points-1,n_points-1))
-                      +0.5*sigma_x*sigma_x*(solution_old(0,0)
-                                            -2.0*solution_old(n_points-1,0)
-                                            +solution_old(n_points-2,0))
-                      +0.25*sigma_x*sigma_y*(solution_old(0,1)
-                                            -solution_old(0,n_points-1)
-                                            -solution_old(n_points-2,1)
-                                            +solution_old(n_points-2,n_points-1))
-                      +0.5*sigma_y*sigma_y*(solution_old(n_points-1,1)
-                                            -2.0*solution_old(n_points-1,0)
-                                            +solution_old(n_points-1,n_points-1));
-  //i=0,j=n_points-1
-  solution(0,n_points -1) = solution_old(0,n_points -1 )
-                    -0.5*sigma_x*(solution_old(1,n_points -1 )
-                                  -solution_old(n_points-1,n_points -1 ))
-                    -0.5*sigma_y*(solution_old(0,0)-solution_old(0,n_points -2))
-                    +0.5*sigma_x*sigma_x*(solution_old(1,n_points -1 )
-                                          -2.0*solution_old(0,n_points -1 )
-                                          +solution_old(n_points-1,n_points -1 ))
-                    +0.25*sigma_x*sigma_y*(solution_old(1,0)
-                                          -solution_old(1,n_points -2)
-                                          -solution_old(n_points-1,0)
-                                          +solution_old(n_points-1,n_points -2))
-                    +0.5*sigma_y*sigma_y*(solution_old(0,0)
-                                          -2.0*solution_old(0,n_points -1)
-                                          +solution_old(0,n_points -2)); 
-  //i=n_points-1
-  for (unsigned int j = 1; j<n_points-1; j++)
+  const double sigma_x = this->sigma_x, sigma_y = this->sigma_y;
+  timer.start("boundary");
+  solution_old.update_fluff();
+  timer.stop("boundary");
+  Scoped_Timer update_timer(timer, "update");
+  apply_stencil_interior(solution_old, solution,
+                         [=](const Stencil_Point &q, int, int)
   {
-    solution(n_points-1,j) = solution_old(n_points-1,j)
-                        -0.5*sigma_x*(solution_old(0,j)
-                                      -solution_old(n_points-2,j))
-                        -0.5*sigma_y*(solution_old(n_points-1,j+1)
-                                      - solution_old(n_points-1,j-1))
-                        +0.5*sigma_x*sigma_x*(solution_old(0,j)
-                                              -2.0*solution_old(n_points-1,j)
-                                              +solution_old(n_points-2,j))
-                        +0.25*sigma_x*sigma_y*(solution_old(0,j+1)
-                                              -solution_old(0,j-1)
-                                              -solution_old(n_points-2,j+1)
-                                              +solution_old(n_points-2,j-1))
-                        +0.5*sigma_y*sigma_y*(solution_old(n_points-1,j+1)
-                                              -2.0*solution_old(n_points-1,j)
-                                              +solution_old(n_points-1,j-1));
-  }
-  // j = n_points -1 
-  for (unsigned int i = 1; i<n_points -1 ; i++)
-  {
-    solution(i,n_points -1) = solution_old(i,n_points -1 )
-                    -0.5*sigma_x*(solution_old(i+1,n_points -1 )
-                                  -solution_old(i-1,n_points -1 ))
-                    -0.5*sigma_y*(solution_old(i,0)-solution_old(i,n_points -2))
-                    +0.5*sigma_x*sigma_x*(solution_old(i+1,n_points -1 )
-                                          -2.0*solution_old(i,n_points -1 )
-                                          +solution_old(i-1,n_points -1 ))
-                    +0.25*sigma_x*sigma_y*(solution_old(i+1,0)
-                                          -solution_old(i+1,n_points -2)
-                                          -solution_old(i-1,0)
-                                          +solution_old(i-1,n_points -2))
-                    +0.5*sigma_y*sigma_y*(solution_old(i,0)
-                                          -2.0*solution_old(i,n_points -1)
-                                          +solution_old(i,n_points -2)); 
-  }
-  //(i,j) = (n_points-1,n_points-1)
-  solution(n_points -1,n_points -1) = solution_old(n_points -1,n_points -1 )
-                  -0.5*sigma_x*(solution_old(0,n_points -1 )
-                                -solution_old(n_points -2,n_points -1 ))
-                  -0.5*sigma_y*(solution_old(n_points -1,0)
-                                -solution_old(n_points -1,n_points -2))
-                  +0.5*sigma_x*sigma_x*(solution_old(0,n_points -1 )
-                                        -2.0*solution_old(n_points -1,n_points -1 )
-                                        +solution_old(n_points -2,n_points -1 ))
-                  +0.25*sigma_x*sigma_y*(solution_old(0,0)
-                                        -solution_old(0,n_points -2)
-                                        -solution_old(n_points -2,0)
-                                        +solution_old(n_points -2,n_points -2))
-                  +0.5*sigma_y*sigma_y*(solution_old(n_points -1,0)
-                                        -2.0*solution_old(n_points -1,n_points -1)
-                                        +solution_old(n_points -1,n_points -2)); 
-  for (unsigned int i = 1; i < n_points-1; i++)
-      for (unsigned int j = 1; j < n_points-1; j++)
-      {
-        solution(i,j) = solution_old(i,j)
-                        -0.5*sigma_x*(solution_old(i+1,j)-solution_old(i-1,j))
-                        -0.5*sigma_y*(solution_old(i,j+1)-solution_old(i,j-1))
-                        +0.5*sigma_x*sigma_x*(solution_old(i+1,j)
-                                              -2.0*solution_old(i,j)
-                                              +solution_old(i-1,j))
-                        +0.25*sigma_x*sigma_y*(solution_old(i+1,j+1)
-                                              -solution_old(i+1,j-1)
-                                              -solution_old(i-1,j+1)
-                                              +solution_old(i-1,j-1))
-                        +0.5*sigma_y*sigma_y*(solution_old(i,j+1)
-                                              -2.0*solution_old(i,j)
-                                              +solution_old(i,j-1));
-      }
+    return q(0,0)
+           -0.5*sigma_x*(q(1,0)-q(-1,0))
+           -0.5*sigma_y*(q(0,1)-q(0,-1))
+           +0.5*sigma_x*sigma_x*(q(1,0)-2.0*q(0,0)+q(-1,0))
+           +0.25*sigma_x*sigma_y*(q(1,1)-q(1,-1)-q(-1,1)+q(-1,-1))
+           +0.5*sigma_y*sigma_y*(q(0,1)-2.0*q(0,0)+q(0,-1));
+  });
 }
 
 void Linear_Convection_2d::evaluate_error_and_output_solution(int time_step_number)
 {
+    timer.start("error");
     for (unsigned int i = 0; i < n_points; i++)
       for (unsigned int j = 0; j < n_points; j++)
       {
@@ -498,6 +296,13 @@ void Linear_Convection_2d::evaluate_error_and_output_solution(int time_step_numb
               assert(false);
           }
       }
+    //The exact solution is written at every step, so the error is reduced
+    //from it, without storing an error array
+    errors.reset();
+    for (unsigned int j = 0; j < n_points; j++)
+      errors.add(n_points,&solution(0,j),&solution_exact(0,j));
+    timer.stop("error");
+    Scoped_Timer output_timer(timer, "output");
     vtk_anim_sol(grid_x,grid_y,
           solution,
           t, time_step_number,
@@ -506,25 +311,24 @@ void Linear_Convection_2d::evaluate_error_and_output_solution(int time_step_numb
           solution_exact,
           t, time_step_number,
           "exact_solution");
-    for (unsigned int i = 0; i < n_points; i++)
-      for (unsigned int j = 0; j < n_points; j++)
-      {
-          error(i,j) = abs(solution(i,j) - solution_exact(i,j));
-          /*cout << "Error at x = "<< x_min + i*dx;
-          cout << ", y = "<< y_min + j*dy<< " = "<< error(i,j) << endl;*/
-      }
 }
 
 void Linear_Convection_2d::run()
 {
+    //Everything not in one of the phases, like setting up the grid
+    Scoped_Timer run_timer(timer, "other");
     make_grid();
+    if (method == "upwind")
+      set_upwind_weights();
     set_initial_solution(); //sets solution to be the initial data
     int time_step_number = 0; 
     evaluate_error_and_output_solution(time_step_number);
     while (t < running_time) //compute solution at next time step using solution_old
     {
         
+        timer.start("update");
         solution_old = solution;//update solution_old to be used at next time step
+        timer.stop("update");
         if (method == "upwind")
             upwind();
         else if (method == "lw")
@@ -533,14 +337,17 @@ void Linear_Convection_2d::run()
             ct_upwind();
         else
             assert(false);
+        timer.start("output");
         vtk_anim_sol(grid_x,grid_y,
                      solution,
                      t, time_step_number,
                      "approximate_solution");
+        timer.stop("output");
         //Compute snapshot error for integert/coefficient_x, t/coefficient_y
         //You must run the solver for longer time, or you'd get very less error.
         if ((t>0.0)&&(int_tester(t/(2*M_PI))==true))
         {
+          Scoped_Timer error_timer(timer, "error");
           //cout << "We are evaluating snapshot error at t = "<< t<<endl;
           for (unsigned int i = 0; i < n_points; i++)
             for (unsigned int j = 0; j < n_points; j++)
@@ -552,6 +359,8 @@ void Linear_Convection_2d::run()
             }
         }
         time_step_number += 1;
+        timer.count("time_steps");
+        timer.count("point_updates", n_points*n_points);
         t = t + dt; 
         evaluate_error_and_output_solution(time_step_number);
 
@@ -571,20 +380,18 @@ void run_and_get_output(double n_points, double cfl,
     vector<double> l2_vector;
     vector<double> l1_vector;
     vector<double> snapshot_vector;
+    vector<Timer> timers; //Phases of each refinement level
 
     for (unsigned int refinement_level = 0; refinement_level <= max_refinements;
         refinement_level++)
     {
         Linear_Convection_2d solver(n_points, cfl, method, running_time,
                                     initial_data_indicator);
-        struct timeval begin, end;
-        gettimeofday(&begin, 0);
         solver.run();
-        gettimeofday(&end, 0);
-        long seconds = end.tv_sec - begin.tv_sec;
-        long microseconds = end.tv_usec - begin.tv_usec;
-        double elapsed = seconds + microseconds * 1e-6;
+        double elapsed = solver.get_timer().total_seconds();
         cout << "Time taken by this iteration is " << elapsed << " seconds." << endl;
+        solver.get_timer().print();
+        timers.push_back(solver.get_timer());
         solver.get_error(l1_vector,l2_vector,linfty_vector,snapshot_vector);//push_back resp. error.
         cout << "Snapshot error is "<< snapshot_vector[refinement_level] << endl;
         error_vs_h << 2.0/n_points << " " << linfty_vector[refinement_level] << "\n";
@@ -617,6 +424,8 @@ void run_and_get_output(double n_points, double cfl,
         }
         error_vs_h.close();
     }
+    write_json(timers, "timing.json");
+    cout << "Phase timings written to timing.json" << endl;
     if (snapshot_vector[linfty_vector.size()-1]-(-1.0) < 1e-12)
     {
       cout<<"WARNING -Initial state never reached, so snapshot error not calculated.";
@@ -649,7 +458,7 @@ double Linear_Convection_2d::hat_function(double grid_point)
         value = 0.0;
     else if (grid_point <= 0.0)
         value = grid_point + 0.5;
-    else if (grid_point >= 0.0)
+    else
         value = 0.5 - grid_point;
     return value;
 }
@@ -683,17 +492,12 @@ void Linear_Convection_2d::get_error(vector<double> &l1_vector,
                                      vector<double> &linfty_vector,
                                      vector<double> &snapshot_vector)
 {
-    double l1 = 0.0;
-    double l2 = 0.0;
-    double linfty = 0.0;
-    for (int j = 0; j < n_points; j++) 
-      for (int i = 0; i<n_points; i++)
-      {
-          l1 = l1 + error(i,j)  * dx * dy;           // L1 error
-          l2 = l2 + error(i,j) * error(i,j)  * dx * dy;// L2 error
-          linfty = max(linfty, error(i,j));            // L_infty error
-      }
-    l2 = sqrt(l2);
+    //Error_Norms are means over the cells, here the errors are integrals
+    const Error_Norms norms = errors.norms();
+    const double area = n_points*n_points*dx*dy;
+    double l1 = norms.l1 * area;            // L1 error
+    double l2 = norms.l2 * sqrt(area);      // L2 error
+    double linfty = norms.linfty;           // L_infty error
     l1_vector.push_back(l1);
     l2_vector.push_back(l2);
     linfty_vector.push_back(linfty);
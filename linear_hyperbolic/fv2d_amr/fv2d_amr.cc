@@ -0,0 +1,422 @@
+//Solving Q_t + uQ_x + vQ_y = 0 with the upwind and Lax-Wendroff schemes of
+//fv2d_dirichlet, on a block-structured adaptive grid (include/amr2d.h)
+
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cassert>
+#include <string>
+#include <cstring>
+#include <stdio.h>
+
+#include "../../include/array2d.h"
+#include "../../include/amr2d.h"
+#include "../../include/timer.h"
+using namespace std;
+
+void (*update_flux)(double nx, double ny,double vel[2],double Q_l,double Q_r,
+                    double &flux);
+
+void upwind(double nx, double ny, double vel[2], double Q_l, double Q_r,
+            double& flux)
+{
+  const double v_n = vel[0]*nx + vel[1]*ny;//normal velocity
+  flux = max(v_n,0.0)*Q_l+ min(v_n,0.)*Q_r;
+}
+
+//Lax-Wendroff flux of fv2d_dirichlet at the face between the cells (i,j) and
+//(i+nx,j+ny) of Q, with lam_x = dt/dx, lam_y = dt/dy of the level of Q
+void lw(const Array2D &Q, int i, int j, int nx, int ny, double vel[2],
+        double lam_x, double lam_y, double &flux)
+{
+  const double vn = vel[0]*nx + vel[1]*ny;//normal velocity
+  const double vt = vel[0]*ny + vel[1]*nx;//Tangential velocity
+  double hn = nx*lam_x+ny*lam_y;
+  double ht = nx*lam_y+ny*lam_x;
+  flux  =  0.5*vn*(Q(i,j) + Q(i+nx,j+ny));
+  flux += -0.5*vn*vn*hn*(Q(i+nx,j+ny)- Q(i,j));
+  flux += -0.125*vn*vt*ht*(Q(i+ny,j+nx)-Q(i-ny,j-nx)
+                           +Q(i+1,j+1)-Q(i+nx-ny,j-nx+ny));
+}
+
+//Computes advection_velocity in x direction at (x,y)
+void rotational_velocity(double x, double y, double vel[2])
+{
+  vel[0] = -y, vel[1] = x;
+}
+
+void constant_velocity(double x, double y, double vel[2])
+{
+  (void)x,(void)y;
+  vel[0] = 1.0, vel[1] = 1.0;
+}
+
+void (*advection_velocity)(double, double, double vel[2]) = &rotational_velocity;
+
+double exact_soln(double x, double y,double t)
+{
+  double x0 = x*cos(t)+y*sin(t),y0 = -x*sin(t)+y*cos(t);
+  return 1.0 + exp(-100.0*((x0-0.5)*(x0-0.5)+ y0*y0  ));
+}
+
+double initial_soln(double x, double y)
+{
+  return exact_soln(x,y,0.);
+}
+
+class Linear_Convection_2d
+{
+public:
+    Linear_Convection_2d(int n_blocks, int block_size, int max_level,
+                         double cfl, string method, double final_time,
+                         double refine_tol);
+
+    void run(bool output_indicator);
+    void get_error(vector<double> &l1_vector, vector<double> &l2_vector,
+                   vector<double> &linfty_vector);
+    const Timer& get_timer() const { return timer; }
+    double mean_cells() const { return mean_n_cells; }
+private:
+    void compute_time_step();
+    //Fluxes of all faces of the leaves, which are updated with them
+    void apply_fvm();
+
+    AMR_Grid2D grid;
+    int bs;
+    vector<double> flux_x, flux_y; //Faces of one block
+
+    double face_speed_x, face_speed_y; //Max |u|, |v| on the faces
+
+    double dt, t, final_time;
+    double cfl;
+    string method;
+    double refine_tol;
+    int regrid_interval; //Time steps between two regrids
+    double mean_n_cells; //Number of cells of the leaves, mean over the steps
+
+    Timer timer; // Time of residual, boundary, update, regrid, output phases
+};
+
+Linear_Convection_2d::Linear_Convection_2d(int n_blocks, int block_size,
+                                           int max_level, double cfl,
+                                           string method, double final_time,
+                                           double refine_tol):
+                                           grid(0.0, 1.0, 0.0, 1.0,
+                                                n_blocks, n_blocks,
+                                                block_size, max_level, 1,
+                                                &exact_soln),
+                                           bs(block_size),
+                                           final_time(final_time),
+                                           cfl(cfl),
+                                           method(method),
+                                           refine_tol(refine_tol),
+                                           timer("fv2d_amr " + method)
+{
+    t = 0.0;
+    flux_x.resize((bs+1)*bs), flux_y.resize(bs*(bs+1));
+    //A block is crossed in bs/cfl steps at the finest level
+    regrid_interval = max(1,bs/4);
+    mean_n_cells = 0.0;
+    timer.add_info("n_blocks", n_blocks);
+    timer.add_info("block_size", bs);
+    timer.add_info("max_level", max_level);
+    timer.add_info("cfl", cfl);
+    timer.add_info("final_time", final_time);
+    timer.add_info("refine_tol", refine_tol);
+}
+
+//dt of the finest level, with the face speeds of the last step and the
+//conditions of admissible_dt in fv2d_dirichlet
+void Linear_Convection_2d::compute_time_step()
+{
+  const int l = grid.finest_level();
+  const double rate_x = face_speed_x/grid.dx(l), rate_y = face_speed_y/grid.dy(l);
+  double rate;
+  if (method == "lw")
+    rate = pow(cbrt(rate_x*rate_x) + cbrt(rate_y*rate_y), 1.5);
+  else
+    rate = rate_x + rate_y;
+  dt = (rate > 0.0) ? cfl/rate : final_time;
+  if (t+dt > final_time)
+    dt = final_time-t;
+}
+
+void Linear_Convection_2d::apply_fvm()
+{
+  const vector<int> &leaves = grid.leaves();
+  const bool use_lw = (method == "lw");
+  face_speed_x = face_speed_y = 0.0;
+  double vel[2];
+  timer.start("residual");
+  for (unsigned int n = 0; n < leaves.size(); n++)
+  {
+    AMR_Block &block = grid.blocks[leaves[n]];
+    Array2D &Q = block.u;
+    const int l = block.level;
+    const double dx = grid.dx(l), dy = grid.dy(l);
+    //Lower left corner of the block
+    const double x0 = grid.x(l,block.bi*bs) - 0.5*dx;
+    const double y0 = grid.y(l,block.bj*bs) - 0.5*dy;
+    const double lam_x = dt/dx, lam_y = dt/dy;
+    //flux_x(i-1/2,j) at flux_x[i+j*(bs+1)], i = 0,...,bs
+    for (int j = 0; j < bs; j++)
+      for (int i = 0; i <= bs; i++)
+      {
+        const double x = x0 + i*dx, y = y0 + (j+0.5)*dy;
+        (*advection_velocity)(x,y,vel);
+        face_speed_x = max(face_speed_x,abs(vel[0]));
+        double &flux = flux_x[i+j*(bs+1)];
+        if (use_lw)
+          lw(Q,i-1,j,1,0,vel,lam_x,lam_y,flux);
+        else
+          (*update_flux)(1,0,vel,Q(i-1,j),Q(i,j),flux);
+      }
+    //flux_y(i,j-1/2) at flux_y[i+j*bs], j = 0,...,bs
+    for (int j = 0; j <= bs; j++)
+      for (int i = 0; i < bs; i++)
+      {
+        const double x = x0 + (i+0.5)*dx, y = y0 + j*dy;
+        (*advection_velocity)(x,y,vel);
+        face_speed_y = max(face_speed_y,abs(vel[1]));
+        double &flux = flux_y[i+j*bs];
+        if (use_lw)
+          lw(Q,i,j-1,0,1,vel,lam_x,lam_y,flux);
+        else
+          (*update_flux)(0,1,vel,Q(i,j-1),Q(i,j),flux);
+      }
+    //The update of the block is in the residual phase, it is small and
+    //timing each block costs more
+    for (int k = 0; k < bs; k++)
+    {
+      block.face_flux[amr_west][k]  = flux_x[0+k*(bs+1)];
+      block.face_flux[amr_east][k]  = flux_x[bs+k*(bs+1)];
+      block.face_flux[amr_south][k] = flux_y[k];
+      block.face_flux[amr_north][k] = flux_y[k+bs*bs];
+    }
+    for (int j = 0; j < bs; j++)
+      for (int i = 0; i < bs; i++)
+        Q(i,j) += -lam_x*(flux_x[i+1+j*(bs+1)] - flux_x[i+j*(bs+1)])
+                  -lam_y*(flux_y[i+(j+1)*bs] - flux_y[i+j*bs]);
+  }
+  timer.stop("residual");
+  //Flux through the coarse-fine faces is the one of the fine faces
+  timer.start("update");
+  grid.reflux(dt);
+  timer.stop("update");
+}
+
+void Linear_Convection_2d::run(bool output_indicator)
+{
+  // Everything not in one of the phases
+  Scoped_Timer run_timer(timer, "other");
+  timer.start("regrid");
+  grid.set_values(&initial_soln, refine_tol);
+  timer.stop("regrid");
+  //Face speeds of the first step, at the corners of the domain
+  face_speed_x = face_speed_y = 0.0;
+  for (int c = 0; c < 4; c++)
+  {
+    double vel[2];
+    (*advection_velocity)(c%2, c/2, vel);
+    face_speed_x = max(face_speed_x,abs(vel[0]));
+    face_speed_y = max(face_speed_y,abs(vel[1]));
+  }
+  int time_step_number = 0;
+  if (output_indicator)
+  {
+    Scoped_Timer output_timer(timer, "output");
+    grid.write_vtk(t, 0, "approximate_solution");
+  }
+  while (t < final_time)
+  {
+    timer.start("boundary");
+    grid.fill_ghosts(t);
+    timer.stop("boundary");
+    if (time_step_number > 0 && time_step_number%regrid_interval == 0)
+    {
+      timer.start("regrid");
+      grid.compute_indicators();
+      const bool changed = grid.regrid(refine_tol);
+      timer.stop("regrid");
+      if (changed)
+      {
+        timer.start("boundary");
+        grid.fill_ghosts(t);
+        timer.stop("boundary");
+        timer.count("regrids");
+      }
+    }
+    compute_time_step();
+    apply_fvm();
+    time_step_number += 1;
+    timer.count("time_steps");
+    timer.count("cell_updates", grid.n_cells());
+    mean_n_cells += grid.n_cells();
+    t = t + dt;
+    if (output_indicator && time_step_number%15 == 0)
+    {
+      Scoped_Timer output_timer(timer, "output");
+      grid.write_vtk(t, time_step_number/15, "approximate_solution");
+    }
+  }
+  mean_n_cells /= max(time_step_number,1);
+  cout << "With " << grid.max_level() << " levels, we took ";
+  cout << time_step_number << " steps with " << mean_n_cells;
+  cout << " cells on average, " << grid.n_cells() << " at the end." << endl;
+  timer.add_info("mean_cells", mean_n_cells);
+}
+
+//Norms of solution - exact solution at final_time over the leaves, normalized
+//by the area like in fv2d_dirichlet
+void Linear_Convection_2d::get_error(vector<double> &l1_vector,
+                                     vector<double> &l2_vector,
+                                     vector<double> &linfty_vector)
+{
+  double l1 = 0.0, l2 = 0.0, linfty = 0.0;
+  const vector<int> &leaves = grid.leaves();
+  for (unsigned int n = 0; n < leaves.size(); n++)
+  {
+    const AMR_Block &block = grid.blocks[leaves[n]];
+    const int l = block.level;
+    const double area = grid.dx(l)*grid.dy(l);
+    for (int j = 0; j < bs; j++)
+      for (int i = 0; i < bs; i++)
+      {
+        const double x = grid.x(l,block.bi*bs+i), y = grid.y(l,block.bj*bs+j);
+        const double e = abs(block.u(i,j) - exact_soln(x,y,t));
+        l1 += e*area, l2 += e*e*area, linfty = max(linfty,e);
+      }
+  }
+  l1_vector.push_back(l1);
+  l2_vector.push_back(sqrt(l2));
+  linfty_vector.push_back(linfty);
+}
+
+void run_and_output(int n_blocks, int block_size, double cfl,
+                    string method, double final_time,
+                    unsigned int n_levels, double refine_tol)
+{
+  ofstream error_vs_h;
+  error_vs_h.open("error_vs_h.txt");
+  vector<double> linfty_vector;
+  vector<double> l2_vector;
+  vector<double> l1_vector;
+  vector<Timer> timers; // Phases of each refinement level
+
+  for (unsigned int max_level = 0; max_level <= n_levels; max_level++)
+  {
+    Linear_Convection_2d solver(n_blocks, block_size, max_level, cfl, method,
+                                final_time, refine_tol);
+    solver.run(max_level==n_levels);//Output only last soln
+    double elapsed = solver.get_timer().total_seconds();
+    cout << "Time taken by this refinement level is " << elapsed << " seconds." << endl;
+    solver.get_timer().print();
+    timers.push_back(solver.get_timer());
+    solver.get_error(l1_vector,l2_vector,linfty_vector);//push_back resp. error.
+    //Finest dx, and the cells of the uniform grid with it
+    const double N = double(n_blocks*block_size) * (1 << max_level);
+    cout << "The uniform grid with the finest dx has " << N*N << " cells, ";
+    cout << N*N/solver.mean_cells() << " times more." << endl;
+    double h = 2.*sqrt(2.)/N;
+    error_vs_h << h << " " << linfty_vector[max_level] << "\n";
+    if (max_level > 0) //Computing convergence rate.
+    {
+      cout << "L2 convergence rate at refinement level ";
+      cout << max_level<< " is " ;
+      cout << abs(log(l2_vector[max_level]
+                        / l2_vector[max_level - 1])) / log(2.0);
+      cout << endl;
+
+      cout << "L1 convergence rate at refinement level ";
+      cout << max_level << " is " ;
+      cout << abs(log(l1_vector[max_level]
+                        / l1_vector[max_level - 1])) / log(2.0);
+      cout << endl;
+      cout << "Linfty convergence rate at refinement level ";
+      cout << max_level << " is ";
+      cout << abs(log(linfty_vector[max_level]
+                        / linfty_vector[max_level - 1])) / log(2.0);
+      cout << endl;
+    }
+  }
+  error_vs_h.close();
+  write_json(timers, "timing.json");
+  cout << "Phase timings written to timing.json" << endl;
+  cout << "After " << n_levels << " refinements, l_infty error = ";
+  cout << linfty_vector[linfty_vector.size()-1] << endl;
+  cout << "The L1 error is " << l1_vector[linfty_vector.size()-1] << endl;
+  cout << "The L2 error is " << l2_vector[linfty_vector.size()-1] << endl;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 5)
+    {
+      cout << "Incorrect format, use" << endl;
+      cout << "./fv2d_amr method cfl final_time n_levels\n";
+      cout << "Choices for method"<<endl;
+      cout << "upwind, lw"<<endl;
+      cout << "Putting 2pi in place of final_time will work.\n";
+      cout << "It runs with 0,1,...,n_levels levels of refinement. At the ";
+      cout << "end, you can add\n";
+      cout << "tol=r, refine where the undivided difference is above r ";
+      cout << "(default 0.01)\n";
+      cout << "uniform, refine everywhere, to compare with the adaptive grid\n";
+      cout << "blocks=n, the coarsest grid has n x n blocks (default 4)\n";
+      cout << "block_size=m, of m x m cells (default 8)\n";
+      cout << "constant, (u,v) = (1,1) instead of the rotation\n";
+      assert(false);
+    }
+    double refine_tol = 0.01;
+    int n_blocks = 4, block_size = 8;
+    for (int a = 5; a < argc; a++)
+    {
+      string arg = argv[a];
+      if (arg.compare(0,4,"tol=") == 0)
+        refine_tol = stod(arg.substr(4));
+      else if (arg == "uniform")
+        refine_tol = -1.0; //All indicators are above it
+      else if (arg.compare(0,7,"blocks=") == 0)
+        n_blocks = stoi(arg.substr(7));
+      else if (arg.compare(0,11,"block_size=") == 0)
+        block_size = stoi(arg.substr(11));
+      else if (arg == "constant")
+      {
+        advection_velocity = &constant_velocity;
+        cout <<"Scheme will be run with constant (u,v)=(1,1)"<<endl;
+      }
+      else
+      {
+        cout << "Last arguments must be tol=..., uniform, blocks=..., ";
+        cout << "block_size=... or constant\n";
+        cout << "You put "<< arg <<endl;
+        assert(false);
+      }
+    }
+    string method = argv[1];
+    cout << "method = " << method << endl;
+    double cfl = stod(argv[2]);
+    cout << "cfl = " << cfl << endl;
+    double final_time;
+    if (strcmp(argv[3],"2pi")==0)
+      final_time = 2.0*M_PI;
+    else
+      final_time = stod(argv[3]);
+    cout << "final_time = " << final_time << endl;
+    unsigned int n_levels = stoi(argv[4]);
+    cout << "n_levels = " << n_levels << endl;
+    cout << "coarsest grid = " << n_blocks << " x " << n_blocks
+         << " blocks of " << block_size << " x " << block_size << endl;
+    cout << "refine_tol = " << refine_tol << endl;
+    //Sets the numerical flux
+    if (method=="upwind")
+      update_flux=&upwind;
+    else if(method != "lw")
+    {
+      cout <<"You incorrectly put method = "<<method<<endl;
+      assert(false);
+    }
+    run_and_output(n_blocks, block_size, cfl, method, final_time, n_levels,
+                   refine_tol);
+}
@@ -8,11 +8,14 @@
 #include <string>
 #include <cstring>
 #include <stdio.h>
-#include <sys/time.h>
 
 #include "../../include/initial_conditions.h"
 #include "../../include/array2d.h"
 #include "../../include/vtk_anim.h"
+#include "../../include/timer.h"
+#include "../../include/perf_counters.h"
+#include "../../include/error_evaluation.h"
+#include "../../include/muscl2d.h"
 using namespace std;
 
 //Returns true if real number is integer, false otherwise.
@@ -23,13 +26,6 @@ bool int_tester(double a)
   return (c<1e-4);
 }
 
-double reconstruct(double Qm1,double Q0)
-{
-  (void)Qm1;
-  return Q0;
-}
-
-
 void (*update_flux)(double nx, double ny,double vel[2],double Q_l,double Q_r,
                     double &flux);
 
@@ -60,32 +56,72 @@ double exact_soln(double x, double y,double t)
   return 1.0 + exp(-100.0*((x0-0.5)*(x0-0.5)+ y0*y0  ));
 }
 
+//exact_soln at the row (x[i],y), i < n, with cos(t), sin(t) computed once and
+//the exponential done by vector_exp, so that the loops are vectorized
+void exact_soln_row(int n, const double x[], double y, double t, double v[])
+{
+  const double c = cos(t), s = sin(t);
+  for (int i = 0; i < n; i++)
+  {
+    double x0 = x[i]*c+y*s,y0 = -x[i]*s+y*c;
+    v[i] = -100.0*((x0-0.5)*(x0-0.5)+ y0*y0  );
+  }
+  vector_exp(n,v,v);
+  for (int i = 0; i < n; i++)
+    v[i] = 1.0 + v[i];
+}
+
 class Linear_Convection_2d
 {
 public:
     Linear_Convection_2d(int N_x, int N_y,
                          double cfl,
                          string method, const double final_time,
-                         int initial_data_indicator);
+                         int initial_data_indicator,
+                         string error_spec = "final",
+                         bool adaptive_dt = false,
+                         string limiter = "none");
 
     void run(bool output_indicator);
     void get_error(vector<double> &l1_vector, vector<double> &l2_vector,
                    vector<double> &linfty_vector);
+    const Timer& get_timer() const { return timer; }
 private:
     void make_grid();
     void set_initial_solution();
 
     void compute_time_step();//This computes the time step dt.
+    //Largest stable dt for face_speed_x, face_speed_y
+    double admissible_dt() const;
+    //Sets dt of the next step from the face speeds of the last step, so that
+    //it lands on the next output time and final_time. Returns the time at
+    //the end of the step.
+    double adapt_time_step(bool output_indicator);
 
     void lw(int i, int j, int nx, int ny, double& flux);
     void lw_x(int j, double &flux);
     void lw_y(int i, double &flux);
 
+    //Residual of the finite volume scheme at the time t_stage of the
+    //boundary values, for the solution in solution
+    void compute_residual(double t_stage);
     void apply_fvm();
     void apply_lw();
 
+    //Foot (x0,y0) at t of the characteristic through (x,y) at t+dt
+    void trace_back(double x, double y, int n_substeps,
+                    double &x0, double &y0) const;
+    //Departure points of the cell centres for the present dt
+    void compute_departure_points();
+    //solution = solution_old interpolated at the departure points
+    void apply_semi_lagrangian();
+
     void evaluate_error_and_output_solution(const int time_step_number,
                                             bool output_indicator);
+    //Norms of solution - exact solution at t, on all cells or on the sample
+    //of error_policy. With exact_ready, solution_exact already holds the
+    //exact solution at t.
+    Error_Norms compute_error(bool all_cells, bool exact_ready);
     vector<double> grid_x,grid_y;
 
     double vel[2]; //advection velocity vector
@@ -97,25 +133,84 @@ private:
 
     Array2D residual;
 
-    Array2D solution_exact; //Exact solution at present time step
-
-    Array2D error;
+    //Limited slopes of MUSCL, u(x,y) = solution(i,j) + slope_x(i,j)*(x-x_i)/dx
+    //+ slope_y(i,j)*(y-y_j)/dy in cell (i,j). Zero for the first order scheme.
+    Array2D slope_x, slope_y;
+    //WENO5 values at the faces x_{i-1/2}, x_{i+1/2}, y_{j-1/2}, y_{j+1/2} of
+    //cell (i,j), see compute_weno5_faces
+    Array2D weno_x_minus, weno_x_plus, weno_y_minus, weno_y_plus;
+
+    //Semi-Lagrangian scheme. The velocity does not depend on t, so the feet
+    //of the characteristics and their interpolation weights only change with
+    //dt. The value at the foot (x,y) is the cubic interpolation
+    //sum_{a,b} wx[a]*wy[b]*solution_old(i-1+a,j-1+b), where x_i <= x < x_{i+1},
+    //y_j <= y < y_{j+1}, or exact_soln(x,y,t) if the foot is out of the domain.
+    struct Departure_Point
+    {
+      int i, j;
+      bool inside;
+      double x, y;
+      double wx[4], wy[4];
+    };
+    vector<Departure_Point> departure_points; //Of cell (i,j) at i + j*N_x
+    double departure_dt; //dt of departure_points
+
+    Array2D solution_exact; //Exact solution at present time step, only
+                            //computed when it is written
+    vector<double> exact_row; //Exact solution on one row, for the error
+
+    Error_Policy error_policy; //When the error is evaluated
+    Error_Norms final_norms;
+    vector<pair<double,Error_Norms> > error_history; //(t, norms)
 
     int N_x,N_y;
     double dx, dy, dt, t, final_time;
     double cfl;
     string method;
+    string limiter; //none gives the first order scheme
+    Slope_Limiter slope_limiter;
+    bool muscl; //Second order in space, with SSP-RK2 in time
+    bool weno; //limiter = weno5, fifth order in space with SSP-RK3 in time
+    bool semi_lagrangian; //method = sl_cubic or sl_monotone, for any cfl
+    bool monotone; //sl_monotone, clipped to the 4 values around the foot
+
+    bool adaptive_dt; //dt from the face velocities of each step, or fixed
+    //Max |u| on the x faces and |v| on the y faces, found by the residual pass
+    double face_speed_x, face_speed_y;
+    double output_interval, next_output_time; //For adaptive_dt
+    int output_number;
+    vector<pair<double,double> > dt_history; //(t, dt) of each step
+
+    Timer timer; // Time of reconstruct, residual, boundary, update, error,
+                 // output phases
+    Perf_Counters perf; // Hardware counters of apply_fvm, apply_lw
 };
 
 Linear_Convection_2d::Linear_Convection_2d(int N_x, int N_y,
                                            double cfl,
                                            string method,
                                            double final_time,
-                                           int initial_data_indicator):
+                                           int initial_data_indicator,
+                                           string error_spec,
+                                           bool adaptive_dt,
+                                           string limiter):
+                                           error_policy(error_spec),
                                            N_x(N_x), N_y(N_y),
                                            final_time(final_time),
                                            cfl(cfl),
-                                           method(method)
+                                           method(method),
+                                           limiter(limiter),
+                                           slope_limiter(&zero_slope),
+                                           muscl(limiter != "none" &&
+                                                 limiter != "weno5"),
+                                           weno(limiter == "weno5"),
+                                           semi_lagrangian(method == "sl_cubic" ||
+                                                           method == "sl_monotone"),
+                                           monotone(method == "sl_monotone"),
+                                           adaptive_dt(adaptive_dt),
+                                           timer("fv2d_dirichlet " + method +
+                                                 (limiter == "none" ? "" :
+                                                  " " + limiter))
 {
     xmin = 0.0, xmax = 1.0, ymin = 0.0, ymax = 1.0;
     dx = (xmax - xmin) / (N_x), dy = (ymax-ymin)/(N_y);
@@ -128,19 +223,67 @@ Linear_Convection_2d::Linear_Convection_2d(int N_x, int N_y,
     cout << "dy = " << dy << endl;
     cout << "cfl = " <<cfl << endl;
     compute_time_step();
-    error.resize(N_x,N_y);
+    //With adaptive_dt, the solution is written every 15 of the first steps
+    output_interval = 15.0*dt, next_output_time = 0.0, output_number = 0;
     grid_x.resize(N_x),grid_y.resize(N_y);
+    exact_row.resize(N_x);
     initial_solution.resize(N_x,N_y);
-    solution_old.resize(N_x,N_y,1);
-    solution.resize(N_x,N_y,1);
+    //The stencil of WENO5 needs 3 ghost layers, the cubic interpolation of
+    //the semi-Lagrangian scheme 2
+    int n_ghost = 1;
+    if (weno)
+      n_ghost = 3;
+    else if (semi_lagrangian)
+      n_ghost = 2;
+    solution_old.resize(N_x,N_y,n_ghost);
+    solution.resize(N_x,N_y,n_ghost);
     residual.resize(N_x,N_y,1);
+    if (weno == false)
+      slope_limiter = get_slope_limiter(limiter);
+    departure_dt = 0.0; //None computed yet
+    slope_x.resize(N_x,N_y,1), slope_y.resize(N_x,N_y,1);
+    slope_x = 0.0, slope_y = 0.0;
+    if (weno)
+    {
+      weno_x_minus.resize(N_x,N_y,1), weno_x_plus.resize(N_x,N_y,1);
+      weno_y_minus.resize(N_x,N_y,1), weno_y_plus.resize(N_x,N_y,1);
+    }
     solution_exact.resize(N_x,N_y);
+    timer.add_info("N_x", N_x);
+    timer.add_info("N_y", N_y);
+    timer.add_info("cfl", cfl);
+    timer.add_info("final_time", final_time);
+    timer.add_info("adaptive_dt", adaptive_dt);
+    timer.add_info("muscl", muscl);
+    timer.add_info("weno", weno);
+    timer.add_info("semi_lagrangian", semi_lagrangian);
 }
 
 void Linear_Convection_2d::compute_time_step()
 {
   double u0max=0.,u1max=0.;
   double vel[2];
+  if (adaptive_dt)
+  {
+    //The face speeds of the first step, later steps get them from the
+    //residual pass of apply_fvm or apply_lw
+    face_speed_x = face_speed_y = 0.0;
+    for (int i = 0; i<=N_x; i++)
+      for (int j = 0; j<N_y; j++) //x faces
+      {
+        (*advection_velocity)(xmin + i*dx, ymin + 0.5*dy + j*dy, vel);
+        face_speed_x = max(face_speed_x,abs(vel[0]));
+      }
+    for (int i = 0; i<N_x; i++)
+      for (int j = 0; j<=N_y; j++) //y faces
+      {
+        (*advection_velocity)(xmin + 0.5*dx + i*dx, ymin + j*dy, vel);
+        face_speed_y = max(face_speed_y,abs(vel[1]));
+      }
+    dt = admissible_dt();
+    cout << "dt = "<<dt <<" (adaptive)"<<endl;
+    return;
+  }
   for (int i = 0; i<N_x; i++)
     for (int j = 0; j<N_y;j++) //Loop over all cell centers.
     {
@@ -150,9 +293,11 @@ void Linear_Convection_2d::compute_time_step()
     }
   double c;
   if (method == "upwind")
-    c = 1.0;
+    c = muscl ? 0.5 : 1.0;
   else if (method == "lw")
     c = 0.72;
+  else if (semi_lagrangian) //Stable for any cfl
+    c = 1.0;
   else
   {
     c = 0.;
@@ -164,6 +309,44 @@ void Linear_Convection_2d::compute_time_step()
   cout << "dt = "<<dt <<endl;
 }
 
+//With Courant numbers nu_x = dt*face_speed_x/dx, nu_y = dt*face_speed_y/dy,
+//the von Neumann condition of the upwind scheme is nu_x + nu_y <= 1, and that
+//of the Lax-Wendroff scheme with the cross terms of lw() is
+//nu_x^(2/3) + nu_y^(2/3) <= 1 (c = 0.72 above is about its value for
+//nu_x = nu_y). Then cfl scales the dt.
+double Linear_Convection_2d::admissible_dt() const
+{
+  const double rate_x = face_speed_x/dx, rate_y = face_speed_y/dy;
+  double rate;
+  if (method == "lw")
+    rate = pow(cbrt(rate_x*rate_x) + cbrt(rate_y*rate_y), 1.5);
+  else
+    rate = rate_x + rate_y;
+  if (rate == 0.0) //No velocity, any dt is stable
+    return final_time;
+  if (muscl) //The limited slopes are TVD for half the Courant number
+    return 0.5*cfl/rate;
+  return cfl/rate;
+}
+
+double Linear_Convection_2d::adapt_time_step(bool output_indicator)
+{
+  dt = admissible_dt();
+  double t_stop = final_time;
+  if (output_indicator)
+    t_stop = min(t_stop, next_output_time);
+  //Up to round off, so that steps of a constant dt land on t_stop
+  if (t + dt*(1.0+1e-10) >= t_stop)
+  {
+    dt = t_stop - t;
+    return t_stop; //Exactly, with no round off
+  }
+  //Two equal steps instead of a full one and a very small one
+  if (t + 2.0*dt > t_stop)
+    dt = 0.5*(t_stop - t);
+  return t + dt;
+}
+
 void Linear_Convection_2d::make_grid()
 {
   //Note that you must run two for loops for a rectangular grid.
@@ -265,14 +448,50 @@ void Linear_Convection_2d::lw_y(int i, double &flux)
 //normal velocity v_n = vel[0]*nx+vel[1]*ny,
 //flux = max(v_n,0.)*Q_int + min(v_n, 0.)*qb
 
-void Linear_Convection_2d::apply_fvm()
+//With MUSCL, the face values are those of the limited linear reconstruction,
+//Q_l = solution(i,j) + 0.5*slope_x(i,j), Q_r = solution(i+1,j) -
+//0.5*slope_x(i+1,j) at the face (i+1/2,j), and the slopes of the cells next to
+//the boundary use ghost cells with the exact solution at t_stage. WENO5 is
+//the same with the face values of compute_weno5_faces and 3 layers of ghosts.
+void Linear_Convection_2d::compute_residual(double t_stage)
 {
   double x,y;//This will be face centers
   double flux; //flux_x(i+1/2,j), flux_y(i,j+1/2)
   //This loop computes the fluxes and adds them to where they are needed
+  timer.start("boundary");
   solution.update_fluff();
+  if (muscl || weno) //Dirichlet ghost values, the corners are not used
+  {
+    const int n_ghost = solution.n_ghost();
+    for (int g = 1; g <= n_ghost; g++)
+    {
+      for (int j = 0; j < N_y; j++)
+      {
+        solution(-g,j)      = exact_soln(xmin-(g-0.5)*dx,grid_y[j],t_stage);
+        solution(N_x-1+g,j) = exact_soln(xmax+(g-0.5)*dx,grid_y[j],t_stage);
+      }
+      for (int i = 0; i < N_x; i++)
+      {
+        solution(i,-g)      = exact_soln(grid_x[i],ymin-(g-0.5)*dy,t_stage);
+        solution(i,N_y-1+g) = exact_soln(grid_x[i],ymax+(g-0.5)*dy,t_stage);
+      }
+    }
+  }
+  timer.stop("boundary");
+  if (muscl)
+  {
+    Scoped_Timer reconstruct_timer(timer, "reconstruct");
+    compute_slopes(solution, slope_limiter, slope_x, slope_y);
+  }
+  else if (weno)
+  {
+    Scoped_Timer reconstruct_timer(timer, "reconstruct");
+    compute_weno5_faces(solution, weno_x_minus, weno_x_plus,
+                        weno_y_minus, weno_y_plus);
+  }
+  timer.start("residual");
   residual = 0.0;//For different time integration
-  double lam = dt/(dx*dy);
+  face_speed_x = face_speed_y = 0.0; //Max over faces, for the next dt
   //We'd do solution = solution_old - dt/dx * (f_x(i+1/2,j)-f_x(i-1/2,j))
   //                                - dt/dx * (f_y(i,j+1/2)-f_y(i,j-1/2))
 
@@ -297,8 +516,13 @@ void Linear_Convection_2d::apply_fvm()
       x = (xmin+dx)+i*dx, y = ymin+0.5*dy+j*dy; //Values on face centre
       //(x_{i+1/2},y_j)
       (*advection_velocity)(x,y,vel);
-      const double Q_l = reconstruct(solution(i-1,j),solution(i,j));
-      const double Q_r = reconstruct(solution(i,j),solution(i+1,j));
+      face_speed_x = max(face_speed_x,abs(vel[0]));
+      double Q_l, Q_r;
+      if (weno)
+        Q_l = weno_x_plus(i,j), Q_r = weno_x_minus(i+1,j);
+      else
+        Q_l = solution(i,j)   + 0.5*slope_x(i,j),
+        Q_r = solution(i+1,j) - 0.5*slope_x(i+1,j);
       (*update_flux)(1,0,vel,Q_l,Q_r,flux);
       residual(i,j)   += -flux*dy;
       residual(i+1,j) +=  flux*dy;
@@ -313,12 +537,18 @@ void Linear_Convection_2d::apply_fvm()
       x = (xmin+0.5*dx)+i*dx, y = (ymin+dy)+j*dy; //Values on face centre.
       //(x_i,y_{j+1/2})
       (*advection_velocity)(x,y,vel);
-      const double Q_l = reconstruct(solution(i,j-1),solution(i,j));
-      const double Q_r = reconstruct(solution(i,j),solution(i,j+1));
+      face_speed_y = max(face_speed_y,abs(vel[1]));
+      double Q_l, Q_r;
+      if (weno)
+        Q_l = weno_y_plus(i,j), Q_r = weno_y_minus(i,j+1);
+      else
+        Q_l = solution(i,j)   + 0.5*slope_y(i,j),
+        Q_r = solution(i,j+1) - 0.5*slope_y(i,j+1);
       (*update_flux)(0,1,vel,Q_l,Q_r,flux);
       residual(i,j)     += -flux*dx;
       residual(i,j+1)   +=  flux*dx;
     }
+  timer.stop("residual");
 
   //Now, we do the exterior faces which will have
   //x = xmax,xmin or y = ymax, ymin
@@ -327,6 +557,7 @@ void Linear_Convection_2d::apply_fvm()
   //the cell. In our definition of residual dy/dt = res(Q), note that
   //we always subtracted the flux going out. So, we shall do the same this
   //time.
+  timer.start("boundary");
 
   //To use flux = max(v_n,0.)*Q_int + min(v_n, 0.)*qb
   double Q_int,Q_b;
@@ -339,9 +570,12 @@ void Linear_Convection_2d::apply_fvm()
     //velocity there
     x = xmax, y = (ymin+0.5*dy)+j*dy;
     (*advection_velocity)(x,y,vel);//Velocity at face centers
+    face_speed_x = max(face_speed_x,abs(vel[0]));
     //vn = vel[0]*nx+vel[1]*ny;
     //Now, use flux = max(v_n,0.)*Q_int + min(v_n, 0.)*qb
-    Q_int = solution(N_x-1,j),Q_b=exact_soln(x,y,t);
+    Q_int = weno ? weno_x_plus(N_x-1,j)
+                 : solution(N_x-1,j) + 0.5*slope_x(N_x-1,j);
+    Q_b = exact_soln(x,y,t_stage);
     (*update_flux)(1,0,vel,Q_int,Q_b,flux);
     residual(N_x-1,j)+= -flux*dy;
   }
@@ -352,7 +586,9 @@ void Linear_Convection_2d::apply_fvm()
   {
     x = xmin, y= (ymin+0.5*dy)+j*dy;
     (*advection_velocity)(x,y,vel);
-    Q_int = solution(0,j), Q_b = exact_soln(x,y,t);
+    face_speed_x = max(face_speed_x,abs(vel[0]));
+    Q_int = weno ? weno_x_minus(0,j) : solution(0,j) - 0.5*slope_x(0,j);
+    Q_b = exact_soln(x,y,t_stage);
     (*update_flux)(-1.,0.,vel,Q_int,Q_b,flux);
     residual(0,j) += -flux*dy;
   }
@@ -363,7 +599,10 @@ void Linear_Convection_2d::apply_fvm()
   {
     x = (xmin+0.5*dx)+i*dx,y=ymax;
     (*advection_velocity)(x,y,vel);
-    Q_int = solution(i,N_y-1),Q_b = exact_soln(x,y,t);
+    face_speed_y = max(face_speed_y,abs(vel[1]));
+    Q_int = weno ? weno_y_plus(i,N_y-1)
+                 : solution(i,N_y-1) + 0.5*slope_y(i,N_y-1);
+    Q_b = exact_soln(x,y,t_stage);
     (*update_flux)(0,1,vel,Q_int,Q_b,flux);
     residual(i,N_y-1) += -flux*dx;
   }
@@ -374,29 +613,193 @@ void Linear_Convection_2d::apply_fvm()
   {
     x = (xmin+0.5*dx)+i*dx,y=ymin;
     (*advection_velocity)(x,y,vel);
-    Q_int = solution(i,0),Q_b = exact_soln(x,y,t);
+    face_speed_y = max(face_speed_y,abs(vel[1]));
+    Q_int = weno ? weno_y_minus(i,0) : solution(i,0) - 0.5*slope_y(i,0);
+    Q_b = exact_soln(x,y,t_stage);
     (*update_flux)(0,-1,vel,Q_int,Q_b,flux);
     residual(i,0) +=  -flux*dx;
   }
+  timer.stop("boundary");
+}
 
-
+//Forward Euler for the first order scheme. With MUSCL, the two stage SSP-RK2
+//  Q^(1) = Q^n + dt*res(Q^n, t),
+//  Q^(n+1) = (Q^n + Q^(1) + dt*res(Q^(1), t+dt))/2
+//and with WENO5 the three stage SSP-RK3
+//  Q^(1) = Q^n + dt*res(Q^n, t),
+//  Q^(2) = 3/4 Q^n + 1/4 (Q^(1) + dt*res(Q^(1), t+dt)),
+//  Q^(n+1) = 1/3 Q^n + 2/3 (Q^(2) + dt*res(Q^(2), t+dt/2))
+void Linear_Convection_2d::apply_fvm()
+{
+  double lam = dt/(dx*dy);
+  compute_residual(t);
+  timer.start("update");
   for (int i = 0; i<N_x; i++)
     for (int j = 0; j<N_y; j++)
     {
       solution(i,j) = solution_old(i,j) + lam*residual(i,j);
     }
+  timer.stop("update");
+  if (muscl)
+  {
+    compute_residual(t+dt);
+    timer.start("update");
+    for (int i = 0; i<N_x; i++)
+      for (int j = 0; j<N_y; j++)
+      {
+        solution(i,j) = 0.5*(solution_old(i,j) + solution(i,j)
+                             + lam*residual(i,j));
+      }
+    timer.stop("update");
+  }
+  else if (weno)
+  {
+    compute_residual(t+dt);
+    timer.start("update");
+    for (int i = 0; i<N_x; i++)
+      for (int j = 0; j<N_y; j++)
+      {
+        solution(i,j) = 0.75*solution_old(i,j)
+                        + 0.25*(solution(i,j) + lam*residual(i,j));
+      }
+    timer.stop("update");
+    compute_residual(t+0.5*dt);
+    timer.start("update");
+    for (int i = 0; i<N_x; i++)
+      for (int j = 0; j<N_y; j++)
+      {
+        solution(i,j) = (solution_old(i,j)
+                         + 2.0*(solution(i,j) + lam*residual(i,j)))/3.0;
+      }
+    timer.stop("update");
+  }
+}
+
+
+
+//Classical RK4 for dx/dt = vel(x), backwards from t+dt to t
+void Linear_Convection_2d::trace_back(double x, double y, int n_substeps,
+                                      double &x0, double &y0) const
+{
+  const double h = -dt/n_substeps;
+  double k1[2], k2[2], k3[2], k4[2];
+  for (int n = 0; n < n_substeps; n++)
+  {
+    (*advection_velocity)(x, y, k1);
+    (*advection_velocity)(x + 0.5*h*k1[0], y + 0.5*h*k1[1], k2);
+    (*advection_velocity)(x + 0.5*h*k2[0], y + 0.5*h*k2[1], k3);
+    (*advection_velocity)(x + h*k3[0], y + h*k3[1], k4);
+    x += h*(k1[0] + 2.0*k2[0] + 2.0*k3[0] + k4[0])/6.0;
+    y += h*(k1[1] + 2.0*k2[1] + 2.0*k3[1] + k4[1])/6.0;
+  }
+  x0 = x, y0 = y;
+}
+
+//Weights of the cubic through the nodes -1,0,1,2 at s in [0,1)
+void cubic_weights(double s, double w[4])
+{
+  w[0] = -s*(s-1.0)*(s-2.0)/6.0;
+  w[1] = (s+1.0)*(s-1.0)*(s-2.0)/2.0;
+  w[2] = -(s+1.0)*s*(s-2.0)/2.0;
+  w[3] = (s+1.0)*s*(s-1.0)/6.0;
 }
 
+void Linear_Convection_2d::compute_departure_points()
+{
+  Scoped_Timer departure_timer(timer, "departure_points");
+  //RK4 substeps of Courant number at most 1
+  double u0max = 0.0, u1max = 0.0, v[2];
+  for (int j = 0; j < N_y; j++)
+    for (int i = 0; i < N_x; i++)
+    {
+      (*advection_velocity)(grid_x[i], grid_y[j], v);
+      u0max = max(u0max,abs(v[0])), u1max = max(u1max,abs(v[1]));
+    }
+  const int n_substeps = max(1, int(ceil(dt*(u0max/dx + u1max/dy))));
+  departure_points.resize(N_x*N_y);
+  for (int j = 0; j < N_y; j++)
+    for (int i = 0; i < N_x; i++)
+    {
+      Departure_Point &p = departure_points[i + j*N_x];
+      trace_back(grid_x[i], grid_y[j], n_substeps, p.x, p.y);
+      p.inside = (p.x >= xmin && p.x <= xmax && p.y >= ymin && p.y <= ymax);
+      if (p.inside == false)
+        continue;
+      //Between the centres i and i+1, -1 <= i <= N_x-1, so that the stencil
+      //i-1,...,i+2 is in the 2 ghost layers
+      const double sx = (p.x - grid_x[0])/dx, sy = (p.y - grid_y[0])/dy;
+      p.i = min(int(floor(sx)), N_x-1), p.j = min(int(floor(sy)), N_y-1);
+      cubic_weights(sx - p.i, p.wx);
+      cubic_weights(sy - p.j, p.wy);
+    }
+  departure_dt = dt;
+  timer.count("departure_point_updates");
+}
 
+//The ghost cells of solution_old are the exact solution at t, like the
+//Dirichlet values of the other schemes
+void Linear_Convection_2d::apply_semi_lagrangian()
+{
+  if (dt != departure_dt)
+    compute_departure_points();
+  timer.start("boundary");
+  for (int g = 1; g <= 2; g++)
+  {
+    for (int j = -2; j < N_y+2; j++)
+    {
+      const double y = grid_y[0] + j*dy;
+      solution_old(-g,j)      = exact_soln(xmin-(g-0.5)*dx,y,t);
+      solution_old(N_x-1+g,j) = exact_soln(xmax+(g-0.5)*dx,y,t);
+    }
+    for (int i = 0; i < N_x; i++)
+    {
+      solution_old(i,-g)      = exact_soln(grid_x[i],ymin-(g-0.5)*dy,t);
+      solution_old(i,N_y-1+g) = exact_soln(grid_x[i],ymax+(g-0.5)*dy,t);
+    }
+  }
+  timer.stop("boundary");
+  Scoped_Timer interpolate_timer(timer, "interpolate");
+  for (int j = 0; j < N_y; j++)
+    for (int i = 0; i < N_x; i++)
+    {
+      const Departure_Point &p = departure_points[i + j*N_x];
+      if (p.inside == false)
+      {
+        solution(i,j) = exact_soln(p.x,p.y,t);
+        continue;
+      }
+      double value = 0.0;
+      for (int b = 0; b < 4; b++)
+      {
+        const double *row = &solution_old(p.i-1,p.j-1+b);
+        value += p.wy[b]*(p.wx[0]*row[0] + p.wx[1]*row[1]
+                          + p.wx[2]*row[2] + p.wx[3]*row[3]);
+      }
+      if (monotone) //No new extrema, clipped to the 4 values around the foot
+      {
+        const double q00 = solution_old(p.i,p.j), q10 = solution_old(p.i+1,p.j);
+        const double q01 = solution_old(p.i,p.j+1);
+        const double q11 = solution_old(p.i+1,p.j+1);
+        const double q_min = min(min(q00,q10),min(q01,q11));
+        const double q_max = max(max(q00,q10),max(q01,q11));
+        value = min(max(value,q_min),q_max);
+      }
+      solution(i,j) = value;
+    }
+}
 
 void Linear_Convection_2d::apply_lw()
 {
   double x,y;
   double flux; //flux_x(i+1/2,j), flux_y(i,j+1/2)
   //This loop computes the fluxes and adds them to where they are needed
+  timer.start("boundary");
   solution.update_fluff();
+  timer.stop("boundary");
+  timer.start("residual");
   residual = 0.0;//For different time integration
   double lam = dt/(dx*dy);
+  face_speed_x = face_speed_y = 0.0; //Max over faces, for the next dt
   //We'd do solution = solution_old - dt/dx * (f_x(i+1/2,j)-f_x(i-1/2,j))
   //                                - dt/dx * (f_y(i,j+1/2)-f_y(i,j-1/2))
 
@@ -412,6 +815,7 @@ void Linear_Convection_2d::apply_lw()
       x = (xmin+dx)+i*dx, y = (ymin+0.5*dy)+j*dy; //Values on face centre
       //(x_{i+1/2},y_j)
       (*advection_velocity)(x,y,vel);
+      face_speed_x = max(face_speed_x,abs(vel[0]));
       lw(i,j,1,0,flux); //flux_x(i+1/2,j)
       residual(i,j)     += -flux*dy;
       residual(i+1,j) +=  flux*dy;
@@ -425,11 +829,13 @@ void Linear_Convection_2d::apply_lw()
       double x = (xmin+0.5*dx)+i*dx, y = (ymin+dy)+j*dy; //Values on face centre.
       //(x_i,y_{j+1/2})
       (*advection_velocity)(x,y,vel);
+      face_speed_y = max(face_speed_y,abs(vel[1]));
       lw(i,j,0,1,flux);//flux_y(i,j+1/2)
 
       residual(i,j)     += -flux*dx;
       residual(i,j+1)   +=  flux*dx;
     }
+  timer.stop("residual");
 
 
   //Now, we do the exterior faces which will have
@@ -439,6 +845,7 @@ void Linear_Convection_2d::apply_lw()
   //the cell. In our definition of residual dy/dt = res(Q), note that
   //we always subtracted the flux going out. So, we shall do the same this
   //time.
+  timer.start("boundary");
 
   int nx,ny;
   double vn;//Normal velocity
@@ -452,6 +859,7 @@ void Linear_Convection_2d::apply_lw()
     //velocity there
     x = xmax, y = (ymin+0.5*dy)+j*dy;
     (*advection_velocity)(x,y,vel);//Velocity at face centers
+    face_speed_x = max(face_speed_x,abs(vel[0]));
     vn = vel[0]*nx+vel[1]*ny;
     if (vn<=0.-1e-12) //Check if boundary is inflow or outflow
       flux = 0.5*vel[0]*(exact_soln(x,y,t+dt)+exact_soln(x,y,t));
@@ -471,6 +879,7 @@ void Linear_Convection_2d::apply_lw()
   {
     x = (xmin+0.5*dx)+i*dx, y=ymin;
     (*advection_velocity)(x,y,vel);
+    face_speed_y = max(face_speed_y,abs(vel[1]));
     vn = vel[0]*nx+vel[1]*ny;
     if (vn<=0.-1e-12) //Check if boundary is inflow or outflow
       flux = 0.5*vel[1]*(exact_soln(x,y,t+dt)+exact_soln(x,y,t));
@@ -489,6 +898,7 @@ void Linear_Convection_2d::apply_lw()
   {
     x = xmin, y= (ymin+0.5*dy)+j*dy;
     (*advection_velocity)(x,y,vel);
+    face_speed_x = max(face_speed_x,abs(vel[0]));
     lw_x(j,flux);
     residual(0,j) += flux*dy;
   }
@@ -500,46 +910,92 @@ void Linear_Convection_2d::apply_lw()
   {
     x = (xmin+0.5*dx)+i*dx,y=ymax;
     (*advection_velocity)(x,y,vel);
+    face_speed_y = max(face_speed_y,abs(vel[1]));
     lw_y(i,flux);
     residual(i,N_y-1) += -flux*dx;
   }
+  timer.stop("boundary");
 
+  timer.start("update");
   for (int i = 0; i<N_x; i++)
     for (int j = 0; j<N_y; j++)
     {
       solution(i,j) = solution_old(i,j) + lam*residual(i,j);
     }
+  timer.stop("update");
 }
 
 void Linear_Convection_2d::evaluate_error_and_output_solution(int time_step_number,bool output_indicator)
 {
-  double x,y;
-  for (int i = 0; i < N_x; i++)
+  bool output_now = (output_indicator==true && time_step_number%15==0);
+  if (adaptive_dt) //Steps land on the output times
+    output_now = (output_indicator==true && t >= next_output_time);
+  const bool final_step = (t >= final_time);
+  if (output_now)
+  {
+    //The exact solution is written along with the solution
+    Scoped_Timer error_timer(timer, "error");
+    //Rows of solution_exact are contiguous
     for (int j = 0; j < N_y; j++)
-    {
-      x = (xmin+0.5*dx) + i*dx, y = (ymin+0.5*dy) + j*dy;
-      advection_velocity(x,y,vel);
-      solution_exact(i,j) = exact_soln(x,y,t);
-    }
-  if (output_indicator==true && time_step_number%15==0)
+      exact_soln_row(N_x,&grid_x[0],grid_y[j],t,&solution_exact(0,j));
+  }
+  //The error is kept as norms, but it can be used for reasons other than
+  //outputting, like adaptive grid refinement.
+  if (final_step || error_policy.evaluate(time_step_number))
+  {
+    Scoped_Timer error_timer(timer, "error");
+    Error_Norms norms = compute_error(final_step ||
+                                      !error_policy.is_sampled(),
+                                      output_now);
+    if (final_step)
+      final_norms = norms;
+    error_history.push_back(make_pair(t,norms));
+    timer.count("error_evaluations");
+  }
+  if (output_now)
   {
+  Scoped_Timer output_timer(timer, "output");
   vtk_anim_sol(grid_x,grid_y,
         solution, solution_exact,
-        t, time_step_number/15,
+        t, output_number,
         "approximate_solution");
+  output_number += 1;
+  next_output_time += output_interval;
   }
-  //There is a separate function for outputting the error. This is because the
-  //error can be used for reasons other than outputting, like adaptive grid
-  //refinement.
-  for (int i = 0; i < N_x; i++)
-    for (int j = 0; j < N_y; j++)
+}
+
+Error_Norms Linear_Convection_2d::compute_error(bool all_cells,
+                                                bool exact_ready)
+{
+  Error_Accumulator errors;
+  if (all_cells == false)
+  {
+    const vector<pair<int,int> > &cells = error_policy.sample(N_x,N_y);
+    for (unsigned int s = 0; s < cells.size(); s++)
     {
-      error(i,j) = abs(solution(i,j) - solution_exact(i,j));
+      const int i = cells[s].first, j = cells[s].second;
+      errors.add(solution(i,j), exact_soln(grid_x[i],grid_y[j],t));
     }
+    return errors.norms(true);
+  }
+  //One row at a time, the exact solution is only kept for the row
+  for (int j = 0; j < N_y; j++)
+  {
+    const double *exact = &solution_exact(0,j);
+    if (exact_ready == false)
+    {
+      exact_soln_row(N_x,&grid_x[0],grid_y[j],t,&exact_row[0]);
+      exact = &exact_row[0];
+    }
+    errors.add(N_x,&solution(0,j),exact);
+  }
+  return errors.norms();
 }
 
 void Linear_Convection_2d::run(bool output_indicator)
 {
+  // Everything not in one of the phases, like setting up the grid
+  Scoped_Timer run_timer(timer, "other");
   make_grid();
   int time_step_number = 0;
   //compute_time_step(); Computes dt
@@ -547,7 +1003,9 @@ void Linear_Convection_2d::run(bool output_indicator)
   evaluate_error_and_output_solution(time_step_number,output_indicator);
   while (t < final_time) //compute solution at next time step using solution_old
   {
+    timer.start("update");
     solution_old = solution;//update solution_old for next time_step
+    timer.stop("update");
     //At t = 2*pi, exact_soln(x,y,t)=initial_solution(x,y). So, at
     //this t, we would like to compute error as
     //error(x_i,y_j) = |initial_solution(x_i,y_j)-solution(x_i,y_j)|
@@ -555,49 +1013,112 @@ void Linear_Convection_2d::run(bool output_indicator)
     //our dt. Note that it is important to change dt BEFORE applying the
     //solver as the solver will be updating solution using the dt. This
     //would be the last update in our scheme.
-    if (t+dt > final_time)
-      dt = final_time-t;
+    double t_next;
+    if (adaptive_dt)
+      t_next = adapt_time_step(output_indicator);
+    else
+    {
+      if (t+dt > final_time)
+        dt = final_time-t;
+      t_next = t + dt;
+    }
+    // Memory traffic per cell is solution, solution_old, residual set to
+    // zero, updated by x and y faces and read, and the new solution. Each
+    // face gives about 10 flops for upwind and 30 for lw, done by 2 faces
+    // per cell, plus 2 for the update.
+    const double bytes = 9*8.0*N_x*N_y;
     if (method == "lw")
+    {
+      perf.start("apply_lw");
       apply_lw();
+      perf.stop("apply_lw", bytes, 62.0*N_x*N_y);
+    }
+    else if (semi_lagrangian)
+    {
+      //Per cell the departure point (80 bytes), 16 values of solution_old
+      //mostly from cache and the new value, 4*(4+2) flops for the cubic
+      perf.start("apply_semi_lagrangian");
+      apply_semi_lagrangian();
+      perf.stop("apply_semi_lagrangian", (80.0+2*8.0)*N_x*N_y,
+                24.0*N_x*N_y);
+    }
     else
+    {
+      //MUSCL does two stages, each with the slopes, about 4 reads and 2
+      //writes and 15 flops per cell more. WENO5 does three, each with 4 face
+      //values written and read and about 4*50 flops per cell more.
+      double stages = 1.0, extra_bytes = 0.0, extra_flops = 0.0;
+      if (muscl)
+        stages = 2.0, extra_bytes = 6*8.0, extra_flops = 15.0;
+      else if (weno)
+        stages = 3.0, extra_bytes = 9*8.0, extra_flops = 200.0;
+      perf.start("apply_fvm");
       apply_fvm();
+      perf.stop("apply_fvm", stages*(bytes + extra_bytes*N_x*N_y),
+                stages*(22.0 + extra_flops)*N_x*N_y);
+    }
     //Should the flux be computed with old time or new time?
     time_step_number += 1;
+    timer.count("time_steps");
+    timer.count("cell_updates", N_x*N_y);
+    dt_history.push_back(make_pair(t_next,dt));
     //Ensure we end at final_time
-    t = t + dt;
+    t = t_next;
     evaluate_error_and_output_solution(time_step_number, output_indicator);
   }
   cout << "For N_x = " << N_x<<", N_y = "<<N_y<<", we took ";
   cout << time_step_number << " steps." << endl;
+  double dt_min = final_time, dt_max = 0.0;
+  for (unsigned int n = 0; n < dt_history.size(); n++)
+    dt_min = min(dt_min,dt_history[n].second),
+    dt_max = max(dt_max,dt_history[n].second);
+  timer.add_info("dt_min", dt_min);
+  timer.add_info("dt_max", dt_max);
+  timer.add_info("dt_mean", final_time/max(time_step_number,1));
   if (output_indicator)
+  {
     cout <<"We produce output in this refinement level\n";
+    ofstream error_vs_t("error_vs_t.txt");
+    error_vs_t << "# t l1 l2 linfty l1_ci l2_ci, error evaluation "
+               << error_policy.get_spec() << "\n";
+    for (unsigned int e = 0; e < error_history.size(); e++)
+      write_error_line(error_vs_t, error_history[e].first,
+                       error_history[e].second);
+    ofstream dt_vs_t("dt_vs_t.txt");
+    dt_vs_t << "# t dt, at the end of each step\n";
+    for (unsigned int n = 0; n < dt_history.size(); n++)
+      dt_vs_t << dt_history[n].first << " " << dt_history[n].second << "\n";
+  }
+  perf.report();
 }
 
 void run_and_output(int N_x, int N_y, double cfl,
                     string method, double final_time,
                     int initial_data_indicator,
-                    unsigned int n_refinements)
+                    unsigned int n_refinements,
+                    string error_spec,
+                    bool adaptive_dt,
+                    string limiter)
 {
   ofstream error_vs_h;
   error_vs_h.open("error_vs_h.txt");
   vector<double> linfty_vector;
   vector<double> l2_vector;
   vector<double> l1_vector;
+  vector<Timer> timers; // Phases of each refinement level
 
   for (unsigned int refinement_level = 0; refinement_level <= n_refinements;
       refinement_level++)
   {
     Linear_Convection_2d solver(N_x, N_y, cfl, method, final_time,
-                                initial_data_indicator);
-    //We calculate time takenṣ in our refinement.
-    struct timeval begin, end;
-    gettimeofday(&begin, 0);
+                                initial_data_indicator, error_spec,
+                                adaptive_dt, limiter);
     solver.run(refinement_level==n_refinements);//Output only last soln
-    gettimeofday(&end, 0);
-    long seconds = end.tv_sec - begin.tv_sec;
-    long microseconds = end.tv_usec - begin.tv_usec;
-    double elapsed = double(seconds) + double(microseconds) * 1e-6;
+    //We calculate time taken in our refinement.
+    double elapsed = solver.get_timer().total_seconds();
     cout << "Time taken by this refinement level is " << elapsed << " seconds." << endl;
+    solver.get_timer().print();
+    timers.push_back(solver.get_timer());
     solver.get_error(l1_vector,l2_vector,linfty_vector);//push_back resp. error.
     double h = 2.*sqrt(1./(N_x*N_x) +1./(N_y*N_y));
     error_vs_h << h << " " << linfty_vector[refinement_level] << "\n";
@@ -623,6 +1144,8 @@ void run_and_output(int N_x, int N_y, double cfl,
     }
     error_vs_h.close();
   }
+  write_json(timers, "timing.json");
+  cout << "Phase timings written to timing.json" << endl;
   cout << "After " << n_refinements << " refinements, l_infty error = ";
   cout << linfty_vector[linfty_vector.size()-1] << endl;
   cout << "The L1 error is " << l1_vector[linfty_vector.size()-1] << endl;
@@ -635,65 +1158,81 @@ void Linear_Convection_2d::get_error(vector<double> &l1_vector,
 {
     //Check if initial_state=final_state. If it is, we will discard the
     //error from exact solution, and compute error using initial_data
-    if (int_tester(final_time/(2.0*M_PI)) == true &&
-        int_tester(final_time/(2.0*M_PI)) == true)
+    Error_Norms norms = final_norms;
+    if (int_tester(final_time/(2.0*M_PI)) == true)
     {
     cout << "final_state=initial_state, so error=|solution - initial_data|\n";
-    for (int i = 0; i < N_x; i++)
-      for (int j = 0; j < N_y; j++)
-        {
-          error(i,j) = abs(solution(i,j) - initial_solution(i,j));
-        }
-    }
-    double l1,l2,linfty;
-    //Outputting error.
+    Error_Accumulator errors;
     for (int j = 0; j < N_y; j++)
-      for (int i = 0; i < N_x; i++)
-      {
-        l1 += error(i,j)  * dx * dy;                 // L1 error
-        l2 += + error(i,j) * error(i,j)  * dx * dy;  // L2 error
-        linfty = max(linfty, error(i,j));            // L_infty error
-      }
-    double area = N_x*N_y*dx*dy;//dx*dy = area of a cell, N_x*N_y = #cells
-    l1 = l1/area;
-    l2 = sqrt(l2/area);
-    l1_vector.push_back(l1);
-    l2_vector.push_back(l2);
-    linfty_vector.push_back(linfty);
+      errors.add(N_x,&solution(0,j),&initial_solution(0,j));
+    norms = errors.norms();
+    }
+    //The norms are normalized by the area, l1 = sum |error| dx dy / area
+    l1_vector.push_back(norms.l1);
+    l2_vector.push_back(norms.l2);
+    linfty_vector.push_back(norms.linfty);
 }
 
 int main(int argc, char **argv)
 {
-    if (argc != 6 && argc != 7)
+    if (argc < 6 || argc > 10)
     {
       cout << "Incorrect format, use" << endl;
       cout << "./fv2d_var_coeff method";
       cout << " sigma_x final_time initial_data_indicator n_refinements\n";
       cout << "Choices for method"<<endl;
-      cout << "upwind, lw, ct_upwind, m_roe"<<endl;
+      cout << "upwind, lw, sl_cubic, sl_monotone (semi-Lagrangian, stable ";
+      cout << "for any sigma_x)"<<endl;
       cout << "Choices for initial data 0 - smooth_sine \n 1 - hat \n";
       cout << "2 - step \n 3 - exp_func_25 \n 4 - exp_func_50\n5 - cts_sine\n";
       cout << "You can add a 'constant' at the end of above to test";
       cout << "constant coefficients case. \n";
-      cout << "Putting 2pi in place of final_time will work.";
+      cout << "Putting 2pi in place of final_time will work.\n";
+      cout << "errors=final, errors=every:k, errors=sample:m or ";
+      cout << "errors=sample:m:k at the end sets when the error is evaluated";
+      cout << " (see include/error_evaluation.h), the default is final.\n";
+      cout << "dt=adaptive at the end computes dt at every step from the ";
+      cout << "face velocities, dt=fixed (the default) keeps the first dt.\n";
+      cout << "limiter=minmod, limiter=superbee or limiter=vanleer makes ";
+      cout << "upwind second order (MUSCL with SSP-RK2), limiter=weno5 fifth ";
+      cout << "order (with SSP-RK3), limiter=none (the default) keeps it ";
+      cout << "first order.";
       assert(false);
     }
-    if (argc == 7)
+    string error_spec = "final";
+    bool adaptive_dt = false;
+    string limiter = "none";
+    for (int a = 6; a < argc; a++)
     {
-      if (string(argv[6]) != "constant")
+      string arg = argv[a];
+      if (arg == "constant")
       {
-        cout <<"Last argument must be constant.\n";
-        cout << "You put "<< argv[6] <<endl;
-        assert(false);
+        advection_velocity = &constant_velocity;
+        cout <<"Scheme will be run with constant (u,v)=(1,1)"<<endl;
       }
+      else if (arg.compare(0,7,"errors=") == 0)
+        error_spec = arg.substr(7);
+      else if (arg == "dt=adaptive" || arg == "dt=fixed")
+        adaptive_dt = (arg == "dt=adaptive");
+      else if (arg.compare(0,8,"limiter=") == 0)
+        limiter = arg.substr(8);
       else
       {
-        advection_velocity = &constant_velocity;
-        cout <<"Scheme will be run with constant (u,v)=(1,1)"<<endl;
+        cout <<"Last arguments must be constant, errors=..., dt=... or ";
+        cout <<"limiter=...\n";
+        cout << "You put "<< arg <<endl;
+        assert(false);
       }
     }
+    cout << "error evaluation = " << error_spec << endl;
     string method = argv[1];
     cout << "method = " << method << endl;
+    cout << "limiter = " << limiter << endl;
+    if (method != "upwind" && limiter != "none")
+    {
+      cout << "The limiters are for upwind only"<<endl;
+      assert(false);
+    }
     int N_x = 10, N_y = 10;
     double sigma_x = stod(argv[2]);
     cout << "sigma_x = " << sigma_x << endl;
@@ -710,11 +1249,12 @@ int main(int argc, char **argv)
     //Sets the numerical flux
     if (method=="upwind")
       update_flux=&upwind;
-    else if(method != "lw")
+    else if(method != "lw" && method != "sl_cubic" && method != "sl_monotone")
     {
       cout <<"You incorrectly put method = "<<method<<endl;
       assert(false);
     }
     run_and_output(N_x, N_y, sigma_x, method, final_time,
-                       initial_data_indicator, n_refinements);
+                       initial_data_indicator, n_refinements, error_spec,
+                       adaptive_dt, limiter);
 }
@@ -8,11 +8,14 @@
 #include <string>
 #include <cstring>
 #include <stdio.h>
-#include <sys/time.h>
 
 #include "../../include/array2d.h"
 #include "../../include/vtk_anim.h"
 #include "../../include/initial_conditions.h"
+#include "../../include/error_evaluation.h"
+#include "../../include/muscl2d.h"
+#include "../../include/split2d.h"
+#include "../../include/timer.h"
 using namespace std;
 
 //Returns true if real number is integer, false otherwise.
@@ -23,13 +26,6 @@ bool int_tester(double a)
   return (c<1e-4);
 }
 
-double reconstruct(double Qm1,double Q0)
-{
-  (void)Qm1;
-  return Q0;
-}
-
-
 void (*update_flux)(int nx, int ny,double vel[2],double Q_l,double Q_r, double &flux);
 
 void upwind(int nx, int ny, double vel[2], double Q_l, double Q_r, double& flux)
@@ -58,11 +54,15 @@ public:
     Linear_Convection_2d(int N_x, int N_y,
                          double cfl,
                          string method, const double final_time,
-                         int initial_data_indicator); 
+                         int initial_data_indicator,
+                         string error_spec = "final",
+                         string limiter = "none",
+                         bool split = false);
 
     void run(bool output_indicator);
     void get_error(vector<double> &l1_vector, vector<double> &l2_vector, 
                    vector<double> &linfty_vector);
+    const Timer& get_timer() const { return timer; }
 private:
     void make_grid();
     void set_initial_solution();
@@ -73,11 +73,17 @@ private:
     void lw(int i, int j, int nx, int ny, double& flux);
     void upwind(int i, int j, int nx, int ny, double& flux);
 
+    //Residual of the finite volume scheme for the solution in solution
+    void compute_residual();
     void apply_fvm();
     void apply_lw();
 
     void evaluate_error_and_output_solution(const int time_step_number,
                                             bool output_indicator);
+    //Norms of solution - exact solution at t, on all cells or on the sample
+    //of error_policy. With exact_ready, solution_exact already holds the
+    //exact solution at t.
+    Error_Norms compute_error(bool all_cells, bool exact_ready);
     vector<double> grid_x,grid_y;
     
     double vel[2]; //advection velocity vector
@@ -89,28 +95,64 @@ private:
 
     Array2D residual;
 
-    Array2D solution_exact; //Exact solution at present time step
+    //Limited slopes of MUSCL, u(x,y) = solution(i,j) + slope_x(i,j)*(x-x_i)/dx
+    //+ slope_y(i,j)*(y-y_j)/dy in cell (i,j). Zero for the first order scheme.
+    Array2D slope_x, slope_y;
+    //WENO5 values at the faces x_{i-1/2}, x_{i+1/2}, y_{j-1/2}, y_{j+1/2} of
+    //cell (i,j), see compute_weno5_faces
+    Array2D weno_x_minus, weno_x_plus, weno_y_minus, weno_y_plus;
+
+    Array2D solution_exact; //Exact solution at present time step, only
+                            //computed when it is written
+    vector<double> exact_row; //Exact solution on one row, for the error
 
-    Array2D error;
+    Error_Policy error_policy; //When the error is evaluated
+    Error_Norms final_norms;
+    vector<pair<double,Error_Norms> > error_history; //(t, norms)
 
     int N_x,N_y;
     double dx, dy, dt, t, final_time;
     double cfl;
     string method;
+    string limiter; //none gives the first order scheme
+    Slope_Limiter slope_limiter;
+    bool muscl; //Second order in space, with SSP-RK2 in time
+    bool weno; //limiter = weno5, fifth order in space with SSP-RK3 in time
+    //Strang splitting of the upwind scheme into sweeps of x and y lines,
+    //instead of the unsplit residual
+    bool split;
+    Split_Advection_2d splitting;
     int initial_data_indicator;
     I_Functions initial_function;
+
+    Timer timer; // Time of boundary, reconstruct, residual, update, split,
+                 // error, output phases
 };
 
 Linear_Convection_2d::Linear_Convection_2d(int N_x, int N_y, 
                                            double cfl,
                                            string method,
                                            double final_time, 
-                                           int initial_data_indicator):
+                                           int initial_data_indicator,
+                                           string error_spec,
+                                           string limiter,
+                                           bool split):
+                                           error_policy(error_spec),
                                            N_x(N_x), N_y(N_y), 
                                            final_time(final_time),
                                            cfl(cfl),
                                            method(method),
-                                           initial_data_indicator(initial_data_indicator)
+                                           limiter(limiter),
+                                           slope_limiter(&zero_slope),
+                                           muscl(limiter != "none" &&
+                                                 limiter != "weno5"),
+                                           weno(limiter == "weno5"),
+                                           split(split),
+                                           initial_data_indicator(initial_data_indicator),
+                                           timer("fv2d_var_coeff " + method +
+                                                 (limiter == "none" ? "" :
+                                                  " " + limiter) +
+                                                 (split ? " split" : ""))
 {
     theta = M_PI/4.0;
     xmin = -1.0, xmax = 1.0, ymin = -1.0, ymax = 1.0;
@@ -124,13 +166,46 @@ Linear_Convection_2d::Linear_Convection_2d(int N_x, int N_y,
     cout << "dy = " << dy << endl;
     cout << "cfl = " <<cfl << endl;
     compute_time_step();
-    error.resize(N_x,N_y);
     grid_x.resize(N_x),grid_y.resize(N_y);
+    exact_row.resize(N_x);
     initial_solution.resize(N_x,N_y);
-    solution_old.resize(N_x,N_y,1);
-    solution.resize(N_x,N_y,1);
+    //The stencil of WENO5 needs 3 ghost layers
+    const int n_ghost = weno ? 3 : 1;
+    solution_old.resize(N_x,N_y,n_ghost);
+    solution.resize(N_x,N_y,n_ghost);
     residual.resize(N_x,N_y,1);
+    if (weno == false)
+      slope_limiter = get_slope_limiter(limiter);
+    slope_x.resize(N_x,N_y,1), slope_y.resize(N_x,N_y,1);
+    slope_x = 0.0, slope_y = 0.0;
+    if (weno)
+    {
+      weno_x_minus.resize(N_x,N_y,1), weno_x_plus.resize(N_x,N_y,1);
+      weno_y_minus.resize(N_x,N_y,1), weno_y_plus.resize(N_x,N_y,1);
+    }
     solution_exact.resize(N_x,N_y);
+    if (split)
+    {
+      //Velocities at the faces (i+1/2,j) and (i,j+1/2), as in
+      //compute_residual
+      Array2D u_face(N_x,N_y), v_face(N_x,N_y);
+      for (int j = 0; j < N_y; j++)
+        for (int i = 0; i < N_x; i++)
+        {
+          (*advection_velocity)(xmin+dx+i*dx, ymin+0.5*dy+j*dy, vel);
+          u_face(i,j) = vel[0];
+          (*advection_velocity)(xmin+0.5*dx+i*dx, ymin+dy+j*dy, vel);
+          v_face(i,j) = vel[1];
+        }
+      splitting.set(u_face, v_face, dx, dy, limiter);
+    }
+    timer.add_info("N_x", N_x);
+    timer.add_info("N_y", N_y);
+    timer.add_info("cfl", cfl);
+    timer.add_info("final_time", final_time);
+    timer.add_info("muscl", muscl);
+    timer.add_info("weno", weno);
+    timer.add_info("split", split);
 }
 
 void Linear_Convection_2d::compute_time_step()
@@ -145,8 +220,8 @@ void Linear_Convection_2d::compute_time_step()
       u0max = max(u0max,abs(vel[0])), u1max = max(u1max,abs(vel[1]));
     }
   double c;
-  if (method == "upwind")
-    c = 1.0;
+  if (method == "upwind") //The limited slopes are TVD for half the Courant
+    c = muscl ? 0.5 : 1.0; //number
   else if (method == "lw")
     c = 0.72;
   else 
@@ -156,7 +231,10 @@ void Linear_Convection_2d::compute_time_step()
     assert(false);
   }
   u0max = max(1.0,u0max),u1max=max(1.0,u1max);
-  dt = cfl*c/(u0max/dx+u1max/dy);
+  if (split) //Each sweep is 1D, so only needs its own Courant number
+    dt = cfl*c/max(u0max/dx,u1max/dy);
+  else
+    dt = cfl*c/(u0max/dx+u1max/dy);
   cout << "dt = "<<dt <<endl;
 }
 
@@ -198,15 +276,13 @@ void Linear_Convection_2d::make_grid()
 
 void Linear_Convection_2d::set_initial_solution()
 {
-  double x,y;
-  for (int i = 0; i < N_x; i++)
-    for (int j = 0; j < N_y; j++)
-    {
-      x = (xmin+0.5*dx) + i*dx, y = (ymin+0.5*dy) + j*dy;
-      solution(i,j) = initial_function.value(x,y);
-      initial_solution(i,j) = solution(i,j); //Stored only
-      //for snapshot error
-    }
+  for (int j = 0; j < N_y; j++)
+    initial_function.value_row(N_x,&grid_x[0],grid_y[j],&solution(0,j));
+  //Stored only for snapshot error. Not with operator=, which copies the
+  //ghosts of solution into initial_solution, which has none.
+  for (int j = 0; j < N_y; j++)
+    for (int i = 0; i < N_x; i++)
+      initial_solution(i,j) = solution(i,j);
 }
 
 //dy/dt = res(u) 
@@ -227,14 +303,33 @@ void Linear_Convection_2d::set_initial_solution()
 //the correct place 2) Last and 0th flux are the same, that flux shows up twice
 //with opposite signs and we handle it accordingly.
 
-void Linear_Convection_2d::apply_fvm()
+//With MUSCL, the face values are those of the limited linear reconstruction,
+//Q_l = solution(i,j) + 0.5*slope_x(i,j), Q_r = solution(i+1,j) -
+//0.5*slope_x(i+1,j) at the face (i+1/2,j), with periodic ghost cells. WENO5
+//is the same with the face values of compute_weno5_faces and 3 layers of
+//ghosts.
+void Linear_Convection_2d::compute_residual()
 {
   //double x,y;
   double flux; //flux_x(i+1/2,j), flux_y(i,j+1/2)
   //This loop computes the fluxes and adds them to where they are needed
+  timer.start("boundary");
   solution.update_fluff();
+  timer.stop("boundary");
+  if (muscl) //The last faces use the slopes of the periodic ghost cells
+  {
+    Scoped_Timer reconstruct_timer(timer, "reconstruct");
+    compute_slopes(solution, slope_limiter, slope_x, slope_y);
+    slope_x.update_fluff(), slope_y.update_fluff();
+  }
+  else if (weno)
+  {
+    Scoped_Timer reconstruct_timer(timer, "reconstruct");
+    compute_weno5_faces(solution, weno_x_minus, weno_x_plus,
+                        weno_y_minus, weno_y_plus);
+  }
+  Scoped_Timer residual_timer(timer, "residual");
   residual = 0.0;//For different time integration
-  double lam = dt/(dx*dy);
   //We'd do solution = solution_old - dt/dx * (f_x(i+1/2,j)-f_x(i-1/2,j))
   //                                - dt/dx * (f_y(i,j+1/2)-f_y(i,j-1/2))
 
@@ -250,8 +345,12 @@ void Linear_Convection_2d::apply_fvm()
       double x = (xmin+dx)+i*dx, y = ymin+0.5*dy+j*dy; //Values on face centre
       //(x_{i+1/2},y_j)
       (*advection_velocity)(x,y,vel);
-      const double Q_l = reconstruct(solution(i-1,j),solution(i,j));
-      const double Q_r = reconstruct(solution(i,j),solution(i+1,j));
+      double Q_l, Q_r;
+      if (weno)
+        Q_l = weno_x_plus(i,j), Q_r = weno_x_minus(i+1,j);
+      else
+        Q_l = solution(i,j)   + 0.5*slope_x(i,j),
+        Q_r = solution(i+1,j) - 0.5*slope_x(i+1,j);
       (*update_flux)(1,0,vel,Q_l,Q_r,flux);
       residual(i,j)     += -flux*dy;
       if (i==N_x-1)
@@ -268,8 +367,12 @@ void Linear_Convection_2d::apply_fvm()
       double x = (xmin+0.5*dx)+i*dx, y = (ymin+dy)+j*dy; //Values on face centre.
       //(x_i,y_{j+1/2})
       (*advection_velocity)(x,y,vel);
-      const double Q_l = reconstruct(solution(i-1,j),solution(i,j));
-      const double Q_r = reconstruct(solution(i,j),solution(i,j+1));
+      double Q_l, Q_r;
+      if (weno)
+        Q_l = weno_y_plus(i,j), Q_r = weno_y_minus(i,j+1);
+      else
+        Q_l = solution(i,j)   + 0.5*slope_y(i,j),
+        Q_r = solution(i,j+1) - 0.5*slope_y(i,j+1);
       (*update_flux)(0,1,vel,Q_l,Q_r,flux);
       residual(i,j)     += -flux*dx;
       if (j==N_y-1)
@@ -277,12 +380,59 @@ void Linear_Convection_2d::apply_fvm()
       else
         residual(i,j+1) +=  flux*dx;
     }
+}
 
+//Forward Euler for the first order scheme. With MUSCL, the two stage SSP-RK2
+//  Q^(1) = Q^n + dt*res(Q^n),
+//  Q^(n+1) = (Q^n + Q^(1) + dt*res(Q^(1)))/2
+//and with WENO5 the three stage SSP-RK3
+//  Q^(1) = Q^n + dt*res(Q^n),
+//  Q^(2) = 3/4 Q^n + 1/4 (Q^(1) + dt*res(Q^(1))),
+//  Q^(n+1) = 1/3 Q^n + 2/3 (Q^(2) + dt*res(Q^(2)))
+void Linear_Convection_2d::apply_fvm()
+{
+  double lam = dt/(dx*dy);
+  compute_residual();
+  timer.start("update");
   for (int i = 0; i<N_x; i++)
     for (int j = 0; j<N_y; j++)
     {
       solution(i,j) = solution_old(i,j) + lam*residual(i,j);
     }
+  timer.stop("update");
+  if (muscl)
+  {
+    compute_residual();
+    timer.start("update");
+    for (int i = 0; i<N_x; i++)
+      for (int j = 0; j<N_y; j++)
+      {
+        solution(i,j) = 0.5*(solution_old(i,j) + solution(i,j)
+                             + lam*residual(i,j));
+      }
+    timer.stop("update");
+  }
+  else if (weno)
+  {
+    compute_residual();
+    timer.start("update");
+    for (int i = 0; i<N_x; i++)
+      for (int j = 0; j<N_y; j++)
+      {
+        solution(i,j) = 0.75*solution_old(i,j)
+                        + 0.25*(solution(i,j) + lam*residual(i,j));
+      }
+    timer.stop("update");
+    compute_residual();
+    timer.start("update");
+    for (int i = 0; i<N_x; i++)
+      for (int j = 0; j<N_y; j++)
+      {
+        solution(i,j) = (solution_old(i,j)
+                         + 2.0*(solution(i,j) + lam*residual(i,j)))/3.0;
+      }
+    timer.stop("update");
+  }
 }
 
 void Linear_Convection_2d::apply_lw()
@@ -290,7 +440,10 @@ void Linear_Convection_2d::apply_lw()
   //double x,y;
   double flux; //flux_x(i+1/2,j), flux_y(i,j+1/2)
   //This loop computes the fluxes and adds them to where they are needed
+  timer.start("boundary");
   solution.update_fluff();
+  timer.stop("boundary");
+  timer.start("residual");
   residual = 0.0;//For different time integration
   double lam = dt/(dx*dy);
   //We'd do solution = solution_old - dt/dx * (f_x(i+1/2,j)-f_x(i-1/2,j))
@@ -332,6 +485,8 @@ void Linear_Convection_2d::apply_lw()
       else
         residual(i,j+1) +=  flux*dx;
     }
+  timer.stop("residual");
+  Scoped_Timer update_timer(timer, "update");
   for (int i = 0; i<N_x; i++)
     for (int j = 0; j<N_y; j++)
     {
@@ -342,39 +497,86 @@ void Linear_Convection_2d::apply_lw()
 
 void Linear_Convection_2d::evaluate_error_and_output_solution(int time_step_number,bool output_indicator)
 {
-  double x=0.0,y=0.0;
+  const bool output_now = (output_indicator==true && time_step_number%15==0);
+  const bool final_step = (t >= final_time);
+  if (output_now)
+  {
+    //The exact solution is written along with the solution
+    Scoped_Timer error_timer(timer, "error");
+    advection_velocity(0.0,0.0,vel);
+    const bool constant_indicator = (vel[0]==1.0&&vel[1]==1.0);
+    //Rows of solution_exact are contiguous, so a whole row is done at once.
+    for (int j = 0; j < N_y; j++)
+      initial_function.exact_value_row(N_x,&grid_x[0],grid_y[j],t,vel,
+                                       constant_indicator,
+                                       &solution_exact(0,j));
+  }
+  //The error is kept as norms, but it can be used for reasons other than
+  //outputting, like adaptive grid refinement.
+  if (final_step || error_policy.evaluate(time_step_number))
+  {
+    Scoped_Timer error_timer(timer, "error");
+    Error_Norms norms = compute_error(final_step ||
+                                      !error_policy.is_sampled(),
+                                      output_now);
+    if (final_step)
+      final_norms = norms;
+    error_history.push_back(make_pair(t,norms));
+    timer.count("error_evaluations");
+  }
+  if (output_now)
+  {
+  Scoped_Timer output_timer(timer, "output");
+  vtk_anim_sol(grid_x,grid_y,
+        solution, solution_exact,
+        t, time_step_number/15,
+        "approximate_solution");
+  }
+}
+
+Error_Norms Linear_Convection_2d::compute_error(bool all_cells,
+                                                bool exact_ready)
+{
   bool constant_indicator=false;//This indicates whether the coefficients are 
   //constant or not, to help compute exact solution. We set it to false by 
   //default, it'd be updated to true if next condition is true
-  advection_velocity(x,y,vel);
+  advection_velocity(0.0,0.0,vel);
   if (vel[0]==1.0&&vel[1]==1.0)
     constant_indicator = true;
-  for (int i = 0; i < N_x; i++)
-    for (int j = 0; j < N_y; j++)
+  //vel is only used for constant coefficients, where it is the same at all
+  //points.
+  Error_Accumulator errors;
+  if (all_cells == false)
+  {
+    const vector<pair<int,int> > &cells = error_policy.sample(N_x,N_y);
+    for (unsigned int s = 0; s < cells.size(); s++)
     {
-      x = (xmin+0.5*dx) + i*dx, y = (ymin+0.5*dy) + j*dy;
-      advection_velocity(x,y,vel);
-      solution_exact(i,j) = initial_function.exact_value(x,y,t,vel,constant_indicator);
+      const int i = cells[s].first, j = cells[s].second;
+      errors.add(solution(i,j),
+                 initial_function.exact_value(grid_x[i],grid_y[j],t,vel,
+                                              constant_indicator));
     }
-  if (output_indicator==true && time_step_number%15==0)
-  {
-  vtk_anim_sol(grid_x,grid_y,
-        solution, solution_exact,
-        t, time_step_number/15,
-        "approximate_solution");
+    return errors.norms(true);
   }
-  //There is a separate function for outputting the error. This is because the
-  //error can be used for reasons other than outputting, like adaptive grid
-  //refinement.
-  for (int i = 0; i < N_x; i++)
-    for (int j = 0; j < N_y; j++)
+  //One row at a time, the exact solution is only kept for the row
+  for (int j = 0; j < N_y; j++)
+  {
+    const double *exact = &solution_exact(0,j);
+    if (exact_ready == false)
     {
-      error(i,j) = abs(solution(i,j) - solution_exact(i,j));
+      initial_function.exact_value_row(N_x,&grid_x[0],grid_y[j],t,vel,
+                                       constant_indicator,&exact_row[0]);
+      exact = &exact_row[0];
     }
+    errors.add(N_x,&solution(0,j),exact);
+  }
+  return errors.norms();
 }
 
 void Linear_Convection_2d::run(bool output_indicator)
 {
+  // Everything not in one of the phases, like setting up the grid
+  Scoped_Timer run_timer(timer, "other");
   make_grid();
   int time_step_number = 0;
   //compute_time_step(); Computes dt
@@ -382,7 +584,9 @@ void Linear_Convection_2d::run(bool output_indicator)
   evaluate_error_and_output_solution(time_step_number,output_indicator);
   while (t < final_time) //compute solution at next time step using solution_old
   {
+    timer.start("update");
     solution_old = solution;//update solution_old for next time_step
+    timer.stop("update");
     //At t = 2*pi, exact_solution(x,y,t)=initial_solution(x,y). So, at
     //this t, we would like to compute error as 
     //error(x_i,y_j) = |initial_solution(x_i,y_j)-solution(x_i,y_j)|
@@ -394,9 +598,16 @@ void Linear_Convection_2d::run(bool output_indicator)
       dt = final_time-t;
     if (method == "lw")
       apply_lw();
+    else if (split)
+    {
+      Scoped_Timer split_timer(timer, "split");
+      splitting.advance(solution, dt);
+    }
     else 
       apply_fvm();
     time_step_number += 1;
+    timer.count("time_steps");
+    timer.count("cell_updates", N_x*N_y);
  //Ensure we end at final_time
     t = t + dt;
     evaluate_error_and_output_solution(time_step_number, output_indicator);
@@ -404,34 +615,44 @@ void Linear_Convection_2d::run(bool output_indicator)
   cout << "For N_x = " << N_x<<", N_y = "<<N_y<<", we took ";
   cout << time_step_number << " steps." << endl;
   if (output_indicator)
+  {
     cout <<"We produce output in this refinement level\n";
+    ofstream error_vs_t("error_vs_t.txt");
+    error_vs_t << "# t l1 l2 linfty l1_ci l2_ci, error evaluation "
+               << error_policy.get_spec() << "\n";
+    for (unsigned int e = 0; e < error_history.size(); e++)
+      write_error_line(error_vs_t, error_history[e].first,
+                       error_history[e].second);
+  }
 }
 
 void run_and_output(int N_x, int N_y, double cfl,
                     string method, double final_time,
                     int initial_data_indicator,
-                    unsigned int n_refinements)
+                    unsigned int n_refinements,
+                    string error_spec,
+                    string limiter,
+                    bool split)
 {
   ofstream error_vs_h;
   error_vs_h.open("error_vs_h.txt");
   vector<double> linfty_vector;
   vector<double> l2_vector;
   vector<double> l1_vector;
+  vector<Timer> timers; // Phases of each refinement level
 
   for (unsigned int refinement_level = 0; refinement_level <= n_refinements;
       refinement_level++)
   {
     Linear_Convection_2d solver(N_x, N_y, cfl, method, final_time,
-                                initial_data_indicator);
-    //We calculate time takenṣ in our refinement.
-    struct timeval begin, end; 
-    gettimeofday(&begin, 0);
+                                initial_data_indicator, error_spec,
+                                limiter, split);
     solver.run(refinement_level==n_refinements);//Output only last soln
-    gettimeofday(&end, 0);
-    long seconds = end.tv_sec - begin.tv_sec;
-    long microseconds = end.tv_usec - begin.tv_usec;
-    double elapsed = double(seconds) + double(microseconds) * 1e-6;
+    //We calculate time taken in our refinement.
+    double elapsed = solver.get_timer().total_seconds();
     cout << "Time taken by this refinement level is " << elapsed << " seconds." << endl;
+    solver.get_timer().print();
+    timers.push_back(solver.get_timer());
     solver.get_error(l1_vector,l2_vector,linfty_vector);//push_back resp. error.
     double h = 2.*sqrt(1./(N_x*N_x) +1./(N_y*N_y));
     error_vs_h << h << " " << linfty_vector[refinement_level] << "\n";
@@ -457,6 +678,8 @@ void run_and_output(int N_x, int N_y, double cfl,
     }
     error_vs_h.close();
   }
+  write_json(timers, "timing.json");
+  cout << "Phase timings written to timing.json" << endl;
   cout << "After " << n_refinements << " refinements, l_infty error = ";
   cout << linfty_vector[linfty_vector.size()-1] << endl;
   cout << "The L1 error is " << l1_vector[linfty_vector.size()-1] << endl;
@@ -469,36 +692,24 @@ void Linear_Convection_2d::get_error(vector<double> &l1_vector,
 {
     //Check if initial_state=final_state. If it is, we will discard the 
     //error from exact solution, and compute error using initial_data
-    if (int_tester(final_time/(2.0*M_PI)) == true &&
-        int_tester(final_time/(2.0*M_PI)) == true)
+    Error_Norms norms = final_norms;
+    if (int_tester(final_time/(2.0*M_PI)) == true)
     {
     cout << "final_state=initial_state, so error=|solution - initial_data|\n";
-    for (int i = 0; i < N_x; i++)
-      for (int j = 0; j < N_y; j++)
-        {
-          error(i,j) = abs(solution(i,j) - initial_solution(i,j));
-        }
+    Error_Accumulator errors;
+    for (int j = 0; j < N_y; j++)
+      errors.add(N_x,&solution(0,j),&initial_solution(0,j));
+    norms = errors.norms();
     }
-    double l1,l2,linfty;
-    //Outputting error.
-    for (int j = 0; j < N_y; j++) 
-      for (int i = 0; i < N_x; i++)
-      {
-        l1 += error(i,j)  * dx * dy;                 // L1 error
-        l2 += + error(i,j) * error(i,j)  * dx * dy;  // L2 error
-        linfty = max(linfty, error(i,j));            // L_infty error
-      }
-    double area = N_x*N_y*dx*dy;//dx*dy = area of a cell, N_x*N_y = #cells
-    l1 = l1/area;
-    l2 = sqrt(l2/area);
-    l1_vector.push_back(l1);
-    l2_vector.push_back(l2);
-    linfty_vector.push_back(linfty);
+    //The norms are normalized by the area, l1 = sum |error| dx dy / area
+    l1_vector.push_back(norms.l1);
+    l2_vector.push_back(norms.l2);
+    linfty_vector.push_back(norms.linfty);
 }
 
 int main(int argc, char **argv)
 {
-    if (argc != 6 && argc != 7)
+    if (argc < 6 || argc > 10)
     {
       cout << "Incorrect format, use" << endl;
       cout << "./fv2d_var_coeff method";
@@ -509,25 +720,57 @@ int main(int argc, char **argv)
       cout << "2 - step \n 3 - exp_func_25 \n 4 - exp_func_50\n5 - cts_sine\n";
       cout << "You can add a 'constant' at the end of above to test";
       cout << "constant coefficients case. \n";
-      cout << "Putting 2pi in place of final_time will work.";
+      cout << "Putting 2pi in place of final_time will work.\n";
+      cout << "errors=final, errors=every:k, errors=sample:m or ";
+      cout << "errors=sample:m:k at the end sets when the error is evaluated";
+      cout << " (see include/error_evaluation.h), the default is final.\n";
+      cout << "limiter=minmod, limiter=superbee or limiter=vanleer makes ";
+      cout << "upwind second order (MUSCL with SSP-RK2), limiter=weno5 fifth ";
+      cout << "order (with SSP-RK3), limiter=none (the default) keeps it ";
+      cout << "first order.\n";
+      cout << "split advances upwind with Strang splitting, in sweeps of ";
+      cout << "x and y lines.";
       assert(false);
     }
-    if (argc == 7)
+    string error_spec = "final";
+    string limiter = "none";
+    bool split = false;
+    for (int a = 6; a < argc; a++)
     {
-      if (string(argv[6]) != "constant")
+      string arg = argv[a];
+      if (arg == "constant")
       {
-        cout <<"Last argument must be constant.\n";
-        cout << "You put "<< argv[6] <<endl;
-        assert(false);
+        advection_velocity = &constant_velocity;
+        cout <<"Scheme will be run with constant (u,v)=(1,1)"<<endl;
       }
+      else if (arg.compare(0,7,"errors=") == 0)
+        error_spec = arg.substr(7);
+      else if (arg.compare(0,8,"limiter=") == 0)
+        limiter = arg.substr(8);
+      else if (arg == "split")
+        split = true;
       else
       {
-        advection_velocity = &constant_velocity;
-        cout <<"Scheme will be run with constant (u,v)=(1,1)"<<endl;
+        cout <<"Last arguments must be constant, errors=..., limiter=... ";
+        cout <<"or split\n";
+        cout << "You put "<< arg <<endl;
+        assert(false);
       }
     }
+    cout << "error evaluation = " << error_spec << endl;
     string method = argv[1];
     cout << "method = " << method << endl;
+    cout << "limiter = " << limiter << endl;
+    if (method == "lw" && limiter != "none")
+    {
+      cout << "The limiters are for upwind, lw is already second order"<<endl;
+      assert(false);
+    }
+    if (method == "lw" && split)
+    {
+      cout << "Only upwind can be split, lw has cross derivative terms"<<endl;
+      assert(false);
+    }
     int N_x = 10, N_y = 10;
     double sigma_x = stod(argv[2]);
     cout << "sigma_x = " << sigma_x << endl;
@@ -550,5 +793,6 @@ int main(int argc, char **argv)
       assert(false);
     }
     run_and_output(N_x, N_y, sigma_x, method, final_time,
-                       initial_data_indicator, n_refinements);
+                       initial_data_indicator, n_refinements, error_spec,
+                       limiter, split);
 }
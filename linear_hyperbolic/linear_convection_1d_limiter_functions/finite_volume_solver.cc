@@ -11,7 +11,8 @@ Finite_Volume_Solver_1d::Finite_Volume_Solver_1d(double n_points, double cfl, st
                                            string initial_data_indicator):
                                            n_points(n_points), cfl(cfl),
                                            running_time(running_time), scheme(scheme),
-                                           initial_data_indicator(initial_data_indicator)
+                                           initial_data_indicator(initial_data_indicator),
+                                           timer(scheme)
 {
   coefficient = 1.0;
   sigma = cfl * coefficient / abs(coefficient); //sigma = coefficient*dt/h
@@ -30,6 +31,9 @@ Finite_Volume_Solver_1d::Finite_Volume_Solver_1d(double n_points, double cfl, st
   solution.resize(n_points);
   solution_exact.resize(n_points);
   temp.resize(n_points);
+  timer.add_info("n_points", n_points);
+  timer.add_info("cfl", cfl);
+  timer.add_info("running_time", running_time);
 }
 
 void Finite_Volume_Solver_1d::make_grid()
@@ -61,6 +65,11 @@ void Finite_Volume_Solver_1d::refine()
   solution.resize(n_points);
   solution_exact.resize(n_points);
   temp.resize(n_points);
+  //Each refinement level gets its own timings
+  timer.reset();
+  timer.add_info("n_points", n_points);
+  timer.add_info("cfl", cfl);
+  timer.add_info("running_time", running_time);
 }
 
 void Finite_Volume_Solver_1d::set_initial_solution()
@@ -94,6 +103,7 @@ void Finite_Volume_Solver_1d::lax_wendroff()
 
 void Finite_Volume_Solver_1d::evaluate_error_and_output_solution(int time_step_number)
 {
+    timer.start("error");
     for (unsigned int i = 0; i < n_points; i++)
     {
         solution_exact[i] = initial_data_function.value(grid[i] - coefficient * t);
@@ -103,6 +113,8 @@ void Finite_Volume_Solver_1d::evaluate_error_and_output_solution(int time_step_n
     {
         error[j] = abs(solution[j] - solution_exact[j]);
     }
+    timer.stop("error");
+    Scoped_Timer output_timer(timer, "output");
     string solution_file_name = "solution_";
     solution_file_name += to_string(time_step_number) + ".txt";
     output_vectors_to_file(solution_file_name, grid, solution, solution_exact);
@@ -4,6 +4,7 @@
 #include <cmath>
 #include "initial_conditions.h"
 #include "vector_upgrade.h"
+#include "../../include/timer.h"
 #include <cassert>
 
 using namespace std;
@@ -20,6 +21,7 @@ public:
     void output_final_error();
     void get_error(vector<double> &l1_vector, vector<double> &l2_vector,
                    vector<double> &linfty_vector);
+    const Timer& get_timer() const { return timer; }
 protected:
     void make_grid();
     void set_initial_solution();
@@ -53,4 +55,6 @@ protected:
     string scheme;
     string initial_data_indicator;
     Initial_Data initial_data_function;
+
+    Timer timer; //Time of residual, update, error and output phases
 };
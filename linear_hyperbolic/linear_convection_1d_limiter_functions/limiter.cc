@@ -5,80 +5,17 @@
 #include <cassert>
 #include <string>
 #include <stdio.h>
-#include <sys/time.h>
 #include "finite_volume_solver.h"
 #include "run_and_get_output.h"
+#include "../../include/limiters.h"
+#include "../../include/perf_counters.h"
 using namespace std;
 
 //Recall that f_{j+1/2} = a*u_{j+1/2}^L
 //We roughly have u_{j+1/2}^L = u_j + phi(u_{j-1}-u_j,u_{j+1}-u_j)
-//Where phi is a limiter like minmod, superbee, minmod3
-
-//First we define the limiters phi.
-
-//Roughly, this limiter gives min(abs(back_diff),abs(fwd_diff))
-double minmod(double fwd_diff,double back_diff)
-{
-  if (fwd_diff * back_diff <= 0.0) 
-      return 0.0;
-  else 
-      return min(fwd_diff / back_diff,1.0) * back_diff;
-}
-
-double superbee(double fwd_diff,double back_diff)
-{
-  if (fwd_diff * back_diff <= 0.0) 
-      return 0.0;
-  else 
-      {
-      double r = fwd_diff/back_diff;
-      double temp = max(0.0,min(2.0*r,1.0));
-      return max(temp, min(r,2.0)) * back_diff;
-      }
-}
-
-//back_diff will mean uj - ujm1 for some j. Similar for cent_diff,fwd_diff.
-double minmod3(double back_diff,double cent_diff,double fwd_diff)
-{
-  if ( (back_diff*cent_diff <= 0.0) ||
-        (cent_diff*fwd_diff <= 0.0) )
-      return 0.0;
-  else //s min(|a|,|b|,|c|) where s = sign(a)=sign(b)=sign(c)
-      {
-        double temp = min(abs(back_diff),abs(cent_diff));
-        temp = min(temp,abs(fwd_diff));
-        return (back_diff/abs(back_diff)) * temp;
-      }
-}
-
-//Here, we define the function that uses limiters to compute u_{j-1/2}^L
-//where u_{j-1/2}^L = u_j + phi(...)
-double reconstructor(double ujm2, double ujm1, double uj, string limiter)
-{    
-  if (limiter == "none")
-  {
-    return ujm1 + 0.5*(ujm1-ujm2);
-  }
-  else if (limiter == "minmod")
-  {
-    return ujm1 + 0.5*minmod(uj - ujm1,ujm1 -ujm2);
-  }
-  else if (limiter == "superbee")
-  {
-    return ujm1 + 0.5*superbee(uj-ujm1,ujm1-ujm2);
-  }
-  else if (limiter == "vanleer")
-  {
-    double beta = 2.0;
-    return ujm1 + 0.5 * minmod3(beta*(ujm1-ujm2),
-                                0.5*(uj-ujm2),beta*(uj-ujm1));
-  }
-  else
-  {
-    cout << "Incorrect limiter inputted"<<endl;
-    assert(false);
-  }
-}
+//Where phi is a limiter like minmod, superbee, minmod3. The limiters and the
+//reconstructor using them are in include/limiters.h. With limiter = weno5,
+//u_{j+1/2}^L is the fifth order WENO value of include/limiters.h instead.
 
 class Solver : public Finite_Volume_Solver_1d
 {
@@ -97,18 +34,27 @@ protected:
     void ssp_rk3_solver();
 
     void rhs_soup();
+    void rhs_weno5(); //rhs_function for limiter = weno5
 
     string limiter;
+    //Periodic copy of solution with 2 ghost cells on each side, and the
+    //WENO5 values at the right faces of the cells, for rhs_weno5
+    vector<double> padded, face_plus;
 
     void soup_rk2(); //Second order upwind Scheme
     void soup_rk3();
+
+    Perf_Counters perf; //Hardware counters of rhs_function
 };
 
 Solver::Solver(const double n_points, const double cfl,
                string scheme, const double running_time,
                string initial_data_indicator, string limiter)
                :Finite_Volume_Solver_1d(n_points,cfl,
-               scheme, running_time,initial_data_indicator), limiter(limiter){}
+               scheme, running_time,initial_data_indicator), limiter(limiter)
+{
+  timer.set_name("limiter " + scheme + " " + limiter);
+}
 
 void Solver::make_grid()
 {
@@ -133,6 +79,13 @@ void Solver::foup() //first order upwind scheme
 
 void Solver::rhs_function()
 {
+  if (limiter == "weno5") //Needs 5 cells, so it doesn't use reconstructor
+  {
+    rhs_weno5();
+    return;
+  }
+  Scoped_Timer residual_timer(timer, "residual");
+  perf.start("rhs_function");
   fill((*rhs).begin(),(*rhs).end(),0.0); //Sets (*rhs) vector to zero.
   //There are n_points+1 points on which the flux needs to be evaluated
   //But, the last and first flux are the same, so we'd not evaluate them
@@ -172,6 +125,34 @@ void Solver::rhs_function()
     (*rhs)[j]  +=  flux/h; //rhs[i]  =-(f_{i+1/2}-f_{i-1/2})/h
     (*rhs)[j-1]+= -flux/h; //rhs[i-1]=-(f_{i-1/2}-f_{i-3/2})/h
   }
+  //Per cell, solution is read and rhs is set to zero and updated twice. The
+  //reconstruction, flux and two updates are about 13 flops.
+  perf.stop("rhs_function", 6*8.0*n_points, 13.0*n_points);
+}
+
+//The values u_{j+1/2}^L of all the cells are computed by one vectorized
+//weno5_row, then rhs[j] = -(f_{j+1/2} - f_{j-1/2})/h. The flux is upwind
+//with coefficient > 0, so the values at the left faces are not needed.
+void Solver::rhs_weno5()
+{
+  Scoped_Timer residual_timer(timer, "residual");
+  perf.start("rhs_function");
+  const int n = n_points, ng = 2;
+  padded.resize(n + 2*ng), face_plus.resize(n);
+  copy(solution.begin(), solution.end(), padded.begin() + ng);
+  for (int g = 1; g <= ng; g++)
+  {
+    padded[ng-g]     = solution[n-g];
+    padded[ng+n-1+g] = solution[g-1];
+  }
+  weno5_row(n, &padded[ng], 1, NULL, &face_plus[0]);
+  const double factor = coefficient/h; //f_{j+1/2} = coefficient*u_{j+1/2}^L
+  (*rhs)[0] = -factor*(face_plus[0] - face_plus[n-1]);
+  for (int j = 1; j < n; j++)
+    (*rhs)[j] = -factor*(face_plus[j] - face_plus[j-1]);
+  //Per cell, solution is copied, one face value written and read, and rhs
+  //written. The weno5 is about 50 flops and the flux difference 3.
+  perf.stop("rhs_function", 5*8.0*n_points, 53.0*n_points);
 }
 
 void Solver::ssp_rk3_solver()
@@ -200,12 +181,17 @@ void Solver::ssp_rk2_solver()
 
 void Solver::run()
 {
+    //Everything not in one of the phases, like setting up the grid
+    Scoped_Timer run_timer(timer, "other");
+    perf.reset(); //Counters of this refinement level only
     make_grid();
     set_initial_solution(); //sets solution to be the initial data
     int time_step_number = 0;
     evaluate_error_and_output_solution(time_step_number);
     while (t < running_time) //compute solution at next time step using solution_old
     {
+      //The rhs evaluations are timed separately as residual
+      timer.start("update");
       solution_old = solution;//update solution_old to be used at next time step
       if (scheme == "lw")
         lax_wendroff();
@@ -220,12 +206,16 @@ void Solver::run()
           cout << "Incorrect scheme chosen "<<endl;
           assert(false);
         }
+      timer.stop("update");
+      timer.count("time_steps");
+      timer.count("cell_updates", n_points);
       time_step_number += 1;
       t = t + dt; 
       evaluate_error_and_output_solution(time_step_number);
     }
     cout << "For n_points = " << n_points<<", we took ";
     cout << time_step_number << " steps." << endl;
+    perf.report();
 }
 
 template<typename Pde_Solver>
@@ -237,20 +227,18 @@ void run_and_get_output(double n_points, double max_refinements,
     vector<double> linfty_vector;
     vector<double> l2_vector;
     vector<double> l1_vector;
+    vector<Timer> timers; //Phases of each refinement level
 
     for (unsigned int refinement_level = 0; refinement_level <= max_refinements;
         refinement_level++)
     {
         if (refinement_level>0)
           solver.refine();
-        struct timeval begin, end;
-        gettimeofday(&begin, 0);
         solver.run();
-        gettimeofday(&end, 0);
-        long seconds = end.tv_sec - begin.tv_sec;
-        long microseconds = end.tv_usec - begin.tv_usec;
-        double elapsed = seconds + microseconds * 1e-6;
+        double elapsed = solver.get_timer().total_seconds();
         cout << "Time taken by this iteration is " << elapsed << " seconds." << endl;
+        solver.get_timer().print();
+        timers.push_back(solver.get_timer());
         solver.get_error(l1_vector,l2_vector,linfty_vector);//push_back resp. error.
         error_vs_h << 2.0/n_points << " " << linfty_vector[refinement_level] << "\n";
         n_points = 2.0 * n_points;
@@ -277,6 +265,8 @@ void run_and_get_output(double n_points, double max_refinements,
         if (refinement_level == max_refinements + 1) solver.output_final_error();
     }
     error_vs_h.close();
+    write_json(timers, "timing.json");
+    cout << "Phase timings written to timing.json" << endl;
     cout << "After " << max_refinements << " refinements, l_infty error = ";
     cout << linfty_vector[max_refinements-1] << endl;
     cout << "The L2 error is " << l2_vector[max_refinements-1] << endl;
@@ -294,7 +284,8 @@ int main(int argc, char **argv)
       cout << "Choices for scheme - lw,foup,soup_rk3,soup_rk2 ." << endl;
       cout << "Choices for initial_data - smooth_sine,hat,step,cts_sine . " <<endl;
       cout << "Blank limiter slot would run the scheme without a limiter "<<endl;
-      cout << "Limiter choices are minmod,superbee,vanleer"<<endl;
+      cout << "Limiter choices are minmod,superbee,vanleer and weno5 (fifth ";
+      cout << "order, with soup_rk3)"<<endl;
       assert(false);
   }
   string scheme = argv[1];
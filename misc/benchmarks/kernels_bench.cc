@@ -0,0 +1,503 @@
+// Microbenchmarks of the kernels shared by the solvers: Array2D access
+// patterns, the stencil engine, update_fluff, copies, the vtk writers, the
+// AoS and SoA layouts of MultiArray2D,
+// I_Functions::value (point by point and a row at a time) and the 1D add and
+// limiter kernels.
+//
+// Usage: ./kernels_bench [N] [filter] [csv_file]
+// The 2D kernels work on an N x N array, the 1D kernels on vectors of N*N
+// entries (default N = 1024). Only the benchmarks whose name contains filter
+// are run. With csv_file, one line per benchmark is appended to it.
+//
+// Every benchmark is repeated until it has run for min_sample_time, and this
+// is done n_samples times. The median over the samples is reported as time
+// per cell and as bandwidth, where the bytes are the ones that must be read
+// and written for a cell (e.g. 16 for y(i) = x(i)), not counting write
+// allocate traffic.
+
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+
+#include "../../include/array2d.h"
+#include "../../include/array2d_multi.h"
+#include "../../include/stencil2d.h"
+#include "../../include/vtk_anim.h"
+#include "../../include/initial_conditions.h"
+#include "../../include/limiters.h"
+#include "../../linear_hyperbolic/linear_convection_1d_limiter_functions/vector_upgrade.h"
+
+using namespace std;
+
+const int n_samples = 5;
+const double min_sample_time = 0.05; // seconds
+
+// Results of the kernels are added to this, so that they are not optimized out
+volatile double sink = 0.0;
+
+struct Result
+{
+  string name;
+  double cells;          // Cells done in one call of the kernel
+  double bytes_per_cell; // Bytes read and written per cell
+  double ns_per_cell;    // Median over the samples
+  double min_ns_per_cell, max_ns_per_cell;
+};
+
+// Runs kernel repeatedly and returns the time per call of each sample
+vector<double> time_kernel(const function<void()> &kernel)
+{
+  typedef chrono::steady_clock clock;
+  // Warm up, and find how many calls make up a sample
+  kernel();
+  long calls = 1;
+  while (true)
+  {
+    clock::time_point begin = clock::now();
+    for (long c = 0; c < calls; c++)
+      kernel();
+    double elapsed = chrono::duration<double>(clock::now() - begin).count();
+    if (elapsed >= min_sample_time)
+      break;
+    calls = (elapsed > 0.0) ? max(2*calls, (long)(1.2*calls*min_sample_time
+                                                  /elapsed))
+                            : 2*calls;
+  }
+  vector<double> samples(n_samples);
+  for (int s = 0; s < n_samples; s++)
+  {
+    clock::time_point begin = clock::now();
+    for (long c = 0; c < calls; c++)
+      kernel();
+    samples[s] = chrono::duration<double>(clock::now() - begin).count()/calls;
+  }
+  return samples;
+}
+
+class Benchmarks
+{
+public:
+  Benchmarks(int N, string filter) : N(N), filter(filter) {}
+  void add(string name, double cells, double bytes_per_cell,
+           const function<void()> &kernel);
+  void write_csv(string filename) const;
+  // True if benchmark name passes the filter, for skipping costly setup
+  bool wanted(string name) const { return name.find(filter) != string::npos; }
+private:
+  int N;
+  string filter;
+  vector<Result> results;
+};
+
+void Benchmarks::add(string name, double cells, double bytes_per_cell,
+                     const function<void()> &kernel)
+{
+  if (name.find(filter) == string::npos)
+    return;
+  vector<double> samples = time_kernel(kernel);
+  sort(samples.begin(), samples.end());
+  Result r;
+  r.name           = name;
+  r.cells          = cells;
+  r.bytes_per_cell = bytes_per_cell;
+  r.ns_per_cell     = 1.0e9 * samples[n_samples/2] / cells;
+  r.min_ns_per_cell = 1.0e9 * samples[0] / cells;
+  r.max_ns_per_cell = 1.0e9 * samples[n_samples-1] / cells;
+  results.push_back(r);
+  cout << setw(28) << left << r.name << right
+       << setw(12) << (long)cells
+       << setw(12) << fixed << setprecision(3) << r.ns_per_cell
+       << setw(12) << r.bytes_per_cell / r.ns_per_cell // bytes/ns = GB/s
+       << setw(10) << setprecision(1)
+       << 100.0 * (r.max_ns_per_cell - r.min_ns_per_cell) / r.ns_per_cell
+       << endl;
+  cout.unsetf(ios_base::floatfield);
+}
+
+void Benchmarks::write_csv(string filename) const
+{
+  ifstream exists(filename.c_str());
+  bool write_header = !exists.good();
+  exists.close();
+  ofstream csv(filename.c_str(), ios::app);
+  if (write_header)
+    csv << "benchmark,N,cells,ns_per_cell,min_ns_per_cell,max_ns_per_cell,"
+        << "GB_per_s\n";
+  for (unsigned int b = 0; b < results.size(); b++)
+  {
+    const Result &r = results[b];
+    csv << r.name << "," << N << "," << (long)r.cells << ","
+        << r.ns_per_cell << "," << r.min_ns_per_cell << ","
+        << r.max_ns_per_cell << "," << r.bytes_per_cell / r.ns_per_cell
+        << "\n";
+  }
+  csv.close();
+}
+
+// Kernels on the 4 components of the 2D Euler equations, (rho, rho u, rho v,
+// E), compiled for both layouts of MultiArray2D
+const int n_euler = 4;
+
+// y += alpha x on the interior, with the loop over components outside for SoA
+// (contiguous planes) and inside for AoS (contiguous cells)
+template <Multi_Layout layout>
+void multi_axpy(double alpha, const MultiArray2D<n_euler,layout> &x,
+                MultiArray2D<n_euler,layout> &y)
+{
+  const int nx = x.sizex(), ny = x.sizey();
+  if (layout == layout_soa)
+    for (int v = 0; v < n_euler; v++)
+      for (int j = 0; j < ny; j++)
+        for (int i = 0; i < nx; i++)
+          y(i,j,v) += alpha*x(i,j,v);
+  else
+    for (int j = 0; j < ny; j++)
+      for (int i = 0; i < nx; i++)
+        for (int v = 0; v < n_euler; v++)
+          y(i,j,v) += alpha*x(i,j,v);
+}
+
+// Five point Laplacian of each component, loops as in multi_axpy
+template <Multi_Layout layout>
+void multi_stencil5(const MultiArray2D<n_euler,layout> &x,
+                    MultiArray2D<n_euler,layout> &y)
+{
+  const int nx = x.sizex(), ny = x.sizey();
+  if (layout == layout_soa)
+    for (int v = 0; v < n_euler; v++)
+      for (int j = 0; j < ny; j++)
+        for (int i = 0; i < nx; i++)
+          y(i,j,v) = x(i-1,j,v) + x(i+1,j,v) + x(i,j-1,v) + x(i,j+1,v)
+                     - 4.0*x(i,j,v);
+  else
+    for (int j = 0; j < ny; j++)
+      for (int i = 0; i < nx; i++)
+        for (int v = 0; v < n_euler; v++)
+          y(i,j,v) = x(i-1,j,v) + x(i+1,j,v) + x(i,j-1,v) + x(i,j+1,v)
+                     - 4.0*x(i,j,v);
+}
+
+// Rusanov x flux of the Euler equations at the faces i-1/2, i = 0,...,nx
+// added to the residual of the two cells, the same code for both layouts.
+// Every face needs all components of both cells.
+template <Multi_Layout layout>
+void multi_euler_flux_x(const MultiArray2D<n_euler,layout> &U,
+                        MultiArray2D<n_euler,layout> &res)
+{
+  const double gamma = 1.4;
+  const int nx = U.sizex(), ny = U.sizey();
+  for (int j = 0; j < ny; j++)
+    for (int i = 0; i <= nx; i++)
+    {
+      double F[2][n_euler], lam[2], W[2][n_euler];
+      for (int s = 0; s < 2; s++)
+      {
+        for (int v = 0; v < n_euler; v++)
+          W[s][v] = U(i-1+s,j,v);
+        const double u = W[s][1]/W[s][0], v = W[s][2]/W[s][0];
+        const double p = (gamma - 1.0)*(W[s][3] - 0.5*W[s][0]*(u*u + v*v));
+        F[s][0] = W[s][1];
+        F[s][1] = W[s][1]*u + p;
+        F[s][2] = W[s][2]*u;
+        F[s][3] = (W[s][3] + p)*u;
+        lam[s] = abs(u) + sqrt(gamma*p/W[s][0]);
+      }
+      const double a = max(lam[0], lam[1]);
+      for (int v = 0; v < n_euler; v++)
+      {
+        const double flux = 0.5*(F[0][v] + F[1][v]) - 0.5*a*(W[1][v] - W[0][v]);
+        res(i-1,j,v) -= flux;
+        res(i,j,v) += flux;
+      }
+    }
+}
+
+// The multi_* benchmarks of one layout, named multi_<layout>_<kernel>
+template <Multi_Layout layout>
+void add_multi_benchmarks(Benchmarks &benchmarks, int N, string name)
+{
+  MultiArray2D<n_euler,layout> X(N,N,1), Y(N,N,1);
+  for (int j = -1; j <= N; j++)
+    for (int i = -1; i <= N; i++)
+    {
+      X(i,j,0) = 1.0 + 0.5*sin(0.1*i)*cos(0.1*j);
+      X(i,j,1) = 0.1*X(i,j,0);
+      X(i,j,2) = -0.2*X(i,j,0);
+      X(i,j,3) = 2.5 + 0.1*cos(0.1*i);
+    }
+  Y = 0.0;
+  const double cells2d = double(N)*N;
+  benchmarks.add("multi_" + name + "_axpy", cells2d, 24*n_euler, [&]()
+  {
+    multi_axpy(0.5, X, Y);
+    sink = sink + Y(N/2,N/2,3);
+  });
+  benchmarks.add("multi_" + name + "_stencil5", cells2d, 16*n_euler, [&]()
+  {
+    multi_stencil5(X, Y);
+    sink = sink + Y(N/2,N/2,3);
+  });
+  // U is read once, res read and written
+  benchmarks.add("multi_" + name + "_euler_flux_x", cells2d, 24*n_euler, [&]()
+  {
+    multi_euler_flux_x(X, Y);
+    sink = sink + Y(N/2,N/2,3);
+  });
+  benchmarks.add("multi_" + name + "_update_fluff", 4.0*N+4, 16*n_euler, [&]()
+  {
+    X.update_fluff();
+    sink = sink + X(-1,N/2,0);
+  });
+  // All components in one vtk file, through views without copies
+  const string vtk_write = "multi_" + name + "_vtk_write";
+  if (benchmarks.wanted(vtk_write))
+  {
+    vector<double> grid_x(N), grid_y(N);
+    for (int i = 0; i < N; i++)
+      grid_x[i] = grid_y[i] = -1.0 + (i+0.5)*2.0/N;
+    vector<Array2D_View> fields;
+    for (int v = 0; v < n_euler; v++)
+      fields.push_back(X.component(v));
+    vector<string> names = {"density", "momentum_x", "momentum_y", "energy"};
+    const string vtk_name = "kernels_bench_tmp.vtk";
+    write_rectilinear_grid(grid_x, grid_y, fields, names, 0.0, 0, vtk_name);
+    ifstream f(vtk_name.c_str(), ios::binary | ios::ate);
+    const double bytes = (double)f.tellg();
+    benchmarks.add(vtk_write, cells2d, bytes/cells2d, [&]()
+    {
+      write_rectilinear_grid(grid_x, grid_y, fields, names, 0.0, 0, vtk_name);
+    });
+    remove(vtk_name.c_str());
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int N = 1024;
+  string filter = "", csv_file = "";
+  if (argc > 1)
+    N = stoi(argv[1]);
+  if (argc > 2)
+    filter = argv[2];
+  if (argc > 3)
+    csv_file = argv[3];
+  if (argc > 4 || N < 4)
+  {
+    cout << "Use ./kernels_bench [N] [filter] [csv_file]" << endl;
+    assert(false);
+  }
+  cout << "N = " << N << ", median of " << n_samples << " samples of at least "
+       << min_sample_time << " s" << endl;
+  cout << setw(28) << left << "benchmark" << right << setw(12) << "cells"
+       << setw(12) << "ns/cell" << setw(12) << "GB/s" << setw(10) << "spread%"
+       << endl;
+
+  Benchmarks benchmarks(N, filter);
+  const double cells2d = double(N)*N;
+
+  // Array2D access patterns
+  Array2D A(N,N,1), B(N,N,1);
+  for (int j = 0; j < N; j++)
+    for (int i = 0; i < N; i++)
+      B(i,j) = sin(0.1*i) + cos(0.1*j);
+  // i is the fastest index, so this loop goes through memory contiguously
+  benchmarks.add("array2d_i_inner", cells2d, 16, [&]()
+  {
+    for (int j = 0; j < N; j++)
+      for (int i = 0; i < N; i++)
+        A(i,j) = 2.0*B(i,j);
+    sink = sink + A(N/2,N/2);
+  });
+  // Strided by N+2 doubles, like looping with j inside i in the solvers
+  benchmarks.add("array2d_j_inner", cells2d, 16, [&]()
+  {
+    for (int i = 0; i < N; i++)
+      for (int j = 0; j < N; j++)
+        A(i,j) = 2.0*B(i,j);
+    sink = sink + A(N/2,N/2);
+  });
+  // Five point stencil, each value of B is loaded once if three lines fit
+  // in cache
+  benchmarks.add("array2d_stencil5", cells2d, 16, [&]()
+  {
+    for (int j = 0; j < N; j++)
+      for (int i = 0; i < N; i++)
+        A(i,j) = B(i-1,j) + B(i+1,j) + B(i,j-1) + B(i,j+1) - 4.0*B(i,j);
+    sink = sink + A(N/2,N/2);
+  });
+  // Lax-Wendroff update of fd2d_var, with Array2D::operator() and with the
+  // stencil engine of include/stencil2d.h (ghosts filled in both)
+  const double sigma_x = 0.3, sigma_y = 0.2;
+  benchmarks.add("array2d_lw", cells2d, 16, [&]()
+  {
+    B.update_fluff();
+    for (int j = 0; j < N; j++)
+      for (int i = 0; i < N; i++)
+        A(i,j) = B(i,j)
+                 -0.5*sigma_x*(B(i+1,j)-B(i-1,j))
+                 -0.5*sigma_y*(B(i,j+1)-B(i,j-1))
+                 +0.5*sigma_x*sigma_x*(B(i+1,j)-2.0*B(i,j)+B(i-1,j))
+                 +0.25*sigma_x*sigma_y*(B(i+1,j+1)-B(i+1,j-1)-B(i-1,j+1)
+                                        +B(i-1,j-1))
+                 +0.5*sigma_y*sigma_y*(B(i,j+1)-2.0*B(i,j)+B(i,j-1));
+    sink = sink + A(N/2,N/2);
+  });
+  benchmarks.add("stencil2d_lw", cells2d, 16, [&]()
+  {
+    apply_stencil(B, A, [=](const Stencil_Point &q, int, int)
+    {
+      return q(0,0)
+             -0.5*sigma_x*(q(1,0)-q(-1,0))
+             -0.5*sigma_y*(q(0,1)-q(0,-1))
+             +0.5*sigma_x*sigma_x*(q(1,0)-2.0*q(0,0)+q(-1,0))
+             +0.25*sigma_x*sigma_y*(q(1,1)-q(1,-1)-q(-1,1)+q(-1,-1))
+             +0.5*sigma_y*sigma_y*(q(0,1)-2.0*q(0,0)+q(0,-1));
+    });
+    sink = sink + A(N/2,N/2);
+  });
+  // Read and write one ghost for each of the 2(N+N)+4 ghost cells
+  benchmarks.add("array2d_update_fluff", 4.0*N+4, 16, [&]()
+  {
+    B.update_fluff();
+    sink = sink + B(-1,N/2);
+  });
+  const double cells2d_ghost = (N+2.0)*(N+2.0);
+  benchmarks.add("array2d_copy", cells2d_ghost, 16, [&]()
+  {
+    A = B;
+    sink = sink + A(N/2,N/2);
+  });
+  benchmarks.add("array2d_fill", cells2d_ghost, 8, [&]()
+  {
+    A = 1.0;
+    sink = sink + A(N/2,N/2);
+  });
+
+  // MultiArray2D with 4 components, interleaved and planar
+  add_multi_benchmarks<layout_aos>(benchmarks, N, "aos");
+  add_multi_benchmarks<layout_soa>(benchmarks, N, "soa");
+
+  // vtk writers, the bytes are the size of the file written
+  vector<double> grid_x(N), grid_y(N);
+  for (int i = 0; i < N; i++)
+    grid_x[i] = grid_y[i] = -1.0 + (i+0.5)*2.0/N;
+  string vtk_name = "kernels_bench_tmp";
+  auto file_size = [](string filename)
+  {
+    ifstream f(filename.c_str(), ios::binary | ios::ate);
+    return (double)f.tellg();
+  };
+  if (string("vtk_write_1").find(filter) != string::npos)
+  {
+    write_rectilinear_grid(grid_x, grid_y, B, 0.0, 0, vtk_name + ".vtk");
+    double bytes = file_size(vtk_name + ".vtk");
+    benchmarks.add("vtk_write_1", cells2d, bytes/cells2d, [&]()
+    {
+      write_rectilinear_grid(grid_x, grid_y, B, 0.0, 0, vtk_name + ".vtk");
+    });
+  }
+  if (string("vtk_write_2").find(filter) != string::npos)
+  {
+    write_rectilinear_grid(grid_x, grid_y, A, B, 0.0, 0, vtk_name + ".vtk");
+    double bytes = file_size(vtk_name + ".vtk");
+    benchmarks.add("vtk_write_2", cells2d, bytes/cells2d, [&]()
+    {
+      write_rectilinear_grid(grid_x, grid_y, A, B, 0.0, 0, vtk_name + ".vtk");
+    });
+  }
+  remove((vtk_name + ".vtk").c_str());
+
+  // I_Functions::value for all initial data, writing the values to A
+  string ic_names[6] = {"smooth_sine", "hat", "step", "exp_25", "exp_50",
+                        "cts_sine"};
+  for (int ic = 0; ic < 6; ic++)
+  {
+    I_Functions f(ic, -1.0, 1.0, -1.0, 1.0);
+    const double h = 2.0/N;
+    benchmarks.add("i_functions_" + ic_names[ic], cells2d, 8, [&]()
+    {
+      for (int j = 0; j < N; j++)
+        for (int i = 0; i < N; i++)
+          A(i,j) = f.value(-1.0 + (i+0.5)*h, -1.0 + (j+0.5)*h);
+      sink = sink + A(N/2,N/2);
+    });
+  }
+
+  // The same with the batch API, a row at a time
+  for (int ic = 0; ic < 6; ic++)
+  {
+    I_Functions f(ic, -1.0, 1.0, -1.0, 1.0);
+    benchmarks.add("i_functions_row_" + ic_names[ic], cells2d, 8, [&]()
+    {
+      for (int j = 0; j < N; j++)
+        f.value_row(N, &grid_x[0], grid_y[j], &A(0,j));
+      sink = sink + A(N/2,N/2);
+    });
+  }
+  // Exact solution of the rotating exp_50, as in the error evaluation
+  {
+    I_Functions f(4, -1.0, 1.0, -1.0, 1.0);
+    double u[2] = {0.0, 0.0}, t = 0.3;
+    benchmarks.add("exact_value_point", cells2d, 8, [&]()
+    {
+      for (int j = 0; j < N; j++)
+        for (int i = 0; i < N; i++)
+          A(i,j) = f.exact_value(grid_x[i], grid_y[j], t, u);
+      sink = sink + A(N/2,N/2);
+    });
+    benchmarks.add("exact_value_row", cells2d, 8, [&]()
+    {
+      for (int j = 0; j < N; j++)
+        f.exact_value_row(N, &grid_x[0], grid_y[j], t, u, false, &A(0,j));
+      sink = sink + A(N/2,N/2);
+    });
+  }
+
+  // 1D kernels of the time stepping and reconstruction
+  const int n = N*N;
+  vector<double> x1(n), x2(n), x3(n), y(n);
+  for (int i = 0; i < n; i++)
+  {
+    x1[i] = sin(1.0e-3*i), x2[i] = cos(1.0e-3*i), x3[i] = sin(2.0e-3*i);
+  }
+  benchmarks.add("add_x1_a2x2", n, 24, [&]()
+  {
+    ::add(x1, 0.5, x2, y);
+    sink = sink + y[n/2];
+  });
+  benchmarks.add("add_a1x1_a2x2", n, 24, [&]()
+  {
+    ::add(0.25, x1, 0.5, x2, y);
+    sink = sink + y[n/2];
+  });
+  benchmarks.add("add_x1_a2x2_a3x3", n, 32, [&]()
+  {
+    ::add(x1, 0.5, x2, 0.25, x3, y);
+    sink = sink + y[n/2];
+  });
+  // u_{j-1/2}^L at all faces, as in rhs_function of limiter.cc
+  string limiters[4] = {"none", "minmod", "superbee", "vanleer"};
+  for (int l = 0; l < 4; l++)
+  {
+    string limiter = limiters[l];
+    benchmarks.add("reconstruct_" + limiter, n-2, 16, [&]()
+    {
+      for (int j = 2; j < n; j++)
+        y[j] = reconstructor(x3[j-2], x3[j-1], x3[j], limiter);
+      sink = sink + y[n/2];
+    });
+  }
+
+  if (csv_file != "")
+  {
+    benchmarks.write_csv(csv_file);
+    cout << "Results appended to " << csv_file << endl;
+  }
+}
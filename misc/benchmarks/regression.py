@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+# Performance regression suite of the solvers.
+#
+# Runs a fixed set of configurations, each `repeats` times after a warm up
+# run, and compares the median throughput (cell updates per second) with the
+# one stored in baseline.csv. A configuration fails if its median is more
+# than `threshold` below the baseline, in which case the exit code is 1.
+#
+# Usage: ./regression.py [--repeats 5] [--threshold 0.1] [--filter name]
+#                        [--cpu 0] [--no-build] [--csv results.csv]
+#                        [--update-baseline]
+#
+# The throughput of the serial solvers is cell_updates (or point_updates) of
+# the finest refinement level in timing.json divided by the time of all the
+# phases except "output", so that writing the vtk and text files does not
+# count. For poisson3d it is the lattice updates per second of its bench mode.
+#
+# To make the numbers reproducible, serial runs are pinned to one cpu with
+# taskset and OpenMP to one thread per core (OMP_PROC_BIND=close,
+# OMP_PLACES=cores, OMP_NUM_THREADS=1 unless set). MPI ranks are bound to
+# cores, which is not possible if there are more ranks than cpus, in which
+# case they are oversubscribed and not bound, and this is shown in the
+# table. mpirun can be changed with MPIRUN, e.g.
+#   MPIRUN="mpirun --allow-run-as-root" ./regression.py
+#
+# The baseline is machine dependent. After a change that is known to change
+# the performance, or on a new machine, record it again with
+# --update-baseline and commit baseline.csv.
+
+import argparse
+import csv
+import json
+import os
+import platform
+import shlex
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+
+benchmarks_dir = os.path.dirname(os.path.abspath(__file__))
+repo_dir = os.path.dirname(os.path.dirname(benchmarks_dir))
+baseline_file = os.path.join(benchmarks_dir, "baseline.csv")
+
+# name, directory, program, arguments, MPI ranks (0 for serial programs)
+configs = [
+    ("fv2d_dirichlet_upwind", "linear_hyperbolic/fv2d_dirichlet",
+     "fv2d_dirichlet", ["upwind", "0.9", "1.0", "0", "3"], 0),
+    ("fv2d_dirichlet_lw", "linear_hyperbolic/fv2d_dirichlet",
+     "fv2d_dirichlet", ["lw", "0.9", "1.0", "0", "3"], 0),
+    ("fd2d_var_ct_upwind", "linear_hyperbolic/fd2d_var_coefficients",
+     "fd2d_var", ["ct_upwind", "0.5", "0.25", "0", "1"], 0),
+    ("limiter_minmod",
+     "linear_hyperbolic/linear_convection_1d_limiter_functions",
+     "limiter", ["soup_rk3", "0.5", "1.0", "smooth_sine", "4", "minmod"], 0),
+    ("limiter_superbee",
+     "linear_hyperbolic/linear_convection_1d_limiter_functions",
+     "limiter", ["soup_rk3", "0.5", "1.0", "smooth_sine", "4", "superbee"],
+     0),
+    ("heat1d_rk4", "misc/heat1d",
+     "heat1d", ["rk4", "0.4", "0.1", "5e-2"], 0),
+    ("poisson3d_1", "parallel",
+     "poisson3d", ["plain", "N=64", "itermax=200"], 1),
+    ("poisson3d_2", "parallel",
+     "poisson3d", ["plain", "N=64", "itermax=200", "procs=2x1x1"], 2),
+    ("poisson3d_4", "parallel",
+     "poisson3d", ["plain", "N=64", "itermax=200", "procs=2x2x1"], 4),
+]
+
+
+def build(directory, program):
+    result = subprocess.run(["make", "-s", "-C",
+                             os.path.join(repo_dir, directory), program],
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                            universal_newlines=True)
+    if result.returncode != 0:
+        print(result.stdout)
+        sys.exit("Building " + program + " failed")
+
+
+def command(directory, program, args, ranks, cpu):
+    """Command line of one run and whether it is pinned"""
+    exe = os.path.join(repo_dir, directory, program)
+    if ranks == 0:
+        if shutil.which("taskset") is None:
+            return [exe] + args, False
+        return ["taskset", "-c", str(cpu), exe] + args, True
+    mpirun = shlex.split(os.environ.get("MPIRUN", "mpirun"))
+    if ranks <= os.cpu_count():
+        binding = ["--bind-to", "core", "--map-by", "core"]
+    else:
+        binding = ["--oversubscribe", "--bind-to", "none"]
+    return mpirun + ["-np", str(ranks)] + binding + [exe] + args \
+        + ["bench=bench.csv"], ranks <= os.cpu_count()
+
+
+def cells_per_second(run_dir, ranks):
+    if ranks > 0:
+        with open(os.path.join(run_dir, "bench.csv")) as f:
+            return 1.0e6 * float(list(csv.DictReader(f))[-1]["mlups"])
+    with open(os.path.join(run_dir, "timing.json")) as f:
+        run = json.load(f)["runs"][-1]  # The finest refinement level
+    counters = run["counters"]
+    updates = counters.get("cell_updates", counters.get("point_updates"))
+    output_ns = run["phases"].get("output", {"ns": 0})["ns"]
+    return 1.0e9 * updates / (run["total_ns"] - output_ns)
+
+
+def run_config(config, repeats, warmup, cpu):
+    """Throughput of each of the repeats"""
+    name, directory, program, args, ranks = config
+    cmd, pinned = command(directory, program, args, ranks, cpu)
+    env = dict(os.environ)
+    env.setdefault("OMP_NUM_THREADS", "1")
+    env["OMP_PROC_BIND"] = "close"
+    env["OMP_PLACES"] = "cores"
+    samples = []
+    for r in range(warmup + repeats):
+        # The solvers write their output to the working directory
+        run_dir = tempfile.mkdtemp(prefix="regression_" + name + "_")
+        try:
+            result = subprocess.run(cmd, cwd=run_dir, env=env,
+                                    stdout=subprocess.PIPE,
+                                    stderr=subprocess.STDOUT,
+                                    universal_newlines=True)
+            if result.returncode != 0:
+                print(result.stdout[-2000:])
+                sys.exit(name + " failed: " + " ".join(cmd))
+            if r >= warmup:
+                samples.append(cells_per_second(run_dir, ranks))
+        finally:
+            shutil.rmtree(run_dir)
+    return samples, pinned
+
+
+def median_and_iqr(samples):
+    if len(samples) < 2:
+        return samples[0], 0.0
+    q1, q2, q3 = statistics.quantiles(samples, n=4, method="inclusive")
+    return q2, q3 - q1
+
+
+def read_baseline():
+    baseline = {}
+    if not os.path.exists(baseline_file):
+        return baseline
+    with open(baseline_file) as f:
+        lines = [line for line in f if not line.startswith("#")]
+    for row in csv.DictReader(lines):
+        baseline[row["config"]] = row
+    return baseline
+
+
+def cpu_model():
+    if os.path.exists("/proc/cpuinfo"):
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    return line.split(":", 1)[1].strip()
+    return platform.processor()
+
+
+def write_csv(filename, results, comment=""):
+    with open(filename, "w") as f:
+        if comment != "":
+            f.write("# " + comment + "\n")
+        f.write("config,median_cells_per_s,iqr_cells_per_s,repeats,pinned\n")
+        for name, median, iqr, repeats, pinned in results:
+            f.write("%s,%.6e,%.6e,%d,%d\n"
+                    % (name, median, iqr, repeats, pinned))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Performance regression suite of the solvers")
+    parser.add_argument("--repeats", type=int, default=5)
+    parser.add_argument("--warmup", type=int, default=1)
+    parser.add_argument("--threshold", type=float, default=0.1,
+                        help="allowed relative drop of the median")
+    parser.add_argument("--filter", default="",
+                        help="only configurations whose name contains this")
+    parser.add_argument("--cpu", type=int, default=0,
+                        help="cpu to which serial runs are pinned")
+    parser.add_argument("--no-build", action="store_true")
+    parser.add_argument("--csv", default="", help="also write results here")
+    parser.add_argument("--update-baseline", action="store_true")
+    options = parser.parse_args()
+    if options.repeats < 1 or options.warmup < 0:
+        sys.exit("Need --repeats >= 1 and --warmup >= 0")
+
+    selected = [c for c in configs if options.filter in c[0]]
+    if not options.no_build:
+        for program in sorted(set((c[1], c[2]) for c in selected)):
+            build(*program)
+
+    baseline = read_baseline()
+    print("Median of %d runs, pinned to cpu %d, threshold %.0f%%"
+          % (options.repeats, options.cpu, 100.0 * options.threshold))
+    print("%-24s %14s %8s %14s %9s %7s %s"
+          % ("config", "Mcells/s", "IQR%", "baseline", "change%", "pinned",
+             "status"))
+    results = []
+    failed = []
+    for config in selected:
+        name = config[0]
+        samples, pinned = run_config(config, options.repeats,
+                                     options.warmup, options.cpu)
+        median, iqr = median_and_iqr(samples)
+        results.append((name, median, iqr, len(samples), pinned))
+        if name in baseline:
+            base = float(baseline[name]["median_cells_per_s"])
+            change = median / base - 1.0
+            status = "ok"
+            if change < -options.threshold:
+                status = "FAIL"
+                failed.append(name)
+            # The runs themselves vary more than the threshold
+            if iqr > options.threshold * median:
+                status += " (noisy)"
+            print("%-24s %14.3f %8.1f %14.3f %9.1f %7s %s"
+                  % (name, 1.0e-6 * median, 100.0 * iqr / median,
+                     1.0e-6 * base, 100.0 * change,
+                     "yes" if pinned else "no", status))
+        else:
+            print("%-24s %14.3f %8.1f %14s %9s %7s %s"
+                  % (name, 1.0e-6 * median, 100.0 * iqr / median, "-", "-",
+                     "yes" if pinned else "no", "no baseline"))
+        sys.stdout.flush()
+
+    if options.csv != "":
+        write_csv(options.csv, results)
+    if options.update_baseline:
+        # Keep the configurations which were not run this time
+        names = [r[0] for r in results]
+        for name, row in baseline.items():
+            if name not in names:
+                results.append((name, float(row["median_cells_per_s"]),
+                                float(row["iqr_cells_per_s"]),
+                                int(row["repeats"]), int(row["pinned"])))
+        results.sort(key=lambda r: [c[0] for c in configs].index(r[0])
+                     if r[0] in [c[0] for c in configs] else len(configs))
+        write_csv(baseline_file, results, "Recorded on " + platform.node()
+                  + " (" + cpu_model() + ", "
+                  + str(os.cpu_count()) + " cpus) with --repeats "
+                  + str(options.repeats))
+        print("Baseline written to " + baseline_file)
+        return 0
+    if len(failed) > 0:
+        print("Throughput dropped by more than %.0f%% in: %s"
+              % (100.0 * options.threshold, ", ".join(failed)))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
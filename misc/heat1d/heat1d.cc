@@ -9,11 +9,13 @@
 #include <cassert>
 #include <string>
 #include <stdio.h>
-#include <sys/time.h>
 
 #include <algorithm>
 #include <functional> //Used to define addition of vectors
 
+#include "../../include/timer.h"
+#include "../../include/spectral.h"
+
 using namespace std;
 
 double max_element(vector<double> &v)
@@ -54,6 +56,7 @@ public:
 
     double get_l2_error() { return l2_error; }
     double get_linfty_error() { return linfty_error; }
+    const Timer& get_timer() const { return timer; }
 
 private:
     void make_grid(); // Grid is needed for writing output, and defining exact solution.
@@ -67,6 +70,7 @@ private:
     void rk3_solver();
     void rk2_solver();
     void ftcs();                                                   //Gives the solutions at next time step using Lax-Wendroff
+    void spectral_update(int time_step_number); //Exact solution of the PDE for the sampled initial data at time_step_number*dt
     void rhs_function(const vector<double> &u, vector<double> &k); //This gives RHS of the system of ODEs
 
     void evaluate_error_and_output_solution(const int time_step_number);
@@ -98,14 +102,22 @@ private:
     //slopes needed by rk4
     vector<double> k1, k2, k3, k4;
 
+    //The zero boundary values are those of the odd extension to [0,2] with
+    //period 2, so the solution is a sine series, evolved exactly in Fourier
+    //space by spectral from the 2*(n_points-1) values of the extension.
+    Spectral_Solver spectral;
+    vector<double> extended;
+
     //This computes solution_new = u^{n+1} = u^n + dt/6 * (k1 + 2.0*k2 + 2.0*k3 + k4)
     void compute_solution_new_using_ki(int);
 
     string method;
     int initial_data_indicator; //Kept in case we want to add multiple initial datas
+
+    Timer timer; //Time of residual, update, error and output phases
 };
 
-Heat1d::Heat1d(double n_points, double cfl, string method, double running_time, int initial_data_indicator) : n_points(n_points), cfl(cfl), running_time(running_time), method(method), initial_data_indicator(initial_data_indicator)
+Heat1d::Heat1d(double n_points, double cfl, string method, double running_time, int initial_data_indicator) : n_points(n_points), cfl(cfl), running_time(running_time), method(method), initial_data_indicator(initial_data_indicator), timer("heat1d " + method)
 {
     h = (x_max - x_min) / (n_points- 1);
     dt = cfl * h * h / coefficient;
@@ -122,6 +134,14 @@ Heat1d::Heat1d(double n_points, double cfl, string method, double running_time,
     k2.resize(n_points);
     k3.resize(n_points);
     k4.resize(n_points);
+    if (method == "spectral")
+    {
+        spectral = Spectral_Solver(2 * (n_points - 1), 1, 2.0 * (x_max - x_min), 1.0, 0.0, 0.0, coefficient);
+        extended.resize(2 * (n_points - 1));
+    }
+    timer.add_info("n_points", n_points);
+    timer.add_info("cfl", cfl);
+    timer.add_info("running_time", running_time);
 };
 
 void Heat1d::make_grid()
@@ -149,6 +169,7 @@ void Heat1d::rhs_function(const vector<double> &u, vector<double> &k)
                   << ". Both the sizes should equal " << solution_old.size() << endl;
         assert(false);
     }
+    Scoped_Timer residual_timer(timer, "residual");
     k[0] = (u[n_points - 2] - 2 * u[0] + u[1]) / (h * h); //left end point
     for (int j = 1; j < n_points - 1; j++)
     {
@@ -197,6 +218,16 @@ void Heat1d::ftcs()
     solution_new[n_points - 1] = 0.0;
 };
 
+//Any number of steps in one inverse transform, with no restriction on cfl
+void Heat1d::spectral_update(int time_step_number)
+{
+    spectral.evaluate(time_step_number * dt, &extended[0], 0);
+    for (int i = 0; i < n_points; i++)
+        solution_new[i] = extended[i];
+    solution_new[0] = 0.0;
+    solution_new[n_points - 1] = 0.0;
+}
+
 //This computes solution_new = u^{n+1} = u^n + dt/6 * (k1 + 2.0*k2 + 2.0*k3 + k4)
 void Heat1d::compute_solution_new_using_ki(int order)
 {
@@ -281,6 +312,7 @@ void Heat1d::rk2_solver()
 
 void Heat1d::evaluate_error_and_output_solution(int time_step_number)
 {
+    timer.start("error");
     if (time_step_number == 0)
         solution_exact = initial_data;
     else
@@ -294,6 +326,8 @@ void Heat1d::evaluate_error_and_output_solution(int time_step_number)
     {
         error[j] = max(error[j], abs(solution_old[j] - solution_exact[j])); //error at a particular time step is useless.
     }
+    timer.stop("error");
+    Scoped_Timer output_timer(timer, "output");
     string solution_file_name = "solution_";
     solution_file_name += to_string(time_step_number) + "_" + method + ".txt";
     output_vectors_to_file(solution_file_name, grid, solution_old, solution_exact);
@@ -308,14 +342,28 @@ void Heat1d::output_final_error()
 
 void Heat1d::run()
 {
+    //Everything not in one of the phases, like setting up the grid
+    Scoped_Timer run_timer(timer, "other");
     make_grid();
     set_initial_data();
     solution_old = initial_data;
+    if (method == "spectral")
+    {
+        //u(2-x) = -u(x)
+        for (int i = 0; i < n_points - 1; i++)
+        {
+            extended[i] = initial_data[i];
+            extended[n_points - 1 + i] = -initial_data[n_points - 1 - i];
+        }
+        spectral.set_initial_data(&extended[0], 0);
+    }
     int time_step_number = 0;
     evaluate_error_and_output_solution(time_step_number);
     while (time_step_number * dt < running_time)
     {
         time_step_number += 1;
+        //The rhs evaluations are timed separately as residual
+        timer.start("update");
         if (method == "rk4")
             rk4_solver();
         else if (method == "rk3")
@@ -324,9 +372,14 @@ void Heat1d::run()
             rk2_solver();
         else if (method == "ftcs")
             ftcs();
+        else if (method == "spectral")
+            spectral_update(time_step_number);
         else
             assert(false);
         solution_old = solution_new;
+        timer.stop("update");
+        timer.count("time_steps");
+        timer.count("point_updates", n_points);
         evaluate_error_and_output_solution(time_step_number);
     }
     cout << "In this iteration, we made " << time_step_number << " steps." << endl;
@@ -340,6 +393,7 @@ void run_and_get_output(double n_points, double cfl, string method, double runni
     error_vs_h.open("error_vs_h.txt");
     Heat1d solver(n_points, cfl, method, running_time, initial_data_indicator);
     solver.run();
+    vector<Timer> timers(1, solver.get_timer()); //Phases of each iteration
     vector<double> linfty_vector(1);
     vector<double> l2_vector(1);
     double iteration_number = 0.0;
@@ -361,16 +415,15 @@ void run_and_get_output(double n_points, double cfl, string method, double runni
             std::cout << "Rate of L2 convergence checked at iteration number " << iteration_number;
             std::cout << " is " << abs(log(l2_vector[iteration_number] / l2_vector[iteration_number - 1])) / log(2.0) << endl;
         }
-        struct timeval begin, end;
-        gettimeofday(&begin, 0);
         solver.run();
-        gettimeofday(&end, 0);
-        long seconds = end.tv_sec - begin.tv_sec;
-        long microseconds = end.tv_usec - begin.tv_usec;
-        double elapsed = seconds + microseconds * 1e-6;
+        double elapsed = solver.get_timer().total_seconds();
         cout << "Time taken by this iteration is " << elapsed << " seconds." << endl;
+        solver.get_timer().print();
+        timers.push_back(solver.get_timer());
     }
     error_vs_h.close();
+    write_json(timers, "timing.json");
+    cout << "Phase timings written to timing.json" << endl;
     solver.output_final_error();
     cout << "It took " << iteration_number << " iterations to get the Linfty error below " << tolerance << " and precisely at " << linfty_vector[iteration_number] << endl;
     cout << "The L2 error is " << l2_vector[iteration_number] << endl
@@ -392,7 +445,7 @@ int main(int argc, char **argv)
     if (argc != 5)
     {
         std::cout << "Incorrect arguments. Kindly give the arguments in the following format. " << endl;
-        std::cout << "./output ftcs/rk4/rk3/rk2(for the respective method) cfl running_time error_tolerance" << endl;
+        std::cout << "./output ftcs/rk4/rk3/rk2/spectral(for the respective method) cfl running_time error_tolerance" << endl;
         assert(false);
     }
     string method = argv[1];
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cassert>
+#include "euler_solver_1d.h"
+#include "exact_riemann.h"
+#include "../../include/timer.h"
+
+using namespace std;
+
+const string exact_dir = "../../hyperbolic_systems/ToroExact/output/";
+
+template <class Numerical_Flux>
+Timer run_test(const Shock_Tube &problem, int n_cells, double cfl,
+               int rk_order, bool muscl, string flux)
+{
+  Euler_Solver_1d<Numerical_Flux> solver(n_cells, cfl, rk_order, muscl, 1.4,
+                                         problem);
+  solver.run();
+  solver.write_solution(problem.name + "_" + flux + ".dat");
+  Timer timer = solver.get_timer();
+  timer.set_name("euler_1d " + problem.name + " " + flux);
+  double errors[3];
+  cout << problem.name << ": " << solver.n_steps() << " steps";
+  if (solver.get_error(exact_dir + problem.name + "_exact.dat", errors))
+  {
+    cout << ", L1 error dens " << errors[0] << " velx " << errors[1]
+         << " pres " << errors[2];
+    timer.add_info("L1_error_dens", errors[0]);
+  }
+  else
+    cout << ", no exact solution in " << exact_dir;
+  cout << ", " << 1e9*timer.total_seconds()/timer.counter("cell_updates")
+       << " ns per cell update"
+       << endl;
+  return timer;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 5)
+  {
+    cout << "Usage: ./euler_1d flux n_cells cfl test [rk=3] [muscl]\n"
+         << "  flux = rusanov, hll, roe or godunov, test = 1,...,7 or all"
+         << endl;
+    return 1;
+  }
+  const string flux = argv[1];
+  const int n_cells = atoi(argv[2]);
+  const double cfl = atof(argv[3]);
+  const string test = argv[4];
+  int rk_order = 3;
+  bool muscl = false;
+  for (int a = 5; a < argc; a++)
+  {
+    const string arg = argv[a];
+    if (arg.compare(0, 3, "rk=") == 0)
+      rk_order = atoi(arg.c_str() + 3);
+    else if (arg == "muscl")
+      muscl = true;
+    else
+    {
+      cout << "Unknown argument " << arg << endl;
+      assert(false);
+    }
+  }
+
+  vector<Shock_Tube> problems;
+  if (test == "all")
+    problems.assign(toro_tests, toro_tests + 7);
+  else
+  {
+    const int k = atoi(test.c_str());
+    if (k < 1 || k > 7)
+    {
+      cout << "There are Toro tests 1 to 7, not " << test << endl;
+      assert(false);
+    }
+    problems.push_back(toro_tests[k-1]);
+  }
+
+  vector<Timer> timers;
+  for (unsigned int k = 0; k < problems.size(); k++)
+  {
+    if (flux == "rusanov")
+      timers.push_back(run_test<Rusanov_Flux>(problems[k], n_cells, cfl,
+                                              rk_order, muscl, flux));
+    else if (flux == "hll")
+      timers.push_back(run_test<HLL_Flux>(problems[k], n_cells, cfl,
+                                          rk_order, muscl, flux));
+    else if (flux == "roe")
+      timers.push_back(run_test<Roe_Flux>(problems[k], n_cells, cfl,
+                                          rk_order, muscl, flux));
+    else if (flux == "godunov")
+      timers.push_back(run_test<Godunov_Flux>(problems[k], n_cells, cfl,
+                                              rk_order, muscl, flux));
+    else
+    {
+      cout << "Unknown flux " << flux << endl;
+      assert(false);
+    }
+  }
+  for (unsigned int k = 0; k < timers.size(); k++)
+    timers[k].print();
+  write_json(timers, "timing.json");
+  return 0;
+}
@@ -0,0 +1,140 @@
+#ifndef __EULER_FLUXES_H__
+#define __EULER_FLUXES_H__
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+// Numerical fluxes of the 1D Euler equations
+//   U_t + F(U)_x = 0, U = (rho, rho u, E), F = (rho u, p + rho u^2, (E+p) u)
+// with p = (gamma-1)(E - rho u^2/2), as in hyperbolic_systems/EqEuler.jl.
+//
+// They are functors with the states as scalars, so that the solver can load
+// them from separate arrays of rho, rho u, E and the flux is inlined into its
+// loop over faces, with no temporary vectors.
+//   Numerical_Flux numerical_flux(gamma);
+//   numerical_flux(rho_l, mom_l, E_l, rho_r, mom_r, E_r, F);
+
+inline double euler_pressure(double gamma, double rho, double mom, double E)
+{
+  return (gamma - 1.0)*(E - 0.5*mom*mom/rho);
+}
+
+// Physical flux F(U), with p = euler_pressure(...)
+inline void euler_flux(double rho, double mom, double E, double p, double F[3])
+{
+  const double u = mom/rho;
+  F[0] = mom;
+  F[1] = p + mom*u;
+  F[2] = (E + p)*u;
+}
+
+// Local Lax-Friedrichs, with the largest |u| + c of the two states
+class Rusanov_Flux
+{
+public:
+  Rusanov_Flux(double gamma) : gamma(gamma) {}
+  void operator()(double rho_l, double mom_l, double E_l,
+                  double rho_r, double mom_r, double E_r, double F[3]) const
+  {
+    const double p_l = euler_pressure(gamma, rho_l, mom_l, E_l);
+    const double p_r = euler_pressure(gamma, rho_r, mom_r, E_r);
+    const double lam = max(abs(mom_l/rho_l) + sqrt(gamma*p_l/rho_l),
+                           abs(mom_r/rho_r) + sqrt(gamma*p_r/rho_r));
+    double F_l[3], F_r[3];
+    euler_flux(rho_l, mom_l, E_l, p_l, F_l);
+    euler_flux(rho_r, mom_r, E_r, p_r, F_r);
+    F[0] = 0.5*(F_l[0] + F_r[0]) - 0.5*lam*(rho_r - rho_l);
+    F[1] = 0.5*(F_l[1] + F_r[1]) - 0.5*lam*(mom_r - mom_l);
+    F[2] = 0.5*(F_l[2] + F_r[2]) - 0.5*lam*(E_r - E_l);
+  }
+  const double gamma;
+};
+
+// Roe averages of the velocity, enthalpy and sound speed
+inline void roe_average(double gamma, double rho_l, double u_l, double H_l,
+                        double rho_r, double u_r, double H_r,
+                        double &u, double &H, double &c)
+{
+  const double s_l = sqrt(rho_l), s_r = sqrt(rho_r);
+  u = (s_l*u_l + s_r*u_r)/(s_l + s_r);
+  H = (s_l*H_l + s_r*H_r)/(s_l + s_r);
+  c = sqrt((gamma - 1.0)*(H - 0.5*u*u));
+}
+
+// HLL with the wave speeds of Einfeldt, S_l = min(u_l - c_l, u - c),
+// S_r = max(u_r + c_r, u + c) with the Roe averages u, c
+class HLL_Flux
+{
+public:
+  HLL_Flux(double gamma) : gamma(gamma) {}
+  void operator()(double rho_l, double mom_l, double E_l,
+                  double rho_r, double mom_r, double E_r, double F[3]) const
+  {
+    const double u_l = mom_l/rho_l, u_r = mom_r/rho_r;
+    const double p_l = euler_pressure(gamma, rho_l, mom_l, E_l);
+    const double p_r = euler_pressure(gamma, rho_r, mom_r, E_r);
+    double u, H, c;
+    roe_average(gamma, rho_l, u_l, (E_l + p_l)/rho_l,
+                rho_r, u_r, (E_r + p_r)/rho_r, u, H, c);
+    // With S_l <= 0 <= S_r clipped to 0, the HLL formula is also the upwind
+    // flux F_l or F_r of supersonic faces, so there are no branches
+    const double S_l = min(0.0, min(u_l - sqrt(gamma*p_l/rho_l), u - c));
+    const double S_r = max(0.0, max(u_r + sqrt(gamma*p_r/rho_r), u + c));
+    const double r = 1.0/(S_r - S_l);
+    double F_l[3], F_r[3];
+    euler_flux(rho_l, mom_l, E_l, p_l, F_l);
+    euler_flux(rho_r, mom_r, E_r, p_r, F_r);
+    F[0] = (S_r*F_l[0] - S_l*F_r[0] + S_l*S_r*(rho_r - rho_l))*r;
+    F[1] = (S_r*F_l[1] - S_l*F_r[1] + S_l*S_r*(mom_r - mom_l))*r;
+    F[2] = (S_r*F_l[2] - S_l*F_r[2] + S_l*S_r*(E_r - E_l))*r;
+  }
+  const double gamma;
+};
+
+// Roe, with Harten's entropy fix, |lambda| < 2 delta is replaced by
+// lambda^2/(4 delta) + delta with delta = 0.2 c
+class Roe_Flux
+{
+public:
+  Roe_Flux(double gamma) : gamma(gamma) {}
+  static double entropy_fix(double lam, double delta)
+  {
+    lam = abs(lam);
+    // Both sides are computed, so the select has no branch
+    const double fixed = lam*lam/(4.0*delta) + delta;
+    return (lam < 2.0*delta) ? fixed : lam;
+  }
+  void operator()(double rho_l, double mom_l, double E_l,
+                  double rho_r, double mom_r, double E_r, double F[3]) const
+  {
+    const double u_l = mom_l/rho_l, u_r = mom_r/rho_r;
+    const double p_l = euler_pressure(gamma, rho_l, mom_l, E_l);
+    const double p_r = euler_pressure(gamma, rho_r, mom_r, E_r);
+    double u, H, c;
+    roe_average(gamma, rho_l, u_l, (E_l + p_l)/rho_l,
+                rho_r, u_r, (E_r + p_r)/rho_r, u, H, c);
+    // Jump in U in the eigenvectors r1 = (1, u-c, H-uc), r2 = (1, u, u^2/2),
+    // r3 = (1, u+c, H+uc)
+    const double d0 = rho_r - rho_l, d1 = mom_r - mom_l, d2 = E_r - E_l;
+    const double a2 = (gamma - 1.0)/(c*c)*((H - u*u)*d0 + u*d1 - d2);
+    const double a1 = 0.5/c*((u + c)*d0 - d1 - c*a2);
+    const double a3 = d0 - a1 - a2;
+    const double delta = 0.2*c;
+    const double l1 = a1*entropy_fix(u - c, delta);
+    const double l2 = a2*entropy_fix(u, delta);
+    const double l3 = a3*entropy_fix(u + c, delta);
+    double F_l[3], F_r[3];
+    euler_flux(rho_l, mom_l, E_l, p_l, F_l);
+    euler_flux(rho_r, mom_r, E_r, p_r, F_r);
+    F[0] = 0.5*(F_l[0] + F_r[0]) - 0.5*(l1 + l2 + l3);
+    F[1] = 0.5*(F_l[1] + F_r[1])
+           - 0.5*(l1*(u - c) + l2*u + l3*(u + c));
+    F[2] = 0.5*(F_l[2] + F_r[2])
+           - 0.5*(l1*(H - u*c) + l2*0.5*u*u + l3*(H + u*c));
+  }
+  const double gamma;
+};
+
+#endif
@@ -0,0 +1,283 @@
+#ifndef __EULER_SOLVER_1D_H__
+#define __EULER_SOLVER_1D_H__
+
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <string>
+#include <cassert>
+#include "euler_fluxes.h"
+#include "shock_tube.h"
+#include "../../include/limiters.h"
+#include "../../include/timer.h"
+
+using namespace std;
+
+// Finite volume solver of the 1D Euler equations, the counterpart of
+// Finite_Volume_Solver_1d for a system. rho, rho u and E are kept in
+// separate arrays (structure of arrays) with 2 ghost cells on each side, so
+// that the loops over faces and cells go through contiguous values.
+//
+// The numerical flux is a functor of euler_fluxes.h, given as a template
+// parameter so that it is inlined into the loop over faces. The reconstruction
+// is first order, or MUSCL with the minmod limiter of include/limiters.h on
+// the primitive variables, and the time stepping is SSP-RK of order 1, 2 or 3
+// (Shu-Osher form). The boundaries are transmissive.
+template <class Numerical_Flux>
+class Euler_Solver_1d
+{
+public:
+  Euler_Solver_1d(int n_cells, double cfl, int rk_order, bool muscl,
+                  double gamma, const Shock_Tube &problem);
+  void run();
+  // Columns x, density, pressure, velocity, internal energy, sound speed, as
+  // in the toro_*_exact.dat files
+  void write_solution(string filename) const;
+  // L1 errors of density, velocity and pressure at the points of the exact
+  // solution in filename, a toro_*_exact.dat file. False if it can't be read.
+  bool get_error(string filename, double errors[3]) const;
+  const Timer& get_timer() const { return timer; }
+  int n_steps() const { return n_time_steps; }
+private:
+  void set_initial_solution();
+  void compute_time_step();
+  void update_ghosts();
+  // res = -(F_{i+1/2} - F_{i-1/2})/dx of the present solution
+  void compute_residual();
+
+  static const int ng = 2; //Ghost cells on each side, i = -2,...,n+1 is at
+                           //index i+ng
+  int n_cells;
+  double dx, dt, t, cfl, gamma;
+  int rk_order;
+  bool muscl;
+  Shock_Tube problem;
+  Numerical_Flux numerical_flux;
+  int n_time_steps;
+
+  vector<double> rho, mom, E;             // Solution
+  vector<double> rho_old, mom_old, E_old; // At the start of the step
+  vector<double> res_rho, res_mom, res_E;
+  vector<double> f_rho, f_mom, f_E;       // Face i-1/2 at index i
+  vector<double> vel, pres;               // For MUSCL
+
+  Timer timer; //Time of time_step, residual, boundary and update phases
+};
+
+template <class Numerical_Flux>
+Euler_Solver_1d<Numerical_Flux>::Euler_Solver_1d(int n_cells, double cfl,
+                                                 int rk_order, bool muscl,
+                                                 double gamma,
+                                                 const Shock_Tube &problem)
+:
+n_cells(n_cells),
+cfl(cfl),
+gamma(gamma),
+rk_order(rk_order),
+muscl(muscl),
+problem(problem),
+numerical_flux(gamma),
+n_time_steps(0),
+timer("euler_1d " + problem.name)
+{
+  if (rk_order < 1 || rk_order > 3)
+  {
+    cout << "SSP-RK order must be 1, 2 or 3, not " << rk_order << endl;
+    assert(false);
+  }
+  dx = 1.0/n_cells;
+  t = 0.0;
+  const int n = n_cells + 2*ng;
+  rho.resize(n), mom.resize(n), E.resize(n);
+  rho_old.resize(n), mom_old.resize(n), E_old.resize(n);
+  res_rho.resize(n), res_mom.resize(n), res_E.resize(n);
+  vel.resize(n), pres.resize(n);
+  f_rho.resize(n_cells+1), f_mom.resize(n_cells+1), f_E.resize(n_cells+1);
+  timer.add_info("n_cells", n_cells);
+  timer.add_info("cfl", cfl);
+  timer.add_info("rk_order", rk_order);
+  timer.add_info("muscl", muscl);
+  timer.add_info("final_time", problem.final_time);
+}
+
+template <class Numerical_Flux>
+void Euler_Solver_1d<Numerical_Flux>::set_initial_solution()
+{
+  for (int i = 0; i < n_cells; i++)
+  {
+    const double x = (i + 0.5)*dx;
+    const bool left = (x <= problem.x0);
+    const double r = left ? problem.rho_l : problem.rho_r;
+    const double u = left ? problem.u_l : problem.u_r;
+    const double p = left ? problem.p_l : problem.p_r;
+    rho[i+ng] = r;
+    mom[i+ng] = r*u;
+    E[i+ng] = p/(gamma - 1.0) + 0.5*r*u*u;
+  }
+}
+
+// dt = cfl dx / max(|u| + c)
+template <class Numerical_Flux>
+void Euler_Solver_1d<Numerical_Flux>::compute_time_step()
+{
+  double speed = 0.0;
+  for (int i = ng; i < n_cells + ng; i++)
+  {
+    const double u = mom[i]/rho[i];
+    const double p = euler_pressure(gamma, rho[i], mom[i], E[i]);
+    speed = max(speed, abs(u) + sqrt(gamma*p/rho[i]));
+  }
+  dt = cfl*dx/speed;
+  if (t + dt > problem.final_time)
+    dt = problem.final_time - t;
+}
+
+template <class Numerical_Flux>
+void Euler_Solver_1d<Numerical_Flux>::update_ghosts()
+{
+  for (int g = 1; g <= ng; g++)
+  {
+    rho[ng-g] = rho[ng], mom[ng-g] = mom[ng], E[ng-g] = E[ng];
+    const int last = n_cells + ng - 1;
+    rho[last+g] = rho[last], mom[last+g] = mom[last], E[last+g] = E[last];
+  }
+}
+
+template <class Numerical_Flux>
+void Euler_Solver_1d<Numerical_Flux>::compute_residual()
+{
+  timer.start("boundary");
+  update_ghosts();
+  timer.stop("boundary");
+  timer.start("residual");
+  const double *r = &rho[ng], *m = &mom[ng], *e = &E[ng];
+  if (muscl)
+  {
+    // The primitive variables (rho, u, p) are reconstructed, those of the
+    // conserved ones can give negative pressures near vacuum (Toro test 2)
+    for (int i = -ng; i < n_cells + ng; i++)
+    {
+      vel[i+ng] = m[i]/r[i];
+      pres[i+ng] = euler_pressure(gamma, r[i], m[i], e[i]);
+    }
+    const double *w[3] = {r, &vel[ng], &pres[ng]};
+    // Face i-1/2 is between W_{i-1} + phi_{i-1}/2 and W_i - phi_i/2
+    for (int i = 0; i <= n_cells; i++)
+    {
+      double W_l[3], W_r[3];
+      for (int v = 0; v < 3; v++)
+      {
+        const double *q = w[v];
+        W_l[v] = q[i-1] + 0.5*minmod(q[i] - q[i-1], q[i-1] - q[i-2]);
+        W_r[v] = q[i]   - 0.5*minmod(q[i+1] - q[i], q[i] - q[i-1]);
+      }
+      double F[3];
+      numerical_flux(W_l[0], W_l[0]*W_l[1],
+                     W_l[2]/(gamma - 1.0) + 0.5*W_l[0]*W_l[1]*W_l[1],
+                     W_r[0], W_r[0]*W_r[1],
+                     W_r[2]/(gamma - 1.0) + 0.5*W_r[0]*W_r[1]*W_r[1], F);
+      f_rho[i] = F[0], f_mom[i] = F[1], f_E[i] = F[2];
+    }
+  }
+  else
+    for (int i = 0; i <= n_cells; i++)
+    {
+      double F[3];
+      numerical_flux(r[i-1], m[i-1], e[i-1], r[i], m[i], e[i], F);
+      f_rho[i] = F[0], f_mom[i] = F[1], f_E[i] = F[2];
+    }
+  const double lam = 1.0/dx;
+  for (int i = 0; i < n_cells; i++)
+  {
+    res_rho[i+ng] = -lam*(f_rho[i+1] - f_rho[i]);
+    res_mom[i+ng] = -lam*(f_mom[i+1] - f_mom[i]);
+    res_E[i+ng]   = -lam*(f_E[i+1] - f_E[i]);
+  }
+  timer.stop("residual");
+}
+
+template <class Numerical_Flux>
+void Euler_Solver_1d<Numerical_Flux>::run()
+{
+  Scoped_Timer run_timer(timer, "other");
+  set_initial_solution();
+  // Shu-Osher form, stage s is U = a[s] U_old + (1-a[s]) (U + dt res(U))
+  const double a[3][3] = {{0.0, 0.0, 0.0},
+                          {0.0, 0.5, 0.0},
+                          {0.0, 0.75, 1.0/3.0}};
+  while (t < problem.final_time)
+  {
+    timer.start("time_step");
+    compute_time_step();
+    timer.stop("time_step");
+    timer.start("update");
+    rho_old = rho, mom_old = mom, E_old = E;
+    timer.stop("update");
+    for (int s = 0; s < rk_order; s++)
+    {
+      compute_residual();
+      timer.start("update");
+      const double a_s = a[rk_order-1][s], b_s = 1.0 - a_s;
+      for (int i = ng; i < n_cells + ng; i++)
+      {
+        rho[i] = a_s*rho_old[i] + b_s*(rho[i] + dt*res_rho[i]);
+        mom[i] = a_s*mom_old[i] + b_s*(mom[i] + dt*res_mom[i]);
+        E[i]   = a_s*E_old[i]   + b_s*(E[i]   + dt*res_E[i]);
+      }
+      timer.stop("update");
+    }
+    t += dt;
+    n_time_steps += 1;
+    timer.count("time_steps");
+    timer.count("cell_updates", n_cells*rk_order);
+  }
+}
+
+template <class Numerical_Flux>
+void Euler_Solver_1d<Numerical_Flux>::write_solution(string filename) const
+{
+  ofstream out(filename);
+  out << "# " << problem.name << ", " << n_cells << " cells, t = " << t
+      << "\n# x dens pres velx eint cspd\n";
+  for (int i = ng; i < n_cells + ng; i++)
+  {
+    const double p = euler_pressure(gamma, rho[i], mom[i], E[i]);
+    out << (i - ng + 0.5)*dx << " " << rho[i] << " " << p << " "
+        << mom[i]/rho[i] << " " << p/((gamma - 1.0)*rho[i]) << " "
+        << sqrt(gamma*p/rho[i]) << "\n";
+  }
+}
+
+template <class Numerical_Flux>
+bool Euler_Solver_1d<Numerical_Flux>::get_error(string filename,
+                                                double errors[3]) const
+{
+  ifstream in(filename);
+  if (!in)
+    return false;
+  string line;
+  int n_points = 0;
+  errors[0] = errors[1] = errors[2] = 0.0;
+  while (getline(in, line))
+  {
+    if (line.size() == 0 || line[0] == '#')
+      continue;
+    double x, dens, pres, velx;
+    if (sscanf(line.c_str(), "%lf %lf %lf %lf", &x, &dens, &pres, &velx) != 4)
+      continue; //Header
+    // The cell containing x
+    const int i = min(n_cells - 1, max(0, int(x/dx))) + ng;
+    errors[0] += abs(rho[i] - dens);
+    errors[1] += abs(mom[i]/rho[i] - velx);
+    errors[2] += abs(euler_pressure(gamma, rho[i], mom[i], E[i]) - pres);
+    n_points += 1;
+  }
+  if (n_points == 0)
+    return false;
+  for (int v = 0; v < 3; v++)
+    errors[v] /= n_points;
+  return true;
+}
+
+#endif
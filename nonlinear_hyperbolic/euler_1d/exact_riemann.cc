@@ -0,0 +1,75 @@
+#include <cmath>
+#include <limits>
+#include "exact_riemann.h"
+
+using namespace std;
+
+void Riemann_States::resize(int n)
+{
+  rho_l.resize(n), u_l.resize(n), p_l.resize(n);
+  rho_r.resize(n), u_r.resize(n), p_r.resize(n);
+}
+
+void Riemann_States::set(int k, double rho_l, double u_l, double p_l,
+                         double rho_r, double u_r, double p_r)
+{
+  this->rho_l[k] = rho_l, this->u_l[k] = u_l, this->p_l[k] = p_l;
+  this->rho_r[k] = rho_r, this->u_r[k] = u_r, this->p_r[k] = p_r;
+}
+
+int Exact_Riemann_Solver::star_states(const Riemann_States &states,
+                                      vector<double> &p_star,
+                                      vector<double> &u_star) const
+{
+  const int n = states.size();
+  p_star.resize(n), u_star.resize(n);
+  int n_failed = 0;
+  // The number of Newton iterations depends on the problem
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 256) reduction(+:n_failed)
+#endif
+  for (int k = 0; k < n; k++)
+    if (!star_state(states.rho_l[k], states.u_l[k], states.p_l[k],
+                    states.rho_r[k], states.u_r[k], states.p_r[k],
+                    p_star[k], u_star[k]))
+    {
+      p_star[k] = u_star[k] = numeric_limits<double>::quiet_NaN();
+      n_failed += 1;
+    }
+  return n_failed;
+}
+
+void Exact_Riemann_Solver::sample(const Riemann_States &states,
+                                  const vector<double> &p_star,
+                                  const vector<double> &u_star,
+                                  const vector<double> &x0,
+                                  const vector<double> &t,
+                                  const vector<double> &x,
+                                  vector<double> &rho, vector<double> &u,
+                                  vector<double> &p) const
+{
+  const int n = states.size(), n_points = x.size();
+  assert(int(p_star.size()) == n && int(u_star.size()) == n);
+  assert(int(x0.size()) == n && int(t.size()) == n);
+  rho.resize(long(n)*n_points);
+  u.resize(long(n)*n_points);
+  p.resize(long(n)*n_points);
+  const double infinity = numeric_limits<double>::infinity();
+#ifdef _OPENMP
+  #pragma omp parallel for collapse(2) schedule(static)
+#endif
+  for (int k = 0; k < n; k++)
+    for (int j = 0; j < n_points; j++)
+    {
+      const long index = long(k)*n_points + j;
+      // At t = 0 the initial states, on either side of x0
+      double s;
+      if (t[k] > 0.0)
+        s = (x[j] - x0[k])/t[k];
+      else
+        s = (x[j] <= x0[k]) ? -infinity : infinity;
+      sample(states.rho_l[k], states.u_l[k], states.p_l[k],
+             states.rho_r[k], states.u_r[k], states.p_r[k],
+             p_star[k], u_star[k], s, rho[index], u[index], p[index]);
+    }
+}
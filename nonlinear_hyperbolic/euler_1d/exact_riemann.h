@@ -0,0 +1,238 @@
+#ifndef __EXACT_RIEMANN_H__
+#define __EXACT_RIEMANN_H__
+
+#include <vector>
+#include <cmath>
+#include <iostream>
+#include <cassert>
+#include "euler_fluxes.h"
+
+using namespace std;
+
+// Exact solution of the Riemann problem of the 1D Euler equations for an
+// ideal gas, the C++ version of hyperbolic_systems/ToroExact/exactRP.py
+// (Toro, Riemann Solvers and Numerical Methods for Fluid Dynamics, ch. 4).
+// States are primitive, (density, velocity, pressure).
+//
+// star_state finds the pressure and velocity between the left and right waves
+// by Newton iteration, and sample gives the self similar solution at
+// s = (x - x0)/t. They are inline, for the Godunov flux below. The batch
+// versions work on many problems, in the structure of arrays Riemann_States,
+// and many points x in one call, and are threaded with OpenMP
+// (make openmp=yes).
+
+// Left and right states of n Riemann problems
+struct Riemann_States
+{
+  void resize(int n);
+  int size() const { return rho_l.size(); }
+  void set(int k, double rho_l, double u_l, double p_l,
+           double rho_r, double u_r, double p_r);
+
+  vector<double> rho_l, u_l, p_l;
+  vector<double> rho_r, u_r, p_r;
+};
+
+class Exact_Riemann_Solver
+{
+public:
+  Exact_Riemann_Solver(double gamma);
+
+  // False if the states generate vacuum or the iteration does not converge
+  bool star_state(double rho_l, double u_l, double p_l,
+                  double rho_r, double u_r, double p_r,
+                  double &p_star, double &u_star) const;
+  void sample(double rho_l, double u_l, double p_l,
+              double rho_r, double u_r, double p_r,
+              double p_star, double u_star, double s,
+              double &rho, double &u, double &p) const;
+
+  // p_star and u_star of all problems, NaN for those that failed. Returns the
+  // number of failed problems.
+  int star_states(const Riemann_States &states, vector<double> &p_star,
+                  vector<double> &u_star) const;
+  // Problem k with the discontinuity at x0[k], at time t[k] and the points
+  // x[j], in rho[k*x.size() + j], ...
+  void sample(const Riemann_States &states, const vector<double> &p_star,
+              const vector<double> &u_star, const vector<double> &x0,
+              const vector<double> &t, const vector<double> &x,
+              vector<double> &rho, vector<double> &u, vector<double> &p) const;
+
+  const double gamma;
+
+private:
+  double guess_pressure(double rho_l, double u_l, double p_l, double c_l,
+                        double rho_r, double u_r, double p_r,
+                        double c_r) const;
+  // f_K(p) and its derivative, the velocity jump across the wave K
+  void pressure_function(double p, double rho_k, double p_k, double c_k,
+                         double &f, double &df) const;
+
+  double g1, g2, g3, g4, g5, g6, g7; // G1,...,G7 of exactRP.py
+};
+
+inline
+Exact_Riemann_Solver::Exact_Riemann_Solver(double gamma)
+:
+gamma(gamma)
+{
+  g1 = 0.5*(gamma - 1.0)/gamma;
+  g2 = 0.5*(gamma + 1.0)/gamma;
+  g3 = 1.0/g1;
+  g4 = 1.0/(g1*gamma);
+  g5 = 1.0/(g2*gamma);
+  g6 = g1/g2;
+  g7 = g1*gamma;
+}
+
+inline
+void Exact_Riemann_Solver::pressure_function(double p, double rho_k,
+                                             double p_k, double c_k,
+                                             double &f, double &df) const
+{
+  if (p <= p_k) // Rarefaction
+  {
+    const double ratio = p/p_k;
+    f = g4*c_k*(pow(ratio, g1) - 1.0);
+    df = 1.0/(rho_k*c_k)*pow(ratio, -g2);
+  }
+  else // Shock
+  {
+    const double a_k = g5/rho_k, b_k = g6*p_k;
+    const double q = sqrt(a_k/(b_k + p));
+    f = (p - p_k)*q;
+    df = (1.0 - 0.5*(p - p_k)/(b_k + p))*q;
+  }
+}
+
+// Primitive variable estimate if the pressures are close, two rarefaction or
+// two shock estimates otherwise
+inline
+double Exact_Riemann_Solver::guess_pressure(double rho_l, double u_l,
+                                            double p_l, double c_l,
+                                            double rho_r, double u_r,
+                                            double p_r, double c_r) const
+{
+  const double cup = 0.25*(rho_l + rho_r)*(c_l + c_r);
+  const double ppv = max(0.0, 0.5*(p_l + p_r) + 0.5*(u_l - u_r)*cup);
+  const double p_min = min(p_l, p_r), p_max = max(p_l, p_r);
+  if (p_max/p_min <= 2.0 && p_min <= ppv && ppv <= p_max)
+    return ppv;
+  if (ppv < p_min)
+  {
+    const double pq = pow(p_l/p_r, g1);
+    const double um = (pq*u_l/c_l + u_r/c_r + g4*(pq - 1.0))/(pq/c_l + 1.0/c_r);
+    const double pt_l = 1.0 + g7*(u_l - um)/c_l;
+    const double pt_r = 1.0 + g7*(um - u_r)/c_r;
+    return 0.5*(p_l*pow(pt_l, g3) + p_r*pow(pt_r, g3));
+  }
+  const double ge_l = sqrt((g5/rho_l)/(g6*p_l + ppv));
+  const double ge_r = sqrt((g5/rho_r)/(g6*p_r + ppv));
+  return (ge_l*p_l + ge_r*p_r - u_r + u_l)/(ge_l + ge_r);
+}
+
+inline
+bool Exact_Riemann_Solver::star_state(double rho_l, double u_l, double p_l,
+                                      double rho_r, double u_r, double p_r,
+                                      double &p_star, double &u_star) const
+{
+  const double c_l = sqrt(gamma*p_l/rho_l), c_r = sqrt(gamma*p_r/rho_r);
+  if (g4*(c_l + c_r) <= u_r - u_l)
+    return false; // Vacuum
+  const double tol = 1e-8; // As in exactRP.py
+  const int max_iter = 100;
+  double p_old = guess_pressure(rho_l, u_l, p_l, c_l, rho_r, u_r, p_r, c_r);
+  for (int iter = 0; iter < max_iter; iter++)
+  {
+    double f_l, df_l, f_r, df_r;
+    pressure_function(p_old, rho_l, p_l, c_l, f_l, df_l);
+    pressure_function(p_old, rho_r, p_r, c_r, f_r, df_r);
+    double p = p_old - (f_l + f_r + u_r - u_l)/(df_l + df_r);
+    if (2.0*abs((p - p_old)/(p + p_old)) <= tol)
+    {
+      p_star = p;
+      u_star = 0.5*(u_l + u_r + f_r - f_l);
+      return true;
+    }
+    if (p < 0.0)
+      p = tol;
+    p_old = p;
+  }
+  return false;
+}
+
+inline
+void Exact_Riemann_Solver::sample(double rho_l, double u_l, double p_l,
+                                  double rho_r, double u_r, double p_r,
+                                  double p_star, double u_star, double s,
+                                  double &rho, double &u, double &p) const
+{
+  // The solution is symmetric under x -> -x, so the right side is the left
+  // side of the mirrored problem
+  const bool left = (s <= u_star);
+  const double sign = left ? 1.0 : -1.0;
+  const double rho_k = left ? rho_l : rho_r;
+  const double u_k = sign*(left ? u_l : u_r);
+  const double p_k = left ? p_l : p_r;
+  const double c_k = sqrt(gamma*p_k/rho_k);
+  const double us = sign*u_star;
+  s = sign*s;
+  if (p_star > p_k) // Shock
+  {
+    const double ratio = p_star/p_k;
+    const double s_k = u_k - c_k*sqrt(g2*ratio + g1);
+    if (s <= s_k)
+      rho = rho_k, u = u_k, p = p_k;
+    else
+      rho = rho_k*(ratio + g6)/(g6*ratio + 1.0), u = us, p = p_star;
+  }
+  else // Rarefaction, with head u_k - c_k and tail us - c_star
+  {
+    const double c_star = c_k*pow(p_star/p_k, g1);
+    if (s <= u_k - c_k)
+      rho = rho_k, u = u_k, p = p_k;
+    else if (s > us - c_star)
+      rho = rho_k*pow(p_star/p_k, 1.0/gamma), u = us, p = p_star;
+    else // Inside the fan
+    {
+      const double c = g5*(c_k + g7*(u_k - s));
+      u = g5*(c_k + g7*u_k + s);
+      rho = rho_k*pow(c/c_k, g4);
+      p = p_k*pow(c/c_k, g3);
+    }
+  }
+  u = sign*u;
+}
+
+// Godunov's flux, the physical flux of the exact solution at x/t = 0, with the
+// same interface as the fluxes of euler_fluxes.h
+class Godunov_Flux
+{
+public:
+  Godunov_Flux(double gamma) : gamma(gamma), riemann_solver(gamma) {}
+  void operator()(double rho_l, double mom_l, double E_l,
+                  double rho_r, double mom_r, double E_r, double F[3]) const
+  {
+    const double u_l = mom_l/rho_l, u_r = mom_r/rho_r;
+    const double p_l = euler_pressure(gamma, rho_l, mom_l, E_l);
+    const double p_r = euler_pressure(gamma, rho_r, mom_r, E_r);
+    double p_star, u_star;
+    if (!riemann_solver.star_state(rho_l, u_l, p_l, rho_r, u_r, p_r,
+                                   p_star, u_star))
+    {
+      cout << "No exact Riemann solution between (rho,u,p) = (" << rho_l
+           << "," << u_l << "," << p_l << ") and (" << rho_r << "," << u_r
+           << "," << p_r << ")" << endl;
+      assert(false);
+    }
+    double rho, u, p;
+    riemann_solver.sample(rho_l, u_l, p_l, rho_r, u_r, p_r, p_star, u_star,
+                          0.0, rho, u, p);
+    euler_flux(rho, rho*u, p/(gamma - 1.0) + 0.5*rho*u*u, p, F);
+  }
+  const double gamma;
+private:
+  Exact_Riemann_Solver riemann_solver;
+};
+
+#endif
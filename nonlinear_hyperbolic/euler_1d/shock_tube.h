@@ -0,0 +1,29 @@
+#ifndef __SHOCK_TUBE_H__
+#define __SHOCK_TUBE_H__
+
+#include <string>
+
+using namespace std;
+
+// Riemann problem on [0,1] with the discontinuity at x0, in primitive
+// variables (density, velocity, pressure) like the Toro tests of
+// hyperbolic_systems/ToroExact/toro_exact.py
+struct Shock_Tube
+{
+  string name;
+  double rho_l, u_l, p_l;
+  double rho_r, u_r, p_r;
+  double final_time, x0;
+};
+
+// Toro tests 1-7, in the order of toro_exact.py
+const Shock_Tube toro_tests[7] = {
+  {"toro_1", 1.0, 0.75, 1.0, 0.125, 0.0, 0.1, 0.2, 0.3},
+  {"toro_2", 1.0, -2.0, 0.4, 1.0, 2.0, 0.4, 0.15, 0.5},
+  {"toro_3", 1.0, 0.0, 1000.0, 1.0, 0.0, 0.01, 0.012, 0.5},
+  {"toro_4", 5.99924, 19.5975, 460.894, 5.99242, -6.19633, 46.0950, 0.035, 0.4},
+  {"toro_5", 1.0, -19.59745, 1000.0, 1.0, -19.59745, 0.01, 0.012, 0.8},
+  {"toro_6", 1.4, 0.0, 1.0, 1.0, 0.0, 1.0, 2.0, 0.5},
+  {"toro_7", 1.4, 0.1, 1.0, 1.0, 0.1, 1.0, 2.0, 0.5}};
+
+#endif
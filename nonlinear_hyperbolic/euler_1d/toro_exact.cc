@@ -0,0 +1,185 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cassert>
+#include "exact_riemann.h"
+#include "shock_tube.h"
+#include "../../include/timer.h"
+
+using namespace std;
+
+// Exact solutions of the Toro tests, like hyperbolic_systems/ToroExact/
+// toro_exact.py -p all, in one batch call. With bench, the time to solve and
+// sample many random Riemann problems.
+
+const string exact_dir = "../../hyperbolic_systems/ToroExact/output/";
+
+// Same layout as toro_exact.py
+void write_exact(const Shock_Tube &problem, int n, double gamma, bool zonal,
+                 const vector<double> &x, const double *rho, const double *u,
+                 const double *p)
+{
+  const string filename = problem.name + "_exact.dat";
+  FILE *out = fopen(filename.c_str(), "w");
+  assert(out != NULL);
+  fprintf(out, "# Exact Riemann solution for problem: %s\n",
+          problem.name.substr(5).c_str());
+  fprintf(out, "# Discretization: %s\n", zonal ? "zonal" : "nodal");
+  fprintf(out, "# Domain bounds: [%.5e,%.5e]\n", 0.0, 1.0);
+  fprintf(out, "# Iterface position: %.5e\n", problem.x0);
+  fprintf(out, "# Gamma: %.5e\n", gamma);
+  fprintf(out, "# Left  state [dens,velx,pres]: [%.5e, %.5e, %.5e]\n",
+          problem.rho_l, problem.u_l, problem.p_l);
+  fprintf(out, "# Right state [dens,velx,pres]: [%.5e, %.5e, %.5e]\n",
+          problem.rho_r, problem.u_r, problem.p_r);
+  fprintf(out, "# Time: %.5e\n", problem.final_time);
+  fprintf(out, "%17s %17s %17s %17s %17s %17s\n", "x", "dens", "pres", "velx",
+          "eint", "cspd");
+  for (int i = 0; i < n; i++)
+    fprintf(out, "%17.9e %17.9e %17.9e %17.9e %17.9e %17.9e\n", x[i], rho[i],
+            p[i], u[i], p[i]/rho[i]/(gamma - 1.0), sqrt(gamma*p[i]/rho[i]));
+  fclose(out);
+}
+
+// Largest difference of dens, pres and velx with the toro_exact.py output,
+// -1 if it can't be read
+double max_difference(const Shock_Tube &problem, int n, const double *rho,
+                      const double *u, const double *p)
+{
+  ifstream in(exact_dir + problem.name + "_exact.dat");
+  if (!in)
+    return -1.0;
+  string line;
+  int i = 0;
+  double diff = 0.0;
+  while (getline(in, line) && i < n)
+  {
+    double x, dens, pres, velx;
+    if (line[0] == '#' ||
+        sscanf(line.c_str(), "%lf %lf %lf %lf", &x, &dens, &pres, &velx) != 4)
+      continue;
+    diff = max(diff, max(abs(rho[i] - dens),
+                         max(abs(p[i] - pres), abs(u[i] - velx))));
+    i += 1;
+  }
+  return (i == n) ? diff : -1.0;
+}
+
+int main(int argc, char **argv)
+{
+  int n_points = 100;
+  bool zonal = true, bench = false;
+  for (int a = 1; a < argc; a++)
+  {
+    const string arg = argv[a];
+    if (arg == "zonal" || arg == "nodal")
+      zonal = (arg == "zonal");
+    else if (arg == "bench")
+      bench = true;
+    else if (atoi(arg.c_str()) > 1)
+      n_points = atoi(arg.c_str());
+    else
+    {
+      cout << "Usage: ./toro_exact [n_points=100] [zonal|nodal] [bench]"
+           << endl;
+      assert(false);
+    }
+  }
+  const double gamma = 1.4;
+  Exact_Riemann_Solver riemann_solver(gamma);
+  vector<Timer> timers;
+
+  // The 7 Toro tests at the same points
+  {
+    Timer timer("toro_exact");
+    const int n = 7;
+    Riemann_States states;
+    states.resize(n);
+    vector<double> x0(n), t(n);
+    for (int k = 0; k < n; k++)
+    {
+      const Shock_Tube &pb = toro_tests[k];
+      states.set(k, pb.rho_l, pb.u_l, pb.p_l, pb.rho_r, pb.u_r, pb.p_r);
+      x0[k] = pb.x0, t[k] = pb.final_time;
+    }
+    vector<double> x(n_points);
+    for (int i = 0; i < n_points; i++)
+      x[i] = zonal ? (i + 0.5)/n_points : double(i)/(n_points - 1);
+
+    vector<double> p_star, u_star, rho, u, p;
+    timer.start("star_states");
+    const int n_failed = riemann_solver.star_states(states, p_star, u_star);
+    timer.stop("star_states");
+    if (n_failed > 0)
+      cout << n_failed << " Toro tests have no solution" << endl;
+    timer.start("sample");
+    riemann_solver.sample(states, p_star, u_star, x0, t, x, rho, u, p);
+    timer.stop("sample");
+    timer.start("output");
+    for (int k = 0; k < n; k++)
+    {
+      const long offset = long(k)*n_points;
+      write_exact(toro_tests[k], n_points, gamma, zonal, x, &rho[offset],
+                  &u[offset], &p[offset]);
+      cout << toro_tests[k].name << ": p* = " << p_star[k] << ", u* = "
+           << u_star[k];
+      if (zonal)
+      {
+        const double diff = max_difference(toro_tests[k], n_points,
+                                           &rho[offset], &u[offset],
+                                           &p[offset]);
+        if (diff >= 0.0)
+          cout << ", max difference with toro_exact.py " << diff;
+      }
+      cout << endl;
+    }
+    timer.stop("output");
+    timer.add_info("n_points", n_points);
+    timers.push_back(timer);
+  }
+
+  // Random problems, each sampled at n_points. The few that generate vacuum
+  // are counted as failed.
+  if (bench)
+  {
+    Timer timer("toro_exact bench");
+    const int n = 100000;
+    Riemann_States states;
+    states.resize(n);
+    srand(1);
+    for (int k = 0; k < n; k++)
+    {
+      double w[6];
+      for (int v = 0; v < 6; v++)
+        w[v] = double(rand())/RAND_MAX;
+      states.set(k, 0.1 + 10.0*w[0], 4.0*w[1] - 2.0, 0.01 + 100.0*w[2],
+                 0.1 + 10.0*w[3], 4.0*w[4] - 2.0, 0.01 + 100.0*w[5]);
+    }
+    vector<double> x0(n, 0.5), t(n, 0.1), x(n_points);
+    for (int i = 0; i < n_points; i++)
+      x[i] = (i + 0.5)/n_points;
+    vector<double> p_star, u_star, rho, u, p;
+    timer.start("star_states");
+    const int n_failed = riemann_solver.star_states(states, p_star, u_star);
+    timer.stop("star_states");
+    timer.start("sample");
+    riemann_solver.sample(states, p_star, u_star, x0, t, x, rho, u, p);
+    timer.stop("sample");
+    timer.count("problems", n);
+    timer.count("points", long(n)*n_points);
+    timer.add_info("n_failed", n_failed);
+    cout << "bench: " << n << " problems (" << n_failed << " failed), "
+         << 1e9*timer.seconds("star_states")/n << " ns per problem, "
+         << 1e9*timer.seconds("sample")/(double(n)*n_points)
+         << " ns per point" << endl;
+    timers.push_back(timer);
+  }
+  for (unsigned int k = 0; k < timers.size(); k++)
+    timers[k].print();
+  write_json(timers, "timing.json");
+  return 0;
+}
@@ -0,0 +1,28 @@
+#!/bin/bash
+# Runs poisson3d with every ranks x threads split of the cores on this node
+# and prints one line per split with the time taken by the Jacobi iterations.
+#
+# Usage: ./hybrid_bench.sh [ncores]
+# ncores defaults to the number of cores given by nproc.
+#
+# For one rank per socket, the ranks are bound to sockets and the threads of
+# a rank are kept on the cores of its socket with OMP_PROC_BIND/OMP_PLACES.
+
+ncores=${1:-$(nproc)}
+MPIRUN=${MPIRUN:-mpirun}
+
+export OMP_PROC_BIND=close
+export OMP_PLACES=cores
+
+printf "%8s %8s %12s\n" ranks threads seconds
+for ((ranks = 1; ranks <= ncores; ranks++))
+do
+  if ((ncores % ranks != 0)); then
+    continue
+  fi
+  threads=$((ncores / ranks))
+  seconds=$(OMP_NUM_THREADS=$threads $MPIRUN -np $ranks \
+            --map-by ppr:$ranks:node:pe=$threads --bind-to core \
+            ./poisson3d | grep "Time taken" | awk '{print $(NF-1)}')
+  printf "%8d %8d %12s\n" $ranks $threads "$seconds"
+done
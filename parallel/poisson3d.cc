@@ -9,10 +9,16 @@
 // TODO - Order Ni, Nj, Nk correctly
 
 #include <iostream>
+#include <fstream>
 #include <cmath>
 #include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "../include/array3d.h"
+#include "../include/vtk_anim3d.h"
+#include "../include/perf_counters.h"
 
 using namespace std;
 
@@ -25,31 +31,157 @@ double f(double x, double y, double z) // Source term
   return value;
 }
 
+// Tile sizes in j and k for the cache blocked sweep. Three i-planes of a
+// tile should fit in the L2 cache.
+#define tile_j 16
+#define tile_k 128
+
 // Move from solution array to intermediary array fieldSend before MPI_Send
 void CopySendBuf(Array3D phi[],                // Solution old and new
-                 int t0,
+                 int t0, int ng,               // ng = ghost layers
                  double disp, double dir, double fieldSend[], int MaxBufLen);
 
 // Move from intermediate array fieldRecv to solution array after MPI_Recv
 void CopyRecvBuf(Array3D phi[],                   // Solution old and new
-                 int t0,
+                 int t0, int ng,
                  double disp, double dir, double fieldRecv[], int MaxBufLen);
 
-// One Jacobi iteration
-void Jacobi_sweep(int udim[][p_dim], // local_dim(pts in dimension)
+// Trade ng ghost layers of phi[t0] with the neighbours in all directions.
+// totmsgsize[dir] is the size of the message in direction dir and
+// fieldSend, fieldRecv are intermediary arrays of size MaxBufLen.
+void exchange_halo(MPI_Comm GRID_COMM_WORLD, Array3D phi[], int t0, int ng,
+                   int local_dim[], int totmsgsize[],
+                   double fieldSend[], double fieldRecv[], int MaxBufLen);
+
+// Each process writes its part of phi as a piece of the parallel VTK file
+// filename.pvtr, which is written by rank 0. start[dir] is the global index
+// of the first point of the process and nbr tells if there is a neighbour.
+// Ghosts must be up to date, as pieces overlap by one point.
+void write_solution(MPI_Comm GRID_COMM_WORLD, Array3D &phi,
+                    int local_dim[], int start[], int spat_dim[],
+                    int nbr[][p_dim],
+                    double xmin, double ymin, double zmin, double h,
+                    int iter, string filename);
+
+// One Jacobi iteration over the points box[0][dir] to box[1][dir].
+// maxdelta = NULL skips the convergence measurement.
+void Jacobi_sweep(int box[][p_dim],
                   Array3D phi[], int t0, int t1,
                   double xmin, double ymin, double zmin,
                   double h,
                   double *maxdelta);
 
+// Same as Jacobi_sweep, but the j-k planes are split in tile_j x tile_k
+// tiles so that the planes i-1,i,i+1 of a tile are still in cache when
+// they are reused.
+void Jacobi_sweep_tiled(int box[][p_dim],
+                        Array3D phi[], int t0, int t1,
+                        double xmin, double ymin, double zmin,
+                        double h,
+                        double *maxdelta);
+
+// n_sweeps Jacobi iterations in one pass over the array. The iterations
+// follow each other as a wavefront along i, so that a plane is reused by
+// all the iterations while it is in cache. Needs n_sweeps ghost layers.
+void Jacobi_wavefront(int udim[][p_dim], int nbr[][p_dim], int n_sweeps,
+                      Array3D phi[], int t0,
+                      double xmin, double ymin, double zmin,
+                      double h,
+                      double *maxdelta);
+
 int main(int argc, char** argv)
 {
   int myid, numprocs, ierr; // rank, size renamed for problem
-  ierr = MPI_Init(&argc, &argv);
+  int provided;             // Thread support given by the MPI library
+  // Only the master thread makes MPI calls, the sweeps are threaded with
+  // OpenMP in between. So, MPI_THREAD_FUNNELED is enough.
+  ierr = MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
   ierr = MPI_Comm_size(MPI_COMM_WORLD, &numprocs);
   ierr = MPI_Comm_rank(MPI_COMM_WORLD, &myid);
-
+  if (provided < MPI_THREAD_FUNNELED)
+  {
+    if (myid == 0)
+      printf("MPI library does not support MPI_THREAD_FUNNELED\n");
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  // Hardware counters with PERF_COUNTERS=1. They must be opened before the
+  // OpenMP threads are created, to count them as well.
+  Perf_Counters perf;
+  int num_threads = 1; // OpenMP threads per rank
+#ifdef _OPENMP
+  num_threads = omp_get_max_threads();
+#endif
+
+  // Usage: poisson3d [kernel] [sweeps_per_exchange] [output] [key=value ...]
+  // kernel = plain, tiled or wavefront. With sweeps_per_exchange = n, n ghost
+  // layers are traded and n Jacobi iterations are done per halo exchange.
+  // Putting output at the end writes the solution to solution.pvtr
+  // The key=value options are
+  //   N=60           grid points in each direction
+  //   procs=2x2x1    processes in directions 0,1,2 (k,j,i), MPI_Dims_create
+  //                  chooses them when not given
+  //   itermax=1000   maximum number of iterations, the last exchange is
+  //                  followed by fewer sweeps when needed to stop there
+  //   bench=file.csv benchmark mode, exactly itermax iterations are done and
+  //                  the times of halo exchange, sweeps and reduction are
+  //                  appended as one line to file.csv
+  string kernel = "plain";
+  int n_sweeps = 1;
+  bool output_indicator = false;
   int N = 60;
+  int itermax = 1000;
+  int proc_grid[p_dim] = {0, 0, 0};
+  string bench_file = "";
+  bool args_ok = true;
+  int n_positional = 0;
+  for (int a = 1; a < argc; a++)
+  {
+    string arg = argv[a];
+    size_t eq = arg.find('=');
+    if (eq == string::npos)
+    {
+      if (n_positional == 0)
+        kernel = arg;
+      else if (n_positional == 1)
+        n_sweeps = atoi(arg.c_str());
+      else if (n_positional == 2 && arg == "output")
+        output_indicator = true;
+      else
+        args_ok = false;
+      n_positional++;
+      continue;
+    }
+    string key = arg.substr(0, eq), val = arg.substr(eq+1);
+    if (key == "N")
+      N = atoi(val.c_str());
+    else if (key == "itermax")
+      itermax = atoi(val.c_str());
+    else if (key == "procs")
+    {
+      if (sscanf(val.c_str(), "%dx%dx%d",
+                 &proc_grid[0], &proc_grid[1], &proc_grid[2]) != 3
+          || proc_grid[0]*proc_grid[1]*proc_grid[2] != numprocs)
+        args_ok = false;
+    }
+    else if (key == "bench")
+      bench_file = val;
+    else
+      args_ok = false;
+  }
+  if ((kernel != "plain" && kernel != "tiled" && kernel != "wavefront")
+      || n_sweeps < 1 || N < 3 || itermax < 1 || args_ok == false)
+  {
+    if (myid == 0)
+    {
+      printf("Use poisson3d [plain/tiled/wavefront] [sweeps_per_exchange] [output]\n");
+      printf("              [N=60] [procs=PkxPjxPi] [itermax=1000] [bench=file.csv]\n");
+      printf("where Pk*Pj*Pi must be the number of processes\n");
+    }
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  bool bench = (bench_file != "");
+  int ng = n_sweeps; // Ghost layers needed for n_sweeps iterations
+
   int spat_dim[p_dim];  // N x N x N grid
   int proc_dim[p_dim];  // np1 X np2 X np2
   int pbc_check[p_dim]; // 0/1 to indicate open/periodic bc in particular dimension
@@ -60,7 +192,8 @@ int main(int argc, char** argv)
     {
       pbc_check[i] = 0; // Open bc in all directions
       spat_dim[i]  = N; // Assuming equal size in all directions
-      proc_dim[i]  = 0; // Zero means that MPI_Dims_create specifies these
+      proc_dim[i]  = proc_grid[i]; // Zero means that MPI_Dims_create
+                                   // specifies these
     }
   }
   // Broadcast respective arrays from root = 0 to all other processes
@@ -84,8 +217,12 @@ int main(int argc, char** argv)
                          proc_dim    // array storing (np1,np2,np3)
                          );
   if (myid==0)
+  {
     for (int i = 0; i < p_dim; i++)
       printf("proc_dim[%d] = %d\n", i, proc_dim[i]);
+    printf("threads per rank = %d\n", num_threads);
+    printf("kernel = %s, sweeps per exchange = %d\n", kernel.c_str(), n_sweeps);
+  }
 
   int let_reorder = 1; // Allow reordering to handle all numprocs, sending
                        // surplus to MPI_COMM_NULL
@@ -107,6 +244,7 @@ int main(int argc, char** argv)
   MPI_Comm_size(GRID_COMM_WORLD, &num_p_grid);
 
  int local_dim[p_dim], mycoord[p_dim];
+  int start[p_dim]; // Global index of the first point of this process
 
   // mycoord = Cartesian coordinate rank of process
   ierr = MPI_Cart_coords(GRID_COMM_WORLD,   //communicator
@@ -126,34 +264,64 @@ int main(int argc, char** argv)
       local_dim[i] += 1; // Adding unused point
     }
     //Total processes for which `if` holds = total unused points
+    // All processes before this one in dimension i have floor(N/np) points,
+    // and the first N%np of them have one more.
+    start[i] = mycoord[i] * (spat_dim[i] / proc_dim[i])
+               + min(mycoord[i], spat_dim[i] % proc_dim[i]);
+  }
+  // The ng planes sent to a neighbour must be physical points of the sender,
+  // so every rank needs at least ng points in the directions that are split
+  int min_local = spat_dim[0];
+  for (int i = 0; i < p_dim; i++)
+    if (proc_dim[i] > 1)
+      min_local = min(min_local, local_dim[i]);
+  ierr = MPI_Allreduce(MPI_IN_PLACE, &min_local, 1, MPI_INT, MPI_MIN,
+                       GRID_COMM_WORLD);
+  if (min_local < ng)
+  {
+    if (myid == 0)
+      printf("sweeps_per_exchange = %d needs at least %d points per rank in "
+             "each split direction, the smallest rank has %d\n",
+             n_sweeps, ng, min_local);
+    MPI_Abort(MPI_COMM_WORLD, 1);
   }
 
   int Ni = local_dim[2], Nj = local_dim[1], Nk = local_dim[0];
   vector<double> grid_z(Ni+2), grid_y(Nj+2), grid_x(Nk+2);
-  printf("For rank %d with coordinates (%d,%d,%d), Nk, Nj, Ni = %d, %d, %d\n",
-          myid, mycoord[0], mycoord[1], mycoord[2], Nk, Nj, Ni);
+  if (!bench)
+    printf("For rank %d with coordinates (%d,%d,%d), Nk, Nj, Ni = %d, %d, %d\n",
+           myid, mycoord[0], mycoord[1], mycoord[2], Nk, Nj, Ni);
+  // Physical points are 0,...,N-1, ghost layers are -ng,...,-1 and
+  // N,...,N+ng-1. k is the fastest index, so i-planes are contiguous.
   Array3D phi[2];
-  phi[0].resize(Ni+2,Nj+2,Nk+2); phi[1].resize(Ni+2,Nj+2,Nk+2);
+  phi[0].resize(Ni,Nj,Nk,ng);
+  phi[1].resize(Ni,Nj,Nk,ng);
 
   int totmsgsize[p_dim], MaxBufLen=0;
 
-  // j-k plane
-  totmsgsize[2] = local_dim[0] * local_dim[1]; // Nk*Nj
+  // ng planes are sent. The planes include the ghost layers in the other
+  // directions, so that edge and corner ghosts are filled as we go through
+  // the directions one after the other.
+  // j-k plane, sent straight from the contiguous slabs of phi
+  totmsgsize[2] = ng * phi[0].slab_size();
   MaxBufLen     = max(totmsgsize[2], MaxBufLen);
   // i-k plane
-  totmsgsize[1] = local_dim[0] * local_dim[2]; // Nk*Ni
+  totmsgsize[1] = ng * (Nk+2*ng) * (Ni+2*ng);
   MaxBufLen     = max(totmsgsize[1], MaxBufLen);
   // i-j plane
-  totmsgsize[0] = local_dim[1] * local_dim[2]; // Nj*Ni
+  totmsgsize[0] = ng * (Nj+2*ng) * (Ni+2*ng);
   MaxBufLen     = max(totmsgsize[0], MaxBufLen);
   double *fieldSend = new double [MaxBufLen];
   double *fieldRecv = new double [MaxBufLen];
   // char *filename1 = new char[filenameLength];
   // double fieldSend[MaxBufLen] = {0.0}; // usage: phi -> fieldSend -> MPI_Send
   // double fieldRecv[MaxBufLen] = {0.0}; // usage: MPI_Recv -> fieldRecv -> phi
-  cout << "MaxBufLen = "<<MaxBufLen<<endl;
+  if (!bench)
+    cout << "MaxBufLen = "<<MaxBufLen<<endl;
   // left, right physical limits, i.e., values to be updated
   int udim[2][p_dim] = {0};
+  // 1 if there is a neighbour on left/right, 0 if it is a boundary
+  int nbr[2][p_dim] = {0};
   int disp = -1;
   for (int dir = 0; dir < p_dim; dir++)
   {
@@ -164,76 +332,81 @@ int main(int argc, char** argv)
                           &source,         // output negative dir proc
                           &dest            // output positive dir proc
                           );
+    nbr[0][dir] = (dest != MPI_PROC_NULL);
+    nbr[1][dir] = (source != MPI_PROC_NULL);
     if (dest != MPI_PROC_NULL)   // non-boundary, neighbour on 'left'
-      udim[0][dir] = 1;
+      udim[0][dir] = 0;
     else                         // boundary, no neighbour of 'left'
-      udim[0][dir] = 2;
+      udim[0][dir] = 1;
     if (source != MPI_PROC_NULL) // non-boundary, neighbour on 'right'
-      udim[1][dir] = local_dim[dir];
-    else                         // boundary, no neighbour on 'right'
       udim[1][dir] = local_dim[dir] - 1;
+    else                         // boundary, no neighbour on 'right'
+      udim[1][dir] = local_dim[dir] - 2;
   } // udim[][0] -> Nk, udim[][1] -> Nj, udim[][2] -> Ni
 
 
   int t0=0, t1=1;      // Indicate solution_old, solution_new in Jacobi
   double maxdelta=0.0; // Diff b/w 2 jacobi iterates to measure convergence
 
-  int tag = 0;         // Unused
-  int itermax = 1000;
   double eps = 1e-10;  // Tolerance
-  int source, dest;    // Neighbouring processes with which we'd trade.
+  if (bench)
+    eps = 0.0;         // The same amount of work in every run
   int iter = 0;
+  // Time spent by this rank in halo exchange, sweeps and reduction
+  double t_halo = 0.0, t_sweep = 0.0, t_reduce = 0.0, t_phase;
 
+  // Start all ranks together so that the time of the first exchange does not
+  // include the setup of the other ranks
+  MPI_Barrier(GRID_COMM_WORLD);
+  double time_begin = MPI_Wtime();
   while (iter < itermax)
   {
+    // The last pass is shortened so that exactly itermax iterations are done
+    const int sweeps = min(n_sweeps, itermax - iter);
     maxdelta = 0.0;
-    for (int disp = -1; disp <= 1; disp = disp + 2) // disp = -1,1 for 2 directions
+    t_phase = MPI_Wtime();
+    exchange_halo(GRID_COMM_WORLD, phi, t0, ng, local_dim, totmsgsize,
+                  fieldSend, fieldRecv, MaxBufLen);
+    t_halo += MPI_Wtime() - t_phase;
+    t_phase = MPI_Wtime();
+    perf.start("Jacobi_sweep");
+    // Perform sweeps Jacobi iterations, there are ng >= sweeps ghost layers
+    if (kernel == "wavefront")
     {
-      for (int dir = 0; dir < 3; dir++) // Looping over all directions.
+      Jacobi_wavefront(udim, nbr, sweeps, phi, t0,
+                       xmin, ymin, zmin, h, &maxdelta);
+      if (sweeps % 2 == 1)
       {
-        MPI_Request req;
-        MPI_Status status;
-        ierr = MPI_Cart_shift(GRID_COMM_WORLD,
-                              dir,
-                              disp,
-                              &source,
-                              &dest
-                              );
-        if (source != MPI_PROC_NULL) // if source exists
-        {
-          // Recieve intermediary array fieldRecv
-          MPI_Irecv(fieldRecv,         // Recieve buff
-                    totmsgsize[dir], // Upper bound of recieve size
-                    MPI_DOUBLE_PRECISION,
-                    source,
-                    tag,
-                    GRID_COMM_WORLD,
-                    &req
-                    );
-        }
-        if (dest != MPI_PROC_NULL) // if destination exists
-        {
-        // Copy phi to fieldSend to transfer ghost values
-        CopySendBuf(phi, t0,               // solution old
-                    disp, dir,             // neighbour indicator
-                    fieldSend, MaxBufLen   // intermediary array, size
-                    );
-        ierr = MPI_Send(fieldSend, totmsgsize[dir], MPI_DOUBLE_PRECISION,
-                        dest, tag, GRID_COMM_WORLD);
-        }
-        if (source != MPI_PROC_NULL)
+        int tmp = t0; t0 = t1; t1 = tmp; // Swap t0 and t1
+      }
+    }
+    else
+      for (int m = 1; m <= sweeps; m++)
+      {
+        // The m-th sweep also updates the ghost layers that the remaining
+        // sweeps-m sweeps need. The last one updates only udim.
+        int box[2][p_dim];
+        for (int dir = 0; dir < p_dim; dir++)
         {
-          ierr = MPI_Wait(&req, &status);
-          // Copy fieldRecv to phi to recieve ghost values
-          CopyRecvBuf(phi, t0,
-                      disp, dir,
-                      fieldRecv, MaxBufLen);
+          box[0][dir] = udim[0][dir] - nbr[0][dir]*(sweeps-m);
+          box[1][dir] = udim[1][dir] + nbr[1][dir]*(sweeps-m);
         }
-      } // dir loop
-    } // dis loop
-    // Perform Jacobi iteration
-    Jacobi_sweep(udim, phi, t0, t1,
-                 xmin, ymin, zmin, h, &maxdelta);
+        // Convergence is only measured in the last sweep
+        double *delta = (m == sweeps) ? &maxdelta : NULL;
+        if (kernel == "tiled")
+          Jacobi_sweep_tiled(box, phi, t0, t1, xmin, ymin, zmin, h, delta);
+        else
+          Jacobi_sweep(box, phi, t0, t1, xmin, ymin, zmin, h, delta);
+        int tmp = t0; t0 = t1; t1 = tmp; // Swap t0 and t1
+      }
+    t_sweep += MPI_Wtime() - t_phase;
+    // A sweep reads the old and writes the new value of each point, with 6
+    // adds, a multiply and 3 flops for the change. The wavefront kernel does
+    // all the sweeps with one pass through memory.
+    perf.stop("Jacobi_sweep",
+              16.0 * Ni * Nj * Nk * ((kernel == "wavefront") ? 1 : sweeps),
+              10.0 * Ni * Nj * Nk * sweeps);
+    t_phase = MPI_Wtime();
     ierr = MPI_Allreduce(MPI_IN_PLACE,
                          &maxdelta,
                          1,           // buffer size
@@ -241,142 +414,376 @@ int main(int argc, char** argv)
                          MPI_MAX,
                          GRID_COMM_WORLD
                         );
-    iter += 1;
-    if (myid==0)
+    t_reduce += MPI_Wtime() - t_phase;
+    iter += sweeps;
+    if (myid==0 && !bench)
       printf("iter = %d, eps = %.16f, maxdelta = %.16f\n", iter, eps, maxdelta);
-    int tmp = t0; t0 = t1; t1 = tmp; // Swap t0 and t1
     if (maxdelta < eps)
       break;
   }
+  double elapsed = MPI_Wtime() - time_begin;
+  // Slowest rank decides the time to solution
+  ierr = MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX,
+                       GRID_COMM_WORLD);
+  if (myid==0)
+    printf("Time taken by %d iterations with %d ranks x %d threads is %f seconds.\n",
+           iter, numprocs, num_threads, elapsed);
+  if (bench)
+  {
+    // Phases are reported as maximum and average over the ranks, the gap
+    // between them shows the load imbalance.
+    double t_local[3] = {t_halo, t_sweep, t_reduce};
+    double t_max[3], t_avg[3];
+    MPI_Reduce(t_local, t_max, 3, MPI_DOUBLE, MPI_MAX, 0, GRID_COMM_WORLD);
+    MPI_Reduce(t_local, t_avg, 3, MPI_DOUBLE, MPI_SUM, 0, GRID_COMM_WORLD);
+    if (myid_grid == 0)
+    {
+      for (int p = 0; p < 3; p++)
+        t_avg[p] /= num_p_grid;
+      // Points updated per second, counting the interior points only
+      double mlups = 1.0e-6 * iter * (N-2.0) * (N-2.0) * (N-2.0) / elapsed;
+      ifstream exists(bench_file.c_str());
+      bool write_header = !exists.good();
+      exists.close();
+      FILE *fp = fopen(bench_file.c_str(), "a");
+      if (fp == NULL)
+      {
+        printf("Could not open %s\n", bench_file.c_str());
+        MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+      if (write_header)
+        fprintf(fp, "N,ranks,pk,pj,pi,threads,kernel,sweeps,iterations,"
+                    "total,halo_max,halo_avg,sweep_max,sweep_avg,"
+                    "reduce_max,reduce_avg,mlups\n");
+      fprintf(fp, "%d,%d,%d,%d,%d,%d,%s,%d,%d,%e,%e,%e,%e,%e,%e,%e,%f\n",
+              N, num_p_grid, proc_dim[0], proc_dim[1], proc_dim[2],
+              num_threads, kernel.c_str(), n_sweeps, iter, elapsed,
+              t_max[0], t_avg[0], t_max[1], t_avg[1], t_max[2], t_avg[2],
+              mlups);
+      fclose(fp);
+      printf("halo %f s, sweep %f s, reduction %f s (max over ranks), %f MLUP/s\n",
+             t_max[0], t_max[1], t_max[2], mlups);
+    }
+  }
+  if (myid_grid == 0 && perf.is_enabled())
+  {
+    printf("Counters of rank 0 with %d threads\n", num_threads);
+    fflush(stdout);
+    perf.report();
+  }
+  if (output_indicator)
+  {
+    // Pieces overlap by one point, so the ghosts of the final solution are
+    // needed
+    exchange_halo(GRID_COMM_WORLD, phi, t0, ng, local_dim, totmsgsize,
+                  fieldSend, fieldRecv, MaxBufLen);
+    write_solution(GRID_COMM_WORLD, phi[t0], local_dim, start, spat_dim, nbr,
+                   xmin, ymin, zmin, h, iter, "solution");
+  }
   ierr = MPI_Finalize();
-  printf("ierr = %d \n",ierr);
+  if (!bench)
+    printf("ierr = %d \n",ierr);
   // delete[] fieldRecv;
   // delete[] fieldSend;
   // Even though these lines are good practise, they are costing a lot in speed.
   return 0;
 }
 
-// Move from solution array to intermediary array fieldSend before MPI_Send
-void CopySendBuf(Array3D phi[], int t0,
-                 double disp, double dir, double fieldSend[], int MaxBufLen)
+void exchange_halo(MPI_Comm GRID_COMM_WORLD, Array3D phi[], int t0, int ng,
+                   int local_dim[], int totmsgsize[],
+                   double fieldSend[], double fieldRecv[], int MaxBufLen)
 {
-  int iEnd = phi[t0].sizex()-1;
-  int jEnd = phi[t0].sizey()-1;
-  int kEnd = phi[t0].sizez()-1;
-  int i1, i2, j1, j2, k1, k2; // left, right limits in appropriate directions
-  int start = 0;
-  assert ((dir >= 0 && dir <3 ) && "CopySendBuf: Incorrect dir");
-  assert((disp == 1 || disp == -1) && "CopySendBuf: Incorrect disp");
-
-  // Specifying the limits of moving phi to fieldSend[]
-  if (dir == 0) // i-j plane
+  int tag = 0;         // Unused
+  int source, dest;    // Neighbouring processes with which we'd trade.
+  // The directions must be done one after the other, as the planes sent
+  // in a direction contain the ghosts received in the previous ones.
+  for (int dir = 0; dir < 3; dir++) // Looping over all directions.
   {
-    i1 = start + 1, i2 = iEnd - 1; // non-ghost indices
-    j1 = start + 1, j2 = jEnd - 1; // non-ghost indices
-    if (disp == -1)
-      k1 = 1,      k2 = 1;         // non-ghost indices
-    else
-      k1 = kEnd-1, k2 = kEnd-1;    // non-ghost indices
+    for (int disp = -1; disp <= 1; disp = disp + 2) // disp = -1,1 for 2 directions
+    {
+      MPI_Request req;
+      MPI_Status status;
+      MPI_Cart_shift(GRID_COMM_WORLD,
+                     dir,
+                     disp,
+                     &source,
+                     &dest
+                     );
+      // i-planes (dir = 2) are contiguous and need no intermediary arrays
+      double *sendBuf = fieldSend, *recvBuf = fieldRecv;
+      if (dir == 2)
+      {
+        const int n = local_dim[dir];
+        sendBuf = phi[t0].slab((disp == -1) ? 0 : n-ng);
+        recvBuf = phi[t0].slab((disp == -1) ? n : -ng);
+      }
+      if (source != MPI_PROC_NULL) // if source exists
+      {
+        // Recieve intermediary array fieldRecv
+        MPI_Irecv(recvBuf,         // Recieve buff
+                  totmsgsize[dir], // Upper bound of recieve size
+                  MPI_DOUBLE_PRECISION,
+                  source,
+                  tag,
+                  GRID_COMM_WORLD,
+                  &req
+                  );
+      }
+      if (dest != MPI_PROC_NULL) // if destination exists
+      {
+        // Copy phi to fieldSend to transfer ghost values
+        if (dir != 2)
+          CopySendBuf(phi, t0, ng,           // solution old, ghost layers
+                      disp, dir,             // neighbour indicator
+                      fieldSend, MaxBufLen   // intermediary array, size
+                      );
+        MPI_Send(sendBuf, totmsgsize[dir], MPI_DOUBLE_PRECISION,
+                 dest, tag, GRID_COMM_WORLD);
+      }
+      if (source != MPI_PROC_NULL)
+      {
+        MPI_Wait(&req, &status);
+        // Copy fieldRecv to phi to recieve ghost values
+        if (dir != 2)
+          CopyRecvBuf(phi, t0, ng,
+                      disp, dir,
+                      fieldRecv, MaxBufLen);
+      }
+    } // disp loop
+  } // dir loop
+}
+
+void write_solution(MPI_Comm GRID_COMM_WORLD, Array3D &phi,
+                    int local_dim[], int start[], int spat_dim[],
+                    int nbr[][p_dim],
+                    double xmin, double ymin, double zmin, double h,
+                    int iter, string filename)
+{
+  int myid_grid, num_p_grid;
+  MPI_Comm_rank(GRID_COMM_WORLD, &myid_grid);
+  MPI_Comm_size(GRID_COMM_WORLD, &num_p_grid);
+
+  // Extent in (x,y,z) = (i,j,k) = dir (2,1,0). A piece takes one more point
+  // where it has a neighbour on the right, so that no cells are missing
+  // between pieces.
+  int extent[6], whole_extent[6];
+  for (int a = 0; a < p_dim; a++)
+  {
+    int dir = 2 - a;
+    extent[2*a]         = start[dir];
+    extent[2*a+1]       = start[dir] + local_dim[dir] - 1 + nbr[1][dir];
+    whole_extent[2*a]   = 0;
+    whole_extent[2*a+1] = spat_dim[dir] - 1;
   }
-  else if (dir == 1) // i-k plane
+  vector<double> grid_x(extent[1]-extent[0]+1);
+  vector<double> grid_y(extent[3]-extent[2]+1);
+  vector<double> grid_z(extent[5]-extent[4]+1);
+  for (unsigned int i = 0; i < grid_x.size(); i++)
+    grid_x[i] = xmin + (extent[0] + i) * h;
+  for (unsigned int j = 0; j < grid_y.size(); j++)
+    grid_y[j] = ymin + (extent[2] + j) * h;
+  for (unsigned int k = 0; k < grid_z.size(); k++)
+    grid_z[k] = zmin + (extent[4] + k) * h;
+
+  char piece_name[256];
+  snprintf(piece_name, sizeof(piece_name), "%s_%04d.vtr",
+           filename.c_str(), myid_grid);
+  write_rectilinear_piece(grid_x, grid_y, grid_z, phi, extent,
+                          0.0, iter, piece_name);
+
+  // Only the extents are gathered, the solution stays distributed
+  vector<int> extents(6*num_p_grid);
+  MPI_Gather(extent, 6, MPI_INT, extents.data(), 6, MPI_INT, 0,
+             GRID_COMM_WORLD);
+  if (myid_grid == 0)
   {
-    i1 = start + 1, i2 = iEnd - 1; // non-ghost indices
-    k1 = start + 1, k2 = kEnd - 1; // non-ghost indices
-    if (disp == -1)
-      j1 = 1,      j2 = 1;         // non-ghost indices
-    else
-      j1 = jEnd-1, j2 = jEnd - 1;  // non-ghost indices
+    vector<string> piece_names(num_p_grid);
+    for (int p = 0; p < num_p_grid; p++)
+    {
+      snprintf(piece_name, sizeof(piece_name), "%s_%04d.vtr",
+               filename.c_str(), p);
+      piece_names[p] = piece_name;
+    }
+    write_parallel_rectilinear_index(whole_extent, extents.data(),
+                                     piece_names, filename + ".pvtr");
+    printf("Solution written to %s.pvtr\n", filename.c_str());
   }
-  else // j-k plane
+}
+
+// Limits lo[], hi[] (in the order i,j,k of Array3D) of the ng planes traded
+// in direction dir. The planes are full in the other two directions,
+// ghost layers included. With ghost = false, we get the physical planes that
+// are sent and with ghost = true, the ghost planes where they are recieved.
+void plane_limits(Array3D phi[], int t0, int ng, int disp, int dir,
+                  bool ghost, int lo[], int hi[])
+{
+  assert ((dir >= 0 && dir <3 ) && "plane_limits: Incorrect dir");
+  assert((disp == 1 || disp == -1) && "plane_limits: Incorrect disp");
+  int n[p_dim] = {phi[t0].sizex(), phi[t0].sizey(), phi[t0].sizez()};
+  for (int a = 0; a < p_dim; a++)
+    lo[a] = -ng, hi[a] = n[a] + ng - 1;
+  int a = 2 - dir; // dir = 0 -> k, dir = 1 -> j, dir = 2 -> i
+  if (ghost == false)
   {
-    j1 = start + 1, j2 = jEnd - 1;  // non-ghost indices
-    k1 = start + 1, k2 = kEnd - 1;  // non-ghost indices
-    if (disp == -1)
-      i1 = 1,        i2 = 1;        // non-ghost indices
-    else
-      i1 = iEnd - 1, i2 = iEnd - 1; // non-ghost indices
+    if (disp == -1)               // first ng non-ghost planes
+      lo[a] = 0,           hi[a] = ng - 1;
+    else                          // last ng non-ghost planes
+      lo[a] = n[a] - ng,   hi[a] = n[a] - 1;
   }
+  else
+  {
+    if (disp == 1)                // ghost planes on left
+      lo[a] = -ng,         hi[a] = -1;
+    else                          // ghost planes on right
+      lo[a] = n[a],        hi[a] = n[a] + ng - 1;
+  }
+}
+
+// Move from solution array to intermediary array fieldSend before MPI_Send
+void CopySendBuf(Array3D phi[], int t0, int ng,
+                 double disp, double dir, double fieldSend[], int MaxBufLen)
+{
+  int lo[p_dim], hi[p_dim]; // left, right limits in i,j,k
+  plane_limits(phi, t0, ng, disp, dir, false, lo, hi);
 
   // After specifying the limits, move values to fieldSend[]
-  int c = 0; // starting index for fieldSend
-  for (int i = i1; i <= i2; i++)
-    for (int j = j1; j <= j2; j++)
-      for(int k = k1; k <= k2; k++)
+  // The position in fieldSend is computed from (i,j,k) so that the planes
+  // can be split among threads.
+  const int nj = hi[1]-lo[1]+1, nk = hi[2]-lo[2]+1;
+  assert( ((hi[0]-lo[0]+1)*nj*nk<=MaxBufLen) && "CopySendBuff: SendBuff larger than expected.");
+  #pragma omp parallel for collapse(2)
+  for (int i = lo[0]; i <= hi[0]; i++)
+    for (int j = lo[1]; j <= hi[1]; j++)
+      for(int k = lo[2]; k <= hi[2]; k++)
       {
+        const int c = ((i-lo[0])*nj + (j-lo[1]))*nk + (k-lo[2]);
         fieldSend[c] = phi[t0](i,j,k);
-        c = c+1;
       }
-  assert( (c<=MaxBufLen) && "CopySendBuff: SendBuff larger than expected.");
 }
 
 void CopyRecvBuf(Array3D phi[], // Solution old and new
-                 int t0,
+                 int t0, int ng,
                  double disp, double dir, double fieldRecv[], int MaxBufLen)
 {
-  int iEnd = phi[t0].sizex()-1;
-  int jEnd = phi[t0].sizey()-1;
-  int kEnd = phi[t0].sizez()-1;
-  int i1, i2, j1, j2, k1, k2; // left, right limits in appropriate directions
-  int start = 0;
-  assert ((dir >= 0 && dir <3 ) && "CopySendBuf: Incorrect dir");
-  assert((disp == 1 || disp == -1) && "CopySendBuf: Incorrect disp");
-
-  // Specifying the limits of moving fieldRecv[] to phi
-  if (dir == 0) // i-j plane
-  {
-    i1 = start + 1, i2 = iEnd - 1; // non-ghost indices
-    j1 = start + 1, j2 = jEnd - 1; // non-ghost indices
-    if (disp == 1)
-      k1 = 0,    k2 = 0;           // ghost indices
-    else
-      k1 = kEnd,   k2 = kEnd;      // ghost indices
-  }
-  else if (dir == 1) // i-k plane
-  {
-    i1 = start + 1, i2 = iEnd - 1; // non-ghost indices
-    k1 = start + 1, k2 = kEnd - 1; // non-ghost indices
-    if (disp == 1)
-      j1 = 0,    j2 = 0;   // ghost indices
-    else
-      j1 = jEnd,   j2 = jEnd;  // ghost indices
-  }
-  else // j-k plane
-  {
-    j1 = start + 1, j2 = jEnd - 1; // non-ghost indices
-    k1 = start + 1, k2 = kEnd - 1; // non-ghost indices
-    if (disp == 1)
-      i1 = 0,      i2 = 0;  // ghost indices
-    else
-      i1 = iEnd,     i2 = iEnd; // ghost indices
-  }
-
-  int c = 0; // starting index for fieldRecv
-  for (int i = i1; i <= i2; i++)
-    for (int j = j1; j <= j2; j++)
-      for(int k = k1; k <= k2; k++)
+  int lo[p_dim], hi[p_dim]; // left, right limits in i,j,k
+  plane_limits(phi, t0, ng, disp, dir, true, lo, hi);
+
+  const int nj = hi[1]-lo[1]+1, nk = hi[2]-lo[2]+1;
+  assert( ((hi[0]-lo[0]+1)*nj*nk<=MaxBufLen) && "CopyRecvBuff: RecvBuff larger than expected.");
+  #pragma omp parallel for collapse(2)
+  for (int i = lo[0]; i <= hi[0]; i++)
+    for (int j = lo[1]; j <= hi[1]; j++)
+      for(int k = lo[2]; k <= hi[2]; k++)
       {
+        const int c = ((i-lo[0])*nj + (j-lo[1]))*nk + (k-lo[2]); // index in fieldRecv
         phi[t0](i,j,k) = fieldRecv[c];
-        c = c+1;
       }
-  assert( (c<=MaxBufLen) && "CopySendBuff: SendBuff larger than expected.");
 }
 
-void Jacobi_sweep(int udim[][p_dim], // local_dim(pts in dimension)
+// 7 point Jacobi update of the points k0,...,k1 of the line (i,j,:).
+// Works on raw pointers with k contiguous, so that the loop vectorizes.
+// Returns the largest change if compute_delta is true.
+inline double Jacobi_line(const Array3D &u_old, Array3D &u_new,
+                          int i, int j, int k0, int k1,
+                          double xmin, double ymin, double zmin, double h,
+                          bool compute_delta)
+{
+  assert(u_old.stride(2) == 1 && "Jacobi_line: k must be the fastest index");
+  const double *u = u_old.ptr(i,j,0);
+  double *v = u_new.ptr(i,j,0);
+  const int si = u_old.stride(0), sj = u_old.stride(1);
+  const double x = xmin + i * h, y = ymin + j * h; // This is wrong!
+  double delta = 0.0;
+  for (int k = k0; k <= k1; k++)
+  {
+    double z = zmin + k * h;
+    v[k] = ( h*h * f(x,y,z)
+             + (u[k+si] + u[k-si])
+             + (u[k+sj] + u[k-sj])
+             + (u[k+1]  + u[k-1]) ) / 6.0;
+    if (compute_delta)
+      delta = fmax(delta, fabs(v[k]-u[k]));
+  }
+  return delta;
+}
+
+void Jacobi_sweep(int box[][p_dim],
                   Array3D phi[], int t0, int t1,
                   double xmin, double ymin, double zmin,
                   double h,
                   double *maxdelta)
 {
-  double x, y, z;
-  for (int i = udim[0][2]; i <= udim[1][2]; i++)
-    for (int j = udim[0][1]; j <= udim[1][1]; j++)
-      for (int k = udim[0][0]; k <= udim[1][0]; k++)
-      {
-        x = xmin + i * h, y = ymin + j * h, z = zmin + k * h; // This is wrong!
-        phi[t1](i,j,k) = ( h*h * f(x,y,z)
-                             + (phi[t0](i+1,j,k) + phi[t0](i-1,j,k))
-                             + (phi[t0](i,j+1,k) + phi[t0](i,j-1,k))
-                             + (phi[t0](i,j,k+1) + phi[t0](i,j,k-1)) ) / 6.0;
-        *maxdelta = fmax(*maxdelta, fabs(phi[t1](i,j,k)-phi[t0](i,j,k)));
-      }
+  // Each thread keeps its own maximum, reduction combines them at the end
+  double delta = 0.0;
+  const bool compute_delta = (maxdelta != NULL);
+  #pragma omp parallel for collapse(2) reduction(max:delta)
+  for (int i = box[0][2]; i <= box[1][2]; i++)
+    for (int j = box[0][1]; j <= box[1][1]; j++)
+      delta = fmax(delta, Jacobi_line(phi[t0], phi[t1], i, j,
+                                      box[0][0], box[1][0],
+                                      xmin, ymin, zmin, h, compute_delta));
+  if (compute_delta)
+    *maxdelta = fmax(*maxdelta, delta);
+}
+
+void Jacobi_sweep_tiled(int box[][p_dim],
+                        Array3D phi[], int t0, int t1,
+                        double xmin, double ymin, double zmin,
+                        double h,
+                        double *maxdelta)
+{
+  double delta = 0.0;
+  const bool compute_delta = (maxdelta != NULL);
+  // Tiles are shared among threads, each tile is swept along i
+  #pragma omp parallel for collapse(2) reduction(max:delta)
+  for (int jj = box[0][1]; jj <= box[1][1]; jj += tile_j)
+    for (int kk = box[0][0]; kk <= box[1][0]; kk += tile_k)
+    {
+      const int j_end = min(jj + tile_j - 1, box[1][1]);
+      const int k_end = min(kk + tile_k - 1, box[1][0]);
+      for (int i = box[0][2]; i <= box[1][2]; i++)
+        for (int j = jj; j <= j_end; j++)
+          delta = fmax(delta, Jacobi_line(phi[t0], phi[t1], i, j, kk, k_end,
+                                          xmin, ymin, zmin, h, compute_delta));
+    }
+  if (compute_delta)
+    *maxdelta = fmax(*maxdelta, delta);
+}
+
+// The m-th sweep updates udim grown by n_sweeps-m points on the sides with
+// a neighbour, i.e., the ghosts that the remaining sweeps need.
+// The m-th sweep reads phi[(t0+m-1)%2] and writes phi[(t0+m)%2]. At the
+// wavefront p, it updates the plane i = p-(m-1). The sweeps are done in
+// increasing order of m, so the planes i-1,i,i+1 of sweep m-1 are ready
+// when sweep m reaches plane i, and the plane i of sweep m-2 that it
+// overwrites has already been used by sweep m-1.
+void Jacobi_wavefront(int udim[][p_dim], int nbr[][p_dim], int n_sweeps,
+                      Array3D phi[], int t0,
+                      double xmin, double ymin, double zmin,
+                      double h,
+                      double *maxdelta)
+{
+  double delta = 0.0;
+  const int p_begin = udim[0][2] - nbr[0][2]*(n_sweeps-1);
+  const int p_end   = udim[1][2] + n_sweeps - 1;
+  #pragma omp parallel reduction(max:delta)
+  for (int p = p_begin; p <= p_end; p++)
+    for (int m = 1; m <= n_sweeps; m++)
+    {
+      const int i = p - (m-1);
+      const int grow = n_sweeps - m;
+      if (i < udim[0][2] - nbr[0][2]*grow || i > udim[1][2] + nbr[1][2]*grow)
+        continue; // Same for all threads
+      const int j0 = udim[0][1] - nbr[0][1]*grow, j1 = udim[1][1] + nbr[1][1]*grow;
+      const int k0 = udim[0][0] - nbr[0][0]*grow, k1 = udim[1][0] + nbr[1][0]*grow;
+      const Array3D &u_old = phi[(t0+m-1)%2];
+      Array3D &u_new = phi[(t0+m)%2];
+      // Implicit barrier at the end keeps the sweeps in order
+      #pragma omp for schedule(static)
+      for (int j = j0; j <= j1; j++)
+        // Convergence is measured in the last sweep
+        delta = fmax(delta, Jacobi_line(u_old, u_new, i, j, k0, k1,
+                                        xmin, ymin, zmin, h, m == n_sweeps));
+    }
+  *maxdelta = fmax(*maxdelta, delta);
 }
@@ -0,0 +1,69 @@
+#!/bin/bash
+# Strong and weak scaling of poisson3d over the rank counts on this node.
+# Every run appends one line with the times of halo exchange, sweeps and
+# reduction to a CSV file (see the bench option of poisson3d).
+#
+# Usage: ./scaling_bench.sh [strong/weak] [N] [itermax] [ranks...]
+#   strong : the grid is N^3 for all rank counts
+#   weak   : the grid is about N^3 points per rank, so that the work per rank
+#            stays the same
+# The rank counts default to 1 2 4 8 up to the number of cores given by
+# nproc. Further poisson3d options (kernel, sweeps) can be given with
+# POISSON_ARGS, e.g. POISSON_ARGS="wavefront 4" ./scaling_bench.sh weak
+# The results go to scaling_<mode>.csv, or to $CSV.
+
+mode=${1:-strong}
+N=${2:-120}
+itermax=${3:-200}
+# The rank counts are what is left after the first three arguments
+shift $(( $# < 3 ? $# : 3 ))
+ranks_list="$@"
+if [ -z "$ranks_list" ]; then
+  for ((r = 1; r <= $(nproc); r = 2*r)); do
+    ranks_list="$ranks_list $r"
+  done
+fi
+if [ "$mode" != "strong" ] && [ "$mode" != "weak" ]; then
+  echo "Use ./scaling_bench.sh [strong/weak] [N] [itermax] [ranks...]"
+  exit 1
+fi
+
+MPIRUN=${MPIRUN:-mpirun}
+CSV=${CSV:-scaling_$mode.csv}
+THREADS=${OMP_NUM_THREADS:-1}
+export OMP_NUM_THREADS=$THREADS
+export OMP_PROC_BIND=close
+export OMP_PLACES=cores
+
+# Rank grid as close to a cube as possible, e.g. 8 -> 2x2x2, 12 -> 2x2x3
+rank_grid()
+{
+  local r=$1 p=(1 1 1) f=2 d
+  while ((r > 1)); do
+    while ((r % f == 0)); do
+      # Give the factor to the direction with fewest processes
+      d=0
+      ((p[1] < p[d])) && d=1
+      ((p[2] < p[d])) && d=2
+      p[$d]=$((p[d] * f))
+      r=$((r / f))
+    done
+    f=$((f + 1))
+  done
+  echo "${p[0]}x${p[1]}x${p[2]}"
+}
+
+echo "Appending to $CSV"
+printf "%8s %10s %8s %12s\n" ranks grid N seconds
+for ranks in $ranks_list; do
+  grid=$(rank_grid $ranks)
+  n=$N
+  if [ "$mode" == "weak" ]; then
+    n=$(awk -v n=$N -v r=$ranks 'BEGIN {printf "%d", n*r^(1.0/3.0) + 0.5}')
+  fi
+  seconds=$($MPIRUN -np $ranks --map-by ppr:$ranks:node:pe=$THREADS \
+            --bind-to core ./poisson3d $POISSON_ARGS N=$n procs=$grid \
+            itermax=$itermax bench=$CSV | grep "Time taken" \
+            | awk '{print $(NF-1)}')
+  printf "%8d %10s %8d %12s\n" $ranks $grid $n "$seconds"
+done